@@ -226,7 +226,8 @@ constexpr size_t GCodeReplyLength = StringLength256;	// Maximum number of charac
 constexpr size_t MachineNameLength = StringLength50;
 constexpr size_t RepRapPasswordLength = StringLength20;
 constexpr size_t MediumStringLength = MaxFilenameLength;
-constexpr size_t StringBufferLength = StringLength256;	// Length of the string buffer used by the expression parser
+constexpr size_t StringArenaBlockSize = StringLength256;	// Size of the blocks of string storage used by the expression parser
+constexpr size_t MaxStringArenaSize = 2048;				// Maximum string storage used when evaluating a single expression
 constexpr size_t StringLengthLoggedCommand = StringLength100;	// Length of a string buffer for a command to be logged
 
 #if SAM4E || SAM4S || SAME70 || SAME5x || defined(ESP_NETWORKING) || __LPC17xx__ || STM32F4
@@ -243,21 +244,31 @@ constexpr size_t SHORT_GCODE_LENGTH = 64;
 // When using RTOS, it is best if it is possible to fit an HTTP response header in a single buffer. Our headers are currently about 230 bytes long.
 // A note on reserved buffers: the worst case is when a GCode with a long response is processed. After string the response, there must be enough buffer space
 // for the HTTP responder to return a status response. Otherwise DWC never gets to know that it needs to make a rr_reply call and the system deadlocks.
+// Output buffers come in three sizes. A reply starts in the smallest buffer available so that short replies don't waste space, and continues in the largest
+// buffers available so that long replies need fewer buffers. The reserve is measured in buffers of the standard size.
+constexpr size_t SMALL_OUTPUT_BUFFER_SIZE = 64;			// How many bytes does each small OutputBuffer hold?
+constexpr size_t OUTPUT_BUFFER_SIZE = 256;				// How many bytes does each standard OutputBuffer hold?
+constexpr size_t LARGE_OUTPUT_BUFFER_SIZE = 1024;		// How many bytes does each large OutputBuffer hold?
+
 #if SAME70 || SAME5x || STM32F4
-constexpr size_t OUTPUT_BUFFER_SIZE = 256;				// How many bytes does each OutputBuffer hold?
-constexpr size_t OUTPUT_BUFFER_COUNT = 40;				// How many OutputBuffer instances do we have?
+constexpr size_t SMALL_OUTPUT_BUFFER_COUNT = 24;		// How many small OutputBuffer instances do we have?
+constexpr size_t OUTPUT_BUFFER_COUNT = 24;				// How many standard OutputBuffer instances do we have?
+constexpr size_t LARGE_OUTPUT_BUFFER_COUNT = 2;			// How many large OutputBuffer instances do we have?
 constexpr size_t RESERVED_OUTPUT_BUFFERS = 4;			// Number of reserved output buffers after long responses, enough to hold a status response
 #elif SAM4E || SAM4S
-constexpr size_t OUTPUT_BUFFER_SIZE = 256;				// How many bytes does each OutputBuffer hold?
-constexpr size_t OUTPUT_BUFFER_COUNT = 24;				// How many OutputBuffer instances do we have?
+constexpr size_t SMALL_OUTPUT_BUFFER_COUNT = 16;		// How many small OutputBuffer instances do we have?
+constexpr size_t OUTPUT_BUFFER_COUNT = 14;				// How many standard OutputBuffer instances do we have?
+constexpr size_t LARGE_OUTPUT_BUFFER_COUNT = 1;			// How many large OutputBuffer instances do we have?
 constexpr size_t RESERVED_OUTPUT_BUFFERS = 4;			// Number of reserved output buffers after long responses, enough to hold a status response
 #elif SAM3XA
-constexpr size_t OUTPUT_BUFFER_SIZE = 256;				// How many bytes does each OutputBuffer hold?
-constexpr size_t OUTPUT_BUFFER_COUNT = 16;				// How many OutputBuffer instances do we have?
+constexpr size_t SMALL_OUTPUT_BUFFER_COUNT = 12;		// How many small OutputBuffer instances do we have?
+constexpr size_t OUTPUT_BUFFER_COUNT = 8;				// How many standard OutputBuffer instances do we have?
+constexpr size_t LARGE_OUTPUT_BUFFER_COUNT = 1;			// How many large OutputBuffer instances do we have?
 constexpr size_t RESERVED_OUTPUT_BUFFERS = 2;			// Number of reserved output buffers after long responses
 #elif __LPC17xx__
-constexpr uint16_t OUTPUT_BUFFER_SIZE = 256;            // How many bytes does each OutputBuffer hold?
-constexpr size_t OUTPUT_BUFFER_COUNT = 16;              // How many OutputBuffer instances do we have?
+constexpr size_t SMALL_OUTPUT_BUFFER_COUNT = 12;        // How many small OutputBuffer instances do we have?
+constexpr size_t OUTPUT_BUFFER_COUNT = 8;               // How many standard OutputBuffer instances do we have?
+constexpr size_t LARGE_OUTPUT_BUFFER_COUNT = 1;         // How many large OutputBuffer instances do we have?
 constexpr size_t RESERVED_OUTPUT_BUFFERS = 2;           // Number of reserved output buffers after long responses. Must be enough for an HTTP header
 #else
 # error
@@ -324,6 +335,53 @@ constexpr size_t MAX_FILES = 10;						// Must be large enough to handle the max
 
 constexpr size_t FILE_BUFFER_SIZE = 128;
 
+#if __LPC17xx__
+constexpr size_t FileReadaheadBufferSize = 1024;		// Size of the buffer used to read the file being printed ahead of the G-code interpreter
+#else
+constexpr size_t FileReadaheadBufferSize = 4096;		// Size of the buffer used to read the file being printed ahead of the G-code interpreter
+#endif
+constexpr size_t FileReadaheadChunkSize = 512;			// The readahead task reads when at least this much space is free. One sector is most efficient.
+
+#if SAME70
+constexpr size_t MacroCacheSize = 8192;					// Maximum RAM used to cache macro files
+#elif SAM4E || SAME5x
+constexpr size_t MacroCacheSize = 4096;
+#else
+constexpr size_t MacroCacheSize = 2048;
+#endif
+constexpr size_t MaxCachedMacroFileSize = MacroCacheSize/2;	// Larger macro files are always read from the card
+
+#if SAME70
+constexpr size_t DirectoryIndexCheckpoints = 64;		// Number of directory positions kept to speed up paged file listings
+#else
+constexpr size_t DirectoryIndexCheckpoints = 16;
+#endif
+constexpr unsigned int DirectoryIndexInterval = 8;		// Initial number of listed entries between directory positions, doubled when the checkpoints run out
+
+#if SAME70
+constexpr size_t FileInfoCacheEntries = 16;				// Number of G-code files whose parsed information is cached in RAM as well as on the card
+#elif SAM4E || SAME5x
+constexpr size_t FileInfoCacheEntries = 8;
+#else
+constexpr size_t FileInfoCacheEntries = 4;
+#endif
+constexpr size_t FileInfoParseQueueLength = 4;			// Number of files that can be waiting to be parsed in the background
+constexpr uint32_t FileInfoCacheSaveDelay = 5000;		// Milliseconds after the file info cache last changed before we write the new entries to the card
+constexpr size_t FileInfoCacheMaxRecords = 250;		// Maximum number of file info records kept on the card, the least recently used ones are deleted first
+constexpr size_t FileInfoCachePruneBatch = 8;			// Maximum number of file info records deleted per scan of the record directory
+
+constexpr uint32_t StatusSnapshotInterval = 200;		// Milliseconds for which a rendered status or object model response is reused for other clients
+constexpr uint32_t LiveSeqSampleInterval = 250;		// Minimum milliseconds between checks for changes to the live values in a section of the object model
+
+// Telemetry recorder
+constexpr size_t MaxTelemetryChannels = 8;					// Maximum number of object model values that can be recorded
+constexpr size_t NumTelemetryTiers = 3;						// Number of resolutions at which history is kept, each one coarser than the last
+constexpr size_t TelemetryHistoryLength = 60;				// Number of samples or min/max/average buckets kept at each resolution
+constexpr unsigned int TelemetryDownsampleFactor = 10;		// Number of entries at one resolution that make up a bucket at the next
+constexpr uint32_t DefaultTelemetryInterval = 250;			// Default milliseconds between samples
+constexpr uint32_t MinTelemetryInterval = 10;
+constexpr uint32_t MaxTelemetryInterval = 60000;
+
 // Webserver stuff
 #define DEFAULT_PASSWORD		"reprap"				// Default machine password
 #define DEFAULT_MACHINE_NAME	"My Duet"				// Default machine name
@@ -355,6 +413,7 @@ static_assert(MaxExpectedWebDirFilenameLength + strlen(WEB_DIR) + strlen(".gz")
 #define UPLOAD_EXTENSION ".part"					// Extension to a filename for a file being uploaded
 
 #define DEFAULT_LOG_FILE "eventlog.txt"
+#define FILE_INFO_CACHE_DIR "fileinfo"					// Directory in the system directory that the G-code file info cache is saved in, one file per G-code file
 
 #define EOF_STRING "<!-- **EoF** -->"
 
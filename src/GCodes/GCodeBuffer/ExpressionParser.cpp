@@ -9,17 +9,20 @@
 
 #include "GCodeBuffer.h"
 #include <RepRap.h>
+#include <GCodes/GCodes.h>
 #include <General/NamedEnum.h>
 #include <General/NumericConverter.h>
 
 #include <limits>
 
+constexpr size_t MaxScalarStringLength = StringLength50;			// enough space to convert any non-string value to a string
+
 // These can't be declared locally inside ParseIdentifierExpression because NamedEnum includes static data
 NamedEnum(NamedConstant, unsigned int, _false, iterations, line, _null, pi, _result, _true);
-NamedEnum(Function, unsigned int, abs, acos, asin, atan, atan2, cos, degrees, floor, isnan, max, min, mod, radians, random, sin, sqrt, tan);
+NamedEnum(Function, unsigned int, abs, acos, asin, atan, atan2, cos, count, degrees, floor, isnan, max, mean, min, mod, radians, random, sin, sqrt, sum, tan);
 
 ExpressionParser::ExpressionParser(const GCodeBuffer& p_gb, const char *text, const char *textLimit, int p_column) noexcept
-	: currentp(text), startp(text), endp(textLimit), gb(p_gb), column(p_column), stringBuffer(stringBufferStorage, ARRAY_SIZE(stringBufferStorage))
+	: currentp(text), startp(text), endp(textLimit), gb(p_gb), column(p_column), currentAggregator(nullptr)
 {
 }
 
@@ -44,6 +47,10 @@ ExpressionValue ExpressionParser::Parse(bool evaluate, uint8_t priority) THROWS(
 	constexpr uint8_t UnaryPriority = 10;									// must be higher than any binary operator priority
 	static_assert(ARRAY_SIZE(priorities) == strlen(operators));
 
+	// If we are parsing the argument of an aggregate function then only the outermost operand may be an array
+	ArrayAggregator * const aggregator = currentAggregator;
+	currentAggregator = nullptr;
+
 	// Start by looking for a unary operator or opening bracket
 	SkipWhiteSpace();
 	const char c = CurrentCharacter();
@@ -51,7 +58,7 @@ ExpressionValue ExpressionParser::Parse(bool evaluate, uint8_t priority) THROWS(
 	switch (c)
 	{
 	case '"':
-		ParseQuotedString(stringBuffer.GetRef());
+		ParseQuotedString();
 		val.Set(GetAndFix());
 		break;
 
@@ -99,7 +106,7 @@ ExpressionValue ExpressionParser::Parse(bool evaluate, uint8_t priority) THROWS(
 		if (isalpha(CurrentCharacter()))
 		{
 			// Probably applying # to an object model array, so optimise by asking the OM for just the length
-			val = ParseIdentifierExpression(evaluate, true);
+			val = ParseIdentifierExpression(evaluate, true, nullptr);
 		}
 		else
 		{
@@ -108,7 +115,7 @@ ExpressionValue ExpressionParser::Parse(bool evaluate, uint8_t priority) THROWS(
 			{
 				const char* s = val.sVal;
 				val.Set((int32_t)strlen(s));
-				stringBuffer.FinishedUsing(s);
+				strings.FinishedUsing(s);
 				val.SetType(TypeCode::Int32);
 			}
 			else
@@ -120,7 +127,7 @@ ExpressionValue ExpressionParser::Parse(bool evaluate, uint8_t priority) THROWS(
 
 	case '{':
 		AdvancePointer();
-		val = ParseExpectKet(evaluate, '}');
+		val = ParseBracedExpression(evaluate, aggregator);
 		break;
 
 	case '(':
@@ -142,7 +149,7 @@ ExpressionValue ExpressionParser::Parse(bool evaluate, uint8_t priority) THROWS(
 		}
 		else if (isalpha(c))				// looks like a variable name
 		{
-			val = ParseIdentifierExpression(evaluate, false);
+			val = ParseIdentifierExpression(evaluate, false, aggregator);
 		}
 		else
 		{
@@ -151,6 +158,12 @@ ExpressionValue ExpressionParser::Parse(bool evaluate, uint8_t priority) THROWS(
 		break;
 	}
 
+	// An array can only be the entire argument of an aggregate function, so it can't be followed by a binary operator
+	if (aggregator != nullptr && aggregator->HasAggregated())
+	{
+		return val;
+	}
+
 	// See if it is followed by a binary operator
 	do
 	{
@@ -439,11 +452,15 @@ ExpressionValue ExpressionParser::Parse(bool evaluate, uint8_t priority) THROWS(
 					ConvertToString(val, evaluate);
 					ConvertToString(val2, evaluate);
 					// We could skip evaluation if evaluate is false, but there is no real need to
-					if (stringBuffer.Concat(val.sVal, val2.sVal))
 					{
-						throw ConstructParseException("too many strings");
+						// If the left operand is the most recent string then the arena appends to it in place instead of copying it
+						const char * const s = strings.Concat(val.sVal, val2.sVal);
+						if (s == nullptr)
+						{
+							throw ConstructParseException("string too long");
+						}
+						val.sVal = s;
 					}
-					val.sVal = GetAndFix();
 					break;
 				}
 			}
@@ -451,6 +468,45 @@ ExpressionValue ExpressionParser::Parse(bool evaluate, uint8_t priority) THROWS(
 	} while (true);
 }
 
+// Evaluate an expression in braces, or an array literal such as {1, 2, 3} if we are parsing the argument of an aggregate function
+ExpressionValue ExpressionParser::ParseBracedExpression(bool evaluate, ArrayAggregator *null aggregator) THROWS(GCodeException)
+{
+	ExpressionValue rslt = Parse(evaluate);
+	SkipWhiteSpace();
+	if (CurrentCharacter() == ',')
+	{
+		if (aggregator == nullptr)
+		{
+			throw ConstructParseException("array literals may only be used as the argument of an aggregate function");
+		}
+
+		// The elements are accumulated as we parse them, so we don't need to store them
+		for (;;)
+		{
+			if (evaluate && !aggregator->Accumulate(rslt))
+			{
+				throw ConstructParseException("array elements must be numeric");
+			}
+			if (CurrentCharacter() != ',')
+			{
+				break;
+			}
+			AdvancePointer();
+			rslt = Parse(evaluate);
+			SkipWhiteSpace();
+		}
+		aggregator->SetAggregated();
+		rslt = aggregator->GetResult();
+	}
+
+	if (CurrentCharacter() != '}')
+	{
+		throw ConstructParseException("expected '%c'", (uint32_t)'}');
+	}
+	AdvancePointer();
+	return rslt;
+}
+
 bool ExpressionParser::ParseBoolean() THROWS(GCodeException)
 {
 	ExpressionValue val = Parse();
@@ -627,8 +683,13 @@ void ExpressionParser::ConvertToString(ExpressionValue& val, bool evaluate) THRO
 	{
 		if (evaluate)
 		{
-			stringBuffer.ClearLatest();
-			val.AppendAsString(stringBuffer.GetRef());
+			strings.ClearLatest();
+			if (strings.Reserve(MaxScalarStringLength))
+			{
+				throw ConstructParseException("string too long");
+			}
+			val.AppendAsString(strings.GetLatestRef());
+			strings.LatestUpdated();
 			val.Set(GetAndFix());
 		}
 		else
@@ -638,13 +699,13 @@ void ExpressionParser::ConvertToString(ExpressionValue& val, bool evaluate) THRO
 	}
 }
 
-// Get a C-style pointer to the latest string in the buffer, and start a new one
+// Get a C-style pointer to the latest string in the arena, and start a new one
 const char *ExpressionParser::GetAndFix()
 {
-	const char *const rslt = stringBuffer.LatestCStr();
-	if (stringBuffer.Fix())
+	const char *const rslt = strings.Fix();
+	if (rslt == nullptr)
 	{
-		throw ConstructParseException("too many strings");
+		throw ConstructParseException("string too long");
 	}
 	return rslt;
 }
@@ -680,7 +741,8 @@ ExpressionValue ExpressionParser::ParseNumber() noexcept
 // Parse an identifier expression
 // If 'evaluate' is false then the object model path may not exist, in which case we must ignore error that and parse it all anyway
 // This means we can use expressions such as: if {a.b == null || a.b.c == 1}
-ExpressionValue ExpressionParser::ParseIdentifierExpression(bool evaluate, bool applyLengthOperator) THROWS(GCodeException)
+// If 'aggregator' is not null then we are parsing the argument of an aggregate function, so arrays and array wildcards such as heat.heaters[].current are allowed
+ExpressionValue ExpressionParser::ParseIdentifierExpression(bool evaluate, bool applyLengthOperator, ArrayAggregator *null aggregator) THROWS(GCodeException)
 {
 	if (!isalpha(CurrentCharacter()))
 	{
@@ -698,6 +760,19 @@ ExpressionValue ExpressionParser::ParseIdentifierExpression(bool evaluate, bool
 		AdvancePointer();
 		if (c == '[')
 		{
+			SkipWhiteSpace();
+			if (CurrentCharacter() == ']')
+			{
+				// Empty index, meaning all elements of the array. Provide a placeholder index that will be replaced by each element index in turn.
+				AdvancePointer();
+				context.ProvideIndex(0);
+				if (id.cat("[]"))
+				{
+					throw ConstructParseException("variable name too long");
+				}
+				continue;
+			}
+
 			const ExpressionValue index = Parse(evaluate);
 			if (CurrentCharacter() != ']')
 			{
@@ -717,6 +792,16 @@ ExpressionValue ExpressionParser::ParseIdentifierExpression(bool evaluate, bool
 		}
 	}
 
+	// Check for local and global variables
+	if (StringStartsWith(id.c_str(), "var."))
+	{
+		return GetVariableValue(id.c_str() + strlen("var."), false, evaluate);
+	}
+	if (StringStartsWith(id.c_str(), "global."))
+	{
+		return GetVariableValue(id.c_str() + strlen("global."), true, evaluate);
+	}
+
 	// Check for the names of constants
 	NamedConstant whichConstant(id.c_str());
 	if (whichConstant.IsValid())
@@ -780,13 +865,26 @@ ExpressionValue ExpressionParser::ParseIdentifierExpression(bool evaluate, bool
 	{
 		// It's a function call
 		AdvancePointer();
-		ExpressionValue rslt = Parse(evaluate);					// evaluate the first operand
 		const Function func(id.c_str());
 		if (!func.IsValid())
 		{
 			throw ConstructParseException("unknown function");
 		}
 
+		// Functions that accept an array argument pass an aggregator down to the parser of the first operand
+		const unsigned int funcNum = func.RawValue();
+		ArrayAggregator aggregator((funcNum == Function::min) ? ArrayAggregator::Operation::min
+									: (funcNum == Function::max) ? ArrayAggregator::Operation::max
+									: (funcNum == Function::sum) ? ArrayAggregator::Operation::sum
+									: (funcNum == Function::mean) ? ArrayAggregator::Operation::mean
+										: ArrayAggregator::Operation::count);
+		if (funcNum == Function::min || funcNum == Function::max || funcNum == Function::sum || funcNum == Function::mean || funcNum == Function::count)
+		{
+			currentAggregator = &aggregator;
+		}
+		ExpressionValue rslt = Parse(evaluate);					// evaluate the first operand
+		currentAggregator = nullptr;
+
 		switch (func.RawValue())
 		{
 		case Function::abs:
@@ -929,7 +1027,7 @@ ExpressionValue ExpressionParser::ParseIdentifierExpression(bool evaluate, bool
 			break;
 
 		case Function::max:
-			for (;;)
+			while (!aggregator.HasAggregated())
 			{
 				SkipWhiteSpace();
 				if (CurrentCharacter() != ',')
@@ -953,7 +1051,7 @@ ExpressionValue ExpressionParser::ParseIdentifierExpression(bool evaluate, bool
 			break;
 
 		case Function::min:
-			for (;;)
+			while (!aggregator.HasAggregated())
 			{
 				SkipWhiteSpace();
 				if (CurrentCharacter() != ',')
@@ -976,6 +1074,15 @@ ExpressionValue ExpressionParser::ParseIdentifierExpression(bool evaluate, bool
 			}
 			break;
 
+		case Function::sum:
+		case Function::mean:
+		case Function::count:
+			if (!aggregator.HasAggregated() && evaluate)
+			{
+				throw ConstructParseException("expected an array argument");
+			}
+			break;
+
 		case Function::random:
 			{
 				const uint32_t limit = (rslt.GetType() == TypeCode::Uint32) ? rslt.uVal
@@ -1000,18 +1107,85 @@ ExpressionValue ExpressionParser::ParseIdentifierExpression(bool evaluate, bool
 	}
 
 	// If we are not evaluating then the object expression doesn't have to exist, so don't retrieve it because that might throw an error
-	return (evaluate) ? reprap.GetObjectValue(context, nullptr, id.c_str()) : ExpressionValue(nullptr);
+	if (!evaluate)
+	{
+		if (aggregator != nullptr && strstr(id.c_str(), "[]") != nullptr)
+		{
+			aggregator->SetAggregated();
+		}
+		return ExpressionValue(nullptr);
+	}
+
+	context.SetAggregator(aggregator);
+	const ExpressionValue val = reprap.GetObjectValue(context, nullptr, id.c_str());
+	return (aggregator != nullptr && aggregator->HasAggregated()) ? aggregator->GetResult() : val;
+}
+
+// Get the value of a local or global variable
+// If we are not evaluating then the variable need not exist, because it may be guarded by a test for it being null
+ExpressionValue ExpressionParser::GetVariableValue(const char *name, bool isGlobal, bool evaluate) THROWS(GCodeException)
+{
+	if (!VariableSet::IsValidName(name))
+	{
+		throw ConstructParseException("invalid variable name");
+	}
+
+	if (isGlobal)
+	{
+		// Global variables may be changed by another input channel, so copy any string value while we hold the lock
+		const auto vars = reprap.GetGCodes().GetGlobalVariablesForReading();
+		const Variable * const v = vars->Lookup(name);
+		if (v != nullptr)
+		{
+			ExpressionValue val = v->GetValue();
+			if (val.GetType() == TypeCode::CString)
+			{
+				strings.ClearLatest();
+				if (strings.Append(val.sVal))
+				{
+					throw ConstructParseException("string too long");
+				}
+				val.Set(GetAndFix());
+			}
+			return val;
+		}
+	}
+	else
+	{
+		const Variable * const v = gb.MachineState().variables.Lookup(name);
+		if (v != nullptr)
+		{
+			return v->GetValue();
+		}
+	}
+
+	if (evaluate)
+	{
+		throw ConstructParseException("unknown variable '%s'", name);
+	}
+	return ExpressionValue(nullptr);
 }
 
 // Parse a quoted string, given that the current character is double-quote
 // This is almost a copy of InternalGetQuotedString in class StringParser
-void ExpressionParser::ParseQuotedString(const StringRef& str) THROWS(GCodeException)
+void ExpressionParser::ParseQuotedString() THROWS(GCodeException)
 {
-	str.Clear();
+	strings.ClearLatest();
 	AdvancePointer();
 	for (;;)
 	{
-		char c = CurrentCharacter();
+		// Copy runs of ordinary characters in one go
+		const char *const runStart = currentp;
+		char c;
+		while ((c = CurrentCharacter()) >= ' ' && c != '"' && c != '\'')
+		{
+			AdvancePointer();
+		}
+		if (currentp != runStart && strings.Append(runStart, currentp - runStart))
+		{
+			throw ConstructParseException("string too long");
+		}
+
 		AdvancePointer();
 		if (c < ' ')
 		{
@@ -1039,7 +1213,7 @@ void ExpressionParser::ParseQuotedString(const StringRef& str) THROWS(GCodeExcep
 				AdvancePointer();
 			}
 		}
-		if (str.cat(c))
+		if (strings.Append(c))
 		{
 			throw ConstructParseException("string too long");
 		}
@@ -9,7 +9,7 @@
 #define SRC_GCODES_GCODEBUFFER_EXPRESSIONPARSER_H_
 
 #include <RepRapFirmware.h>
-#include <General/StringBuffer.h>
+#include "StringArena.h"
 #include <ObjectModel/ObjectModel.h>
 #include <GCodes/GCodeException.h>
 
@@ -36,9 +36,11 @@ private:
 	ExpressionValue ParseExpectKet(bool evaluate, char expectedKet) THROWS(GCodeException);
 	ExpressionValue ParseNumber() noexcept
 		pre(readPointer >= 0; isdigit(gb.buffer[readPointer]));
-	ExpressionValue ParseIdentifierExpression(bool evaluate, bool applyLengthOperator) THROWS(GCodeException)
+	ExpressionValue ParseBracedExpression(bool evaluate, ArrayAggregator *null aggregator) THROWS(GCodeException);
+	ExpressionValue ParseIdentifierExpression(bool evaluate, bool applyLengthOperator, ArrayAggregator *null aggregator) THROWS(GCodeException)
 		pre(readPointer >= 0; isalpha(gb.buffer[readPointer]));
-	void ParseQuotedString(const StringRef& str) THROWS(GCodeException);
+	void ParseQuotedString() THROWS(GCodeException);
+	ExpressionValue GetVariableValue(const char *name, bool isGlobal, bool evaluate) THROWS(GCodeException);
 
 	void ConvertToFloat(ExpressionValue& val, bool evaluate) const THROWS(GCodeException);
 	void ConvertToBool(ExpressionValue& val, bool evaluate) const THROWS(GCodeException);
@@ -59,8 +61,9 @@ private:
 	const char * const endp;
 	const GCodeBuffer& gb;
 	int column;
-	char stringBufferStorage[StringBufferLength];
-	StringBuffer stringBuffer;
+	ArrayAggregator *currentAggregator;						// set when we are about to parse the argument of an aggregate function
+	StringArena strings;									// storage for the strings we create, which is released when this parser is destroyed,
+															// so callers must copy any string result they keep (see StringParser::ParseVariableValue)
 };
 
 #endif /* SRC_GCODES_GCODEBUFFER_EXPRESSIONPARSER_H_ */
@@ -292,6 +292,7 @@ void GCodeBuffer::StartNewFile() noexcept
 	machineState->SetFileExecuting();
 #endif
 	machineState->lineNumber = 0;						// reset line numbering when M32 is run
+	machineState->variables.Clear();					// local variables don't survive from one file to the next
 	IF_NOT_BINARY(stringParser.StartNewFile());
 }
 
@@ -730,6 +731,7 @@ bool GCodeBuffer::PopState(bool withinSameFile) noexcept
 	if (withinSameFile)
 	{
 		machineState->lineNumber = ms->lineNumber;
+		machineState->variables.TransferFrom(ms->variables);
 	}
 	delete ms;
 
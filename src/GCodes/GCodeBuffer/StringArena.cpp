@@ -0,0 +1,196 @@
+/*
+ * StringArena.cpp
+ *
+ *  Created on: 7 Oct 2020
+ *      Author: David
+ */
+
+#include "StringArena.h"
+#include <RTOSIface/RTOSIface.h>
+
+StringArena::Block *StringArena::freeBlocks = nullptr;
+
+static_assert(MaxStringArenaSize >= StringArenaBlockSize);
+
+StringArena::~StringArena() noexcept
+{
+	while (currentBlock != nullptr)
+	{
+		Block * const b = currentBlock;
+		currentBlock = b->next;
+		ReleaseBlock(b);
+	}
+}
+
+// Get a block with the specified amount of storage. Blocks of the standard size are recycled.
+/*static*/ StringArena::Block *StringArena::AllocateBlock(size_t size) noexcept
+{
+	if (size == StringArenaBlockSize)
+	{
+		TaskCriticalSectionLocker lock;
+		Block * const b = freeBlocks;
+		if (b != nullptr)
+		{
+			freeBlocks = b->next;
+			return b;
+		}
+	}
+
+	Block * const b = reinterpret_cast<Block*>(new char[sizeof(Block) + size]);
+	b->size = size;
+	return b;
+}
+
+/*static*/ void StringArena::ReleaseBlock(Block *b) noexcept
+{
+	if (b->size == StringArenaBlockSize)
+	{
+		TaskCriticalSectionLocker lock;
+		b->next = freeBlocks;
+		freeBlocks = b;
+	}
+	else
+	{
+		delete[] reinterpret_cast<char*>(b);
+	}
+}
+
+// Make sure there is space to append the specified number of characters and a null terminator to the latest string.
+// If there isn't room in the current block then we start a new one and move the latest string to it. Earlier strings stay where they are.
+bool StringArena::Reserve(size_t numChars) noexcept
+{
+	if (currentBlock != nullptr && used + numChars < currentBlock->size)
+	{
+		return false;
+	}
+
+	const size_t latestLength = used - latestStart;
+	const size_t needed = latestLength + numChars + 1;
+	size_t blockSize = max<size_t>(needed * 2, StringArenaBlockSize);	// allow the latest string to grow further without moving it again
+	if (totalAllocated + blockSize > MaxStringArenaSize)
+	{
+		if (totalAllocated + needed > MaxStringArenaSize)
+		{
+			return true;
+		}
+		blockSize = MaxStringArenaSize - totalAllocated;				// this may be smaller than a standard block, so AllocateBlock must not round it up
+	}
+
+	Block * const b = AllocateBlock(blockSize);
+	totalAllocated += b->size;
+	if (latestLength != 0)
+	{
+		memcpy(b->Data(), LatestData(), latestLength);
+	}
+	b->next = currentBlock;
+	currentBlock = b;
+	latestStart = 0;
+	used = latestLength;
+	b->Data()[used] = 0;
+	lastFixed = nullptr;												// it is no longer in the current block so it can't be reopened
+	return false;
+}
+
+bool StringArena::Append(char c) noexcept
+{
+	if (Reserve(1))
+	{
+		return true;
+	}
+	char * const p = currentBlock->Data() + used;
+	p[0] = c;
+	p[1] = 0;
+	++used;
+	return false;
+}
+
+bool StringArena::Append(const char *s, size_t len) noexcept
+{
+	if (Reserve(len))
+	{
+		return true;
+	}
+	char * const p = currentBlock->Data() + used;
+	memcpy(p, s, len);
+	p[len] = 0;
+	used += len;
+	return false;
+}
+
+StringRef StringArena::GetLatestRef() noexcept
+{
+	return StringRef(LatestData(), currentBlock->size - latestStart);
+}
+
+void StringArena::LatestUpdated() noexcept
+{
+	used = latestStart + strlen(LatestData());
+}
+
+void StringArena::ClearLatest() noexcept
+{
+	if (currentBlock != nullptr)
+	{
+		used = latestStart;
+		currentBlock->Data()[used] = 0;
+	}
+}
+
+// Terminate the latest string and return a pointer to it
+const char *StringArena::Fix() noexcept
+{
+	if (Reserve(0))
+	{
+		return nullptr;
+	}
+	const char * const rslt = LatestData();
+	currentBlock->Data()[used] = 0;
+	++used;
+	latestStart = used;
+	lastFixed = rslt;
+	return rslt;
+}
+
+// Return the concatenation of two strings, avoiding copying either of them where possible
+const char *StringArena::Concat(const char *s1, const char *s2) noexcept
+{
+	if (used == latestStart && lastFixed != nullptr)
+	{
+		if (s1 == lastFixed)
+		{
+			// The first string is the most recent one, so reopen it and append the second string to it.
+			// The second string can't be located after it in the arena, so it won't be overwritten.
+			latestStart = s1 - currentBlock->Data();
+			used = latestStart + strlen(s1);
+			lastFixed = nullptr;
+			return (Append(s2)) ? nullptr : Fix();
+		}
+
+		if (s2 == lastFixed && s1 >= currentBlock->Data() && s1 < s2 && s2 == s1 + strlen(s1) + 1)
+		{
+			// The two strings are adjacent, so just remove the terminator between them
+			const size_t len2 = used - (s2 - currentBlock->Data()) - 1;
+			memmove(const_cast<char*>(s2) - 1, s2, len2 + 1);
+			--used;
+			latestStart = used;
+			lastFixed = s1;
+			return s1;
+		}
+	}
+
+	ClearLatest();
+	return (Append(s1) || Append(s2)) ? nullptr : Fix();
+}
+
+// Release the storage for a string that is no longer needed, if it is the most recent one
+void StringArena::FinishedUsing(const char *s) noexcept
+{
+	if (s == lastFixed && used == latestStart)
+	{
+		latestStart = used = s - currentBlock->Data();
+		currentBlock->Data()[used] = 0;
+		lastFixed = nullptr;
+	}
+}
+
+// End
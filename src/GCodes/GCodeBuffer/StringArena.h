@@ -0,0 +1,62 @@
+/*
+ * StringArena.h
+ *
+ *  Created on: 7 Oct 2020
+ *      Author: David
+ */
+
+#ifndef SRC_GCODES_GCODEBUFFER_STRINGARENA_H_
+#define SRC_GCODES_GCODEBUFFER_STRINGARENA_H_
+
+#include <RepRapFirmware.h>
+
+// Scratch storage for the strings created while evaluating an expression.
+// Storage is taken from a shared pool of blocks only when the first string is created and is all returned when the arena is destroyed,
+// so parsing numeric parameters costs nothing and long strings are not limited to the size of a fixed buffer.
+// Strings are built one at a time at the end of the arena and then fixed. The most recent string can be extended in place,
+// which makes repeated concatenation linear in the length of the result.
+// Because the storage is returned when the arena is destroyed, anything that keeps a string result beyond that must copy it first.
+class StringArena
+{
+public:
+	StringArena() noexcept : currentBlock(nullptr), used(0), latestStart(0), lastFixed(nullptr), totalAllocated(0) { }
+	~StringArena() noexcept;
+
+	bool Append(char c) noexcept;										// append a character to the latest string, returning true if out of space
+	bool Append(const char *s, size_t len) noexcept;					// append characters to the latest string, returning true if out of space
+	bool Append(const char *s) noexcept { return Append(s, strlen(s)); }
+	bool Reserve(size_t numChars) noexcept;								// make space for this many more characters, returning true if out of space
+	StringRef GetLatestRef() noexcept									// get a reference to the latest string, after calling Reserve
+		pre(currentBlock != nullptr);
+	void LatestUpdated() noexcept;										// call this after writing to a reference returned by GetLatestRef
+	void ClearLatest() noexcept;
+	const char *null Fix() noexcept;									// terminate the latest string and return a pointer to it, or null if out of space
+	const char *null Concat(const char *s1, const char *s2) noexcept;	// return the concatenation of two strings, or null if out of space
+	void FinishedUsing(const char *s) noexcept;							// release the string if it is the most recent one
+
+private:
+	struct Block
+	{
+		Block *next;
+		size_t size;													// the number of characters of storage that follow this header
+
+		char *Data() noexcept { return reinterpret_cast<char*>(this + 1); }
+	};
+
+	StringArena(const StringArena&) = delete;
+
+	char *LatestData() noexcept { return currentBlock->Data() + latestStart; }
+
+	static Block *AllocateBlock(size_t size) noexcept;
+	static void ReleaseBlock(Block *b) noexcept;
+
+	static Block *freeBlocks;											// blocks of the standard size that are free for reuse
+
+	Block *currentBlock;												// the block holding the latest string, linked to the blocks allocated earlier
+	size_t used;														// number of characters used in the current block, excluding the terminator of the latest string
+	size_t latestStart;													// offset of the latest string in the current block
+	const char *lastFixed;												// the most recently fixed string if it is still in the current block
+	size_t totalAllocated;												// total block storage owned by this arena
+};
+
+#endif /* SRC_GCODES_GCODEBUFFER_STRINGARENA_H_ */
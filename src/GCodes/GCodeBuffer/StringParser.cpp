@@ -428,18 +428,15 @@ bool StringParser::ProcessConditionalGCode(const StringRef& reply, BlockType ski
 			break;
 
 		case 3:
-			if (doingFile)
+			if (doingFile && StringStartsWith(command, "var"))
 			{
-				if (StringStartsWith(command, "var"))
-				{
-					ProcessVarCommand();
-					return true;
-				}
-				if (StringStartsWith(command, "set"))
-				{
-					ProcessSetCommand();
-					return true;
-				}
+				ProcessVarCommand();
+				return true;
+			}
+			if (StringStartsWith(command, "set"))
+			{
+				ProcessSetCommand();
+				return true;
 			}
 			break;
 
@@ -489,6 +486,14 @@ bool StringParser::ProcessConditionalGCode(const StringRef& reply, BlockType ski
 			}
 			break;
 
+		case 6:
+			if (StringStartsWith(command, "global"))
+			{
+				ProcessGlobalCommand();
+				return true;
+			}
+			break;
+
 		case 8:
 			if (doingFile && StringStartsWith(command, "continue"))
 			{
@@ -610,20 +615,129 @@ void StringParser::ProcessContinueCommand()
 	gb.RestartFrom(gb.machineState->CurrentBlockState().GetFilePosition());
 }
 
-void StringParser::ProcessVarCommand()
+// Parse the '=' and expression that follow the name of a variable being created or assigned, check that we can store the result in a variable,
+// and pass it to 'store'. We call 'store' while the expression parser still exists, because a string result may be held in the parser's storage.
+// Variables take their own copies of strings, so the length of a string value is not limited.
+template<class F> void StringParser::ParseVariableValue(F store) THROWS(GCodeException)
 {
-#if 0
 	SkipWhiteSpace();
+	if (gb.buffer[readPointer] != '=')
+	{
+		throw ConstructParseException("expected '='");
+	}
+	++readPointer;
+
+	ExpressionParser parser(gb, gb.buffer + readPointer, gb.buffer + ARRAY_SIZE(gb.buffer), commandIndent + readPointer);
+	ExpressionValue ev = parser.Parse();
+	parser.CheckForExtraCharacters();
+	readPointer = parser.GetEndptr() - gb.buffer;
+
+	String<StringLength100> stringValue;
+	switch (ev.GetType())
+	{
+	case TypeCode::ObjectModel:
+	case TypeCode::Array:
+		throw ConstructParseException("cannot store an object or array in a variable");
+
+	default:
+		if (!Variable::CanStore(ev.GetType()))
+		{
+			// Convert it to a string while we still can, e.g. the system directory
+			ev.AppendAsString(stringValue.GetRef());
+			ev.Set(stringValue.c_str());
+		}
+		break;
+	}
+	store(ev);
+}
+
+// Create a local variable. The syntax is: var <name> = <expression>
+// The variable goes out of scope at the end of the block in which it was created, or at the end of the macro.
+void StringParser::ProcessVarCommand()
+{
 	String<MaxVariableNameLength> varName;
-	ParseIdentifier(varName.GetRef());
-	qq;
-#endif
-	throw ConstructParseException("'var' not implemented");
+	ParseVariableName(varName.GetRef(), false);
+	if (gb.machineState->variables.Lookup(varName.c_str()) != nullptr)
+	{
+		throw ConstructParseException("variable '%s' already exists", varName.c_str());
+	}
+
+	ParseVariableValue([this, &varName](const ExpressionValue& ev)
+						{
+							gb.machineState->variables.Insert(varName.c_str(), ev, gb.machineState->blockNesting);
+						});
+}
+
+// Create a global variable. The syntax is: global <name> = <expression>
+void StringParser::ProcessGlobalCommand()
+{
+	String<MaxVariableNameLength> varName;
+	ParseVariableName(varName.GetRef(), false);
+
+	ParseVariableValue([this, &varName](const ExpressionValue& ev)
+						{
+							if (!reprap.GetGCodes().CreateGlobalVariable(varName.c_str(), ev))
+							{
+								throw ConstructParseException("global variable '%s' already exists", varName.c_str());
+							}
+						});
 }
 
+// Assign a new value to an existing variable. The syntax is: set var.<name> = <expression> or set global.<name> = <expression>
 void StringParser::ProcessSetCommand()
 {
-	throw ConstructParseException("'set' not implemented");
+	String<MaxVariableNameLength> varName;
+	ParseVariableName(varName.GetRef(), true);
+
+	if (StringStartsWith(varName.c_str(), "var."))
+	{
+		Variable * const v = gb.machineState->variables.Lookup(varName.c_str() + strlen("var."));
+		if (v == nullptr)
+		{
+			throw ConstructParseException("unknown variable '%s'", varName.c_str());
+		}
+		ParseVariableValue([v](const ExpressionValue& ev) { v->Assign(ev); });
+	}
+	else if (StringStartsWith(varName.c_str(), "global."))
+	{
+		ParseVariableValue([this, &varName](const ExpressionValue& ev)
+							{
+								if (!reprap.GetGCodes().AssignGlobalVariable(varName.c_str() + strlen("global."), ev))
+								{
+									throw ConstructParseException("unknown variable '%s'", varName.c_str());
+								}
+							});
+	}
+	else
+	{
+		throw ConstructParseException("expected a variable name starting with 'var.' or 'global.'");
+	}
+}
+
+// Parse the name of a variable following a 'var', 'global' or 'set' command
+// If allowPrefix is true then the name must have a single 'var.' or 'global.' prefix
+void StringParser::ParseVariableName(const StringRef& varName, bool allowPrefix) THROWS(GCodeException)
+{
+	SkipWhiteSpace();
+	if (!isalpha(gb.buffer[readPointer]))
+	{
+		throw ConstructParseException("expected a variable name");
+	}
+
+	bool seenDot = false;
+	char c;
+	while (isalpha((c = gb.buffer[readPointer])) || isdigit(c) || c == '_' || (c == '.' && allowPrefix && !seenDot))
+	{
+		if (c == '.')
+		{
+			seenDot = true;
+		}
+		if (varName.cat(c))
+		{
+			throw ConstructParseException("variable name too long");
+		}
+		++readPointer;
+	}
 }
 
 void StringParser::ProcessAbortCommand(const StringRef& reply) noexcept
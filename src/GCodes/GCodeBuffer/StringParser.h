@@ -115,6 +115,9 @@ private:
 	void ProcessContinueCommand() THROWS(GCodeException);
 	void ProcessVarCommand() THROWS(GCodeException);
 	void ProcessSetCommand() THROWS(GCodeException);
+	void ProcessGlobalCommand() THROWS(GCodeException);
+	void ParseVariableName(const StringRef& varName, bool allowPrefix) THROWS(GCodeException);
+	template<class F> void ParseVariableValue(F store) THROWS(GCodeException);
 	void ProcessAbortCommand(const StringRef& reply) noexcept;
 	void ProcessEchoCommand(const StringRef& reply) THROWS(GCodeException);
 
@@ -59,6 +59,7 @@ GCodeMachineState::GCodeMachineState(GCodeMachineState& prev, bool withinSameFil
 		{
 			blockStates[i] = prev.blockStates[i];
 		}
+		variables.TransferFrom(prev.variables);		// PopState gives them back
 	}
 	else
 	{
@@ -243,6 +244,7 @@ void GCodeMachineState::EndBlock() noexcept
 {
 	if (blockNesting != 0)
 	{
+		variables.EndScope(blockNesting);			// local variables created in this block go out of scope
 		--blockNesting;
 	}
 }
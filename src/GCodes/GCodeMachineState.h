@@ -13,6 +13,7 @@
 #include <General/FreelistManager.h>
 #include <General/NamedEnum.h>
 #include <GCodes/GCodeResult.h>
+#include <ObjectModel/Variable.h>
 
 // Enumeration to list all the possible states that the Gcode processing machine may be in
 enum class GCodeState : uint8_t
@@ -191,6 +192,7 @@ public:
 #endif
 	ResourceBitmap lockedResources;
 	BlockState blockStates[MaxBlockIndent];
+	VariableSet variables;						// local variables created by 'var' commands in this macro
 	uint32_t lineNumber;
 
 	uint16_t
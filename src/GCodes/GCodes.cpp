@@ -33,6 +33,7 @@
 #include "Scanner.h"
 #include "PrintMonitor.h"
 #include "RepRap.h"
+#include "StatusSnapshot.h"
 #include "Tasks.h"
 #include "Tools/Tool.h"
 #include "Endstops/ZProbe.h"
@@ -55,6 +56,8 @@ void GCodes::CommandEmergencyStop(UARTClass *p) noexcept
 }
 #endif
 
+ReadWriteLock GCodes::globalVariablesLock;
+
 GCodes::GCodes(Platform& p) noexcept :
 #if HAS_AUX_DEVICES && ALLOW_ARBITRARY_PANELDUE_PORT
 	serialChannelForPanelDueFlashing(1),
@@ -2642,7 +2645,7 @@ bool GCodes::DoFileMacro(GCodeBuffer& gb, const char* fileName, bool reportMissi
 #endif
 	{
 #if HAS_MASS_STORAGE
-		FileStore * const f = platform.OpenSysFile(fileName, OpenMode::read);
+		FileStore * const f = platform.OpenMacroFile(fileName);
 		if (f == nullptr)
 		{
 			if (reportMissing)
@@ -3115,6 +3118,9 @@ void GCodes::StartPrinting(bool fromStart) noexcept
 #if HAS_MASS_STORAGE
 		fileGCode->OriginalMachineState().fileState.MoveFrom(fileToPrint);
 		fileGCode->GetFileInput()->Reset(fileGCode->OriginalMachineState().fileState);
+# if SUPPORT_FILE_READAHEAD
+		fileGCode->OriginalMachineState().fileState.StartReadahead();
+# endif
 #endif
 	}
 	fileGCode->StartNewFile();
@@ -4442,7 +4448,7 @@ void GCodes::CheckReportDue(GCodeBuffer& gb, const StringRef& reply) const
 			// Send a standard status response for PanelDue
 			OutputBuffer * const statusBuf =
 									(lastAuxStatusReportType == ObjectModelAuxStatusReportType)		// PanelDueFirmware v3.2 or later, using M409 to retrieve object model
-										? reprap.GetModelResponse("", "d99f")
+										? StatusSnapshot::GetModelResponse("", "d99f")
 										: GenerateJsonStatusResponse(lastAuxStatusReportType, -1, ResponseSource::AUX);		// older PanelDueFirmware using M408
 			if (statusBuf != nullptr)
 			{
@@ -4465,7 +4471,7 @@ OutputBuffer *GCodes::GenerateJsonStatusResponse(int type, int seq, ResponseSour
 	{
 		case 0:
 		case 1:
-			statusResponse = reprap.GetLegacyStatusResponse(type + 2, seq);
+			statusResponse = StatusSnapshot::GetLegacyStatusResponse(type + 2, seq);
 			break;
 
 		default:				// need a default clause to prevent the command hanging by always returning a null buffer
@@ -4474,7 +4480,7 @@ OutputBuffer *GCodes::GenerateJsonStatusResponse(int type, int seq, ResponseSour
 		case 2:
 		case 3:
 		case 4:
-			statusResponse = reprap.GetStatusResponse(type - 1, source);
+			statusResponse = StatusSnapshot::GetStatusResponse(type - 1, source);
 			break;
 
 		case 5:
@@ -4611,6 +4617,38 @@ void GCodes::UnlockAll(const GCodeBuffer& gb) noexcept
 	}
 }
 
+// Get read access to the global variables
+ReadLockedPointer<const VariableSet> GCodes::GetGlobalVariablesForReading() const noexcept
+{
+	ReadLocker lock(globalVariablesLock);
+	return ReadLockedPointer<const VariableSet>(lock, &globalVariables);
+}
+
+// Create a global variable, returning false if it already exists
+bool GCodes::CreateGlobalVariable(const char *name, const ExpressionValue& val) noexcept
+{
+	WriteLocker lock(globalVariablesLock);
+	if (globalVariables.Lookup(name) != nullptr)
+	{
+		return false;
+	}
+	globalVariables.Insert(name, val, 0);
+	return true;
+}
+
+// Assign a new value to a global variable, returning false if it doesn't exist
+bool GCodes::AssignGlobalVariable(const char *name, const ExpressionValue& val) noexcept
+{
+	WriteLocker lock(globalVariablesLock);
+	Variable * const v = globalVariables.Lookup(name);
+	if (v == nullptr)
+	{
+		return false;
+	}
+	v->Assign(val);
+	return true;
+}
+
 // Append a list of axes to a string
 void GCodes::AppendAxes(const StringRef& reply, AxesBitmap axes) const noexcept
 {
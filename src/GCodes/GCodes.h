@@ -36,6 +36,7 @@ Licence: GPL
 #include "FilamentMonitors/FilamentMonitor.h"
 #include "RestorePoint.h"
 #include "Movement/BedProbing/Grid.h"
+#include "ObjectModel/Variable.h"
 
 const char feedrateLetter = 'F';						// GCode feedrate
 const char extrudeLetter = 'E'; 						// GCode extrude
@@ -207,6 +208,11 @@ public:
 	int GetNewToolNumber() const noexcept { return newToolNumber; }
 	size_t GetCurrentZProbeNumber() const noexcept { return currentZProbeNumber; }
 
+	// Global variables created by the 'global' command
+	ReadLockedPointer<const VariableSet> GetGlobalVariablesForReading() const noexcept;
+	bool CreateGlobalVariable(const char *name, const ExpressionValue& val) noexcept;	// returns false if the variable already exists
+	bool AssignGlobalVariable(const char *name, const ExpressionValue& val) noexcept;	// returns false if the variable doesn't exist
+
 	// These next two are public because they are used by class LinuxInterface
 	void UnlockAll(const GCodeBuffer& gb) noexcept;								// Release all locks
 	GCodeBuffer *GetGCodeBuffer(GCodeChannel channel) const noexcept { return gcodeSources[channel.ToBaseType()]; }
@@ -504,6 +510,9 @@ private:
 	static Mutex resourceMutex;
 	const GCodeBuffer* resourceOwners[NumResources];					// Which gcode buffer owns each resource
 
+	VariableSet globalVariables;										// Variables created by the 'global' command
+	static ReadWriteLock globalVariablesLock;							// Global variables may be read and written by any input channel
+
 	MachineType machineType;					// whether FFF, laser or CNC
 	bool active;								// Live and running?
 #if HAS_LINUX_INTERFACE
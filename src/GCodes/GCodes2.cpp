@@ -25,6 +25,7 @@
 #include "Scanner.h"
 #include "PrintMonitor.h"
 #include "RepRap.h"
+#include "Telemetry.h"
 #include "Tools/Tool.h"
 #include "Endstops/ZProbe.h"
 #include "FilamentMonitors/FilamentMonitor.h"
@@ -2744,11 +2745,18 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 				bool dummy;
 				gb.TryGetQuotedString('K', key.GetRef(), dummy);
 				gb.TryGetQuotedString('F', flags.GetRef(), dummy);
+				if (strchr(flags.c_str(), 'b') != nullptr)
+				{
+					// G-code replies are text, and the channels they go to (USB, Telnet, PanelDue and other aux devices, HTTP and the SBC) would corrupt binary data
+					reply.copy("binary object model reports are only available using rr_model or the SBC object model request");
+					result = GCodeResult::error;
+					break;
+				}
 				if (&gb == auxGCode)
 				{
 					lastAuxStatusReportType = ObjectModelAuxStatusReportType;
 				}
-				outBuf = reprap.GetModelResponse(key.c_str(), flags.c_str());
+				outBuf = reprap.GetModelResponse(key.c_str(), flags.c_str());	// not from a snapshot, because the G-code may follow commands that changed the model
 				if (outBuf == nullptr)
 				{
 					OutputBuffer::ReleaseAll(outBuf);
@@ -3552,6 +3560,13 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 		case 586: // Configure network protocols
 			if (CheckNetworkCommandAllowed(gb, reply, result))
 			{
+				if (gb.GetCommandFraction() == 4)
+				{
+					// M586.4 configures the MQTT client
+					result = reprap.GetNetwork().ConfigureMqtt(gb, reply);
+					break;
+				}
+
 				const unsigned int interface = (gb.Seen('I') ? gb.GetUIValue() : 0);
 
 				bool seen = false;
@@ -3585,6 +3600,11 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 					}
 				}
 
+				if (result == GCodeResult::ok && (gb.Seen('N') || gb.Seen('B') || gb.Seen('K')))
+				{
+					result = reprap.GetNetwork().ConfigureBuffers(gb, reply);
+					seen = true;
+				}
 
 				if (!seen)
 				{
@@ -3600,6 +3620,7 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 #endif
 					// Default to reporting current protocols if P or S parameter missing
 					result = reprap.GetNetwork().ReportProtocols(interface, reply);
+					reprap.GetNetwork().ReportBuffers(reply);
 				}
 			}
 			break;
@@ -4392,6 +4413,12 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 #endif
 			break;
 
+#if SUPPORT_TELEMETRY
+		case 939: // Configure or report telemetry recording
+			result = Telemetry::Configure(gb, reply, outBuf);
+			break;
+#endif
+
 		case 950:	// configure I/O pins
 			result = platform.ConfigurePort(gb, reply);
 			break;
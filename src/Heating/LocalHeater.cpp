@@ -14,6 +14,10 @@
 #include "RepRap.h"
 #include <Tools/Tool.h>
 
+#if SUPPORT_MQTT
+# include <Networking/MqttClient.h>
+#endif
+
 #define TUNE_WITH_HALF_FAN	0
 
 // Private constants
@@ -953,6 +957,9 @@ void LocalHeater::RaiseHeaterFault(const char *format, ...) noexcept
 		va_start(vargs, format);
 		reprap.GetPlatform().MessageF(ErrorMessage, format, vargs);
 		va_end(vargs);
+#if SUPPORT_MQTT
+		MqttClient::PublishEvent("heaterFault", "{\"heater\":%u}", GetHeaterNumber());
+#endif
 	}
 	reprap.GetGCodes().HandleHeaterFault();
 	reprap.FlagTemperatureFault(GetHeaterNumber());
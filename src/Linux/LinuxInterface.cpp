@@ -18,6 +18,7 @@
 #include "PrintMonitor.h"
 #include "Tools/Filament.h"
 #include "RepRap.h"
+#include "StatusSnapshot.h"
 #include "RepRapFirmware.h"
 #include <Tasks.h>
 #include <Hardware/SoftwareReset.h>
@@ -215,7 +216,7 @@ void LinuxInterface::Init() noexcept
 					transfer.ReadGetObjectModel(packet->length, keyRef, flagsRef);
 					try
 					{
-						OutputBuffer *outBuf = reprap.GetModelResponse(key.c_str(), flags.c_str());
+						OutputBuffer *outBuf = StatusSnapshot::GetModelResponse(key.c_str(), flags.c_str());
 
 						if (outBuf == nullptr || !transfer.WriteObjectModel(outBuf))
 						{
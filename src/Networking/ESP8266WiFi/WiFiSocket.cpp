@@ -264,7 +264,7 @@ void WiFiSocket::ReceiveData(uint16_t bytesAvailable) noexcept
 		}
 		else if (NetworkBuffer::Count(receivedData) < MaxBuffersPerSocket)
 		{
-			NetworkBuffer * const buf = NetworkBuffer::Allocate();
+			NetworkBuffer * const buf = NetworkBuffer::Allocate(protocol, NetworkBuffer::Count(receivedData));
 			if (buf != nullptr)
 			{
 				const size_t maxToRead = min<size_t>(NetworkBuffer::bufferSize, MaxDataLength);
@@ -268,10 +268,13 @@ void FtpResponder::SendPassiveData() noexcept
 	}
 
 	// If we get here then there are no output buffers left to send
+	// As in NetworkResponder::SendData, keep file buffers that the data socket refers to until their data has been acknowledged
+	(void)ReleaseAcknowledgedFileBuffers(dataSocket);
+
 	// If we have a file to send, send it
 	if (fileBeingSent != nullptr && fileBuffer == nullptr)
 	{
-		fileBuffer = NetworkBuffer::Allocate();
+		fileBuffer = NetworkBuffer::Allocate(FtpDataProtocol, NetworkBuffer::Count(unackedFileBuffers));
 		if (fileBuffer == nullptr)
 		{
 			return;					// no buffer available, try again later
@@ -321,6 +324,11 @@ void FtpResponder::SendPassiveData() noexcept
 					}
 					fileBuffer->Release();
 					fileBuffer = nullptr;
+					while (unackedFileBuffers != nullptr)
+					{
+						unackedFileBuffers = unackedFileBuffers->Release();
+					}
+					unackedFileBytes = 0;
 
 					responderState = ResponderState::pasvTransferComplete;
 				}
@@ -328,6 +336,15 @@ void FtpResponder::SendPassiveData() noexcept
 			}
 
 			fileBuffer->Taken(sent);
+			if (fileBuffer->IsEmpty() && dataSocket->SendsByReference())
+			{
+				// The socket may still need this data, so use a new buffer for the next part of the file
+				unackedFileBytes += fileBuffer->BytesTaken();
+				NetworkBuffer::AppendToList(&unackedFileBuffers, fileBuffer);
+				fileBuffer = nullptr;
+				return;
+			}
+
 			if (sent < remaining)
 			{
 				return;
@@ -337,6 +354,25 @@ void FtpResponder::SendPassiveData() noexcept
 
 	// If we get here then there is nothing left to send. Close it as well
 	dataSocket->Send();						// tell the socket there is no more data
+	if (!ReleaseAcknowledgedFileBuffers(dataSocket))
+	{
+		if (dataSocket->CanSend())
+		{
+			return;							// wait until the socket no longer needs the file data
+		}
+
+		// The connection has gone, so terminate it before we release the buffers it refers to
+		sendError = true;
+		dataSocket->Terminate();
+		dataSocket = nullptr;
+		while (unackedFileBuffers != nullptr)
+		{
+			unackedFileBuffers = unackedFileBuffers->Release();
+		}
+		unackedFileBytes = 0;
+		responderState = ResponderState::pasvTransferComplete;
+		return;
+	}
 	dataSocket->Close();
 	dataSocket = nullptr;
 
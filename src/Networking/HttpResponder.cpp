@@ -13,6 +13,8 @@
 #include "Socket.h"
 #include "GCodes/GCodes.h"
 #include "General/IP4String.h"
+#include "StatusSnapshot.h"
+#include "Telemetry.h"
 
 #define KO_START "rr_"
 const size_t KoFirst = 3;
@@ -20,7 +22,7 @@ const size_t KoFirst = 3;
 const char* const overflowResponse = "overflow";
 const char* const badEscapeResponse = "bad escape";
 const char serviceUnavailableResponse[] = "HTTP/1.1 503 Service Unavailable\r\n\r\n";
-static_assert(ARRAY_SIZE(serviceUnavailableResponse) <= OUTPUT_BUFFER_SIZE, "OUTPUT_BUFFER_SIZE too small");
+static_assert(ARRAY_SIZE(serviceUnavailableResponse) <= SMALL_OUTPUT_BUFFER_SIZE, "SMALL_OUTPUT_BUFFER_SIZE too small");
 
 const uint32_t HttpReceiveTimeout = 2000;
 
@@ -36,7 +38,10 @@ const char* const ErrorPagePart2 =
 	"</p>\n"
 	"</body>\n";
 
-HttpResponder::HttpResponder(NetworkResponder *n) noexcept : UploadingNetworkResponder(n)
+HttpResponder::HttpResponder(NetworkResponder *n) noexcept : UploadingNetworkResponder(n), persistent(false)
+#if SUPPORT_OBJECT_MODEL
+	, reportCursor(nullptr), modelWaitOver(false)
+#endif
 {
 }
 
@@ -45,17 +50,8 @@ bool HttpResponder::Accept(Socket *s, NetworkProtocol protocol) noexcept
 {
 	if (responderState == ResponderState::free && protocol == HttpProtocol)
 	{
-		responderState = ResponderState::reading;
 		skt = s;
-		timer = millis();
-
-		// Reset the parse state variables
-		clientPointer = 0;
-		parseState = HttpParseState::doingCommandWord;
-		numCommandWords = 0;
-		numQualKeys = 0;
-		numHeaderKeys = 0;
-		commandWords[0] = clientMessage;
+		StartReadingRequest();
 
 		if (reprap.Debug(moduleWebserver))
 		{
@@ -66,6 +62,21 @@ bool HttpResponder::Accept(Socket *s, NetworkProtocol protocol) noexcept
 	return false;
 }
 
+// Get ready to read a request, either on a new connection or on one we kept open after sending the response to the previous request
+void HttpResponder::StartReadingRequest() noexcept
+{
+	responderState = ResponderState::reading;
+	timer = millis();
+
+	// Reset the parse state variables
+	clientPointer = 0;
+	parseState = HttpParseState::doingCommandWord;
+	numCommandWords = 0;
+	numQualKeys = 0;
+	numHeaderKeys = 0;
+	commandWords[0] = clientMessage;
+}
+
 // Do some work, returning true if we did anything significant
 bool HttpResponder::Spin() noexcept
 {
@@ -76,15 +87,26 @@ bool HttpResponder::Spin() noexcept
 
 	case ResponderState::reading:
 		{
+			// Parse the received data a block at a time. We only mark as taken the data up to the end of the request, so that if the client
+			// has pipelined several requests on this connection then the next one is left in the socket until we have replied to this one.
 			bool readSomething = false;
-			char c;
-			while (skt->ReadChar(c))
+			const uint8_t *data;
+			size_t length;
+			while (skt->ReadBuffer(data, length) && length != 0)
 			{
-				if (CharFromClient(c))
+				for (size_t i = CopyOrdinaryChars(data, length); i < length; i += CopyOrdinaryChars(data + i, length - i))
 				{
-					timer = millis();		// restart the timeout
-					return true;
+					if (CharFromClient((char)data[i++]))
+					{
+						if (skt != nullptr)			// the connection may have been dropped if we ran out of buffers
+						{
+							skt->Taken(i);
+						}
+						timer = millis();	// restart the timeout
+						return true;
+					}
 				}
+				skt->Taken(length);
 				readSomething = true;
 			}
 
@@ -95,9 +117,21 @@ bool HttpResponder::Spin() noexcept
 				return true;
 			}
 
-			if (!skt->CanRead() || millis() - timer >= HttpReceiveTimeout)
+			const bool idle = persistent && clientPointer == 0;
+			if (!skt->CanRead() || millis() - timer >= ((idle) ? HttpKeepAliveTimeout : HttpReceiveTimeout))
 			{
-				ConnectionLost();
+				if (idle && skt->CanRead())
+				{
+					// The client didn't send another request on a connection we kept open, so close it tidily
+					skt->Close();
+					skt = nullptr;
+					responderState = ResponderState::free;
+					ConnectionEnded();
+				}
+				else
+				{
+					ConnectionLost();
+				}
 				return true;
 			}
 
@@ -112,6 +146,24 @@ bool HttpResponder::Spin() noexcept
 		(void)SendFileInfo(millis() - startedProcessingRequestAt >= MaxFileInfoGetTime);
 		return true;
 
+#if SUPPORT_OBJECT_MODEL
+	case ResponderState::waitingForModelChange:
+		if (!skt->CanSend())
+		{
+			ConnectionLost();
+			return true;
+		}
+		if (ModelWaitFinished())
+		{
+			StopWaitingForModel();
+			modelWaitOver = true;
+			SendJsonResponse("model");
+			modelWaitOver = false;
+			return true;
+		}
+		return false;
+#endif
+
 #if HAS_MASS_STORAGE
 	case ResponderState::uploading:
 		DoUpload();
@@ -120,6 +172,14 @@ bool HttpResponder::Spin() noexcept
 
 	case ResponderState::sending:
 		SendData();
+		if (responderState == ResponderState::reading)
+		{
+			StartReadingRequest();			// we kept the connection open, so get ready for the next request
+		}
+		else if (responderState == ResponderState::free)
+		{
+			ConnectionEnded();
+		}
 		return true;
 
 	default:	// should not happen
@@ -127,6 +187,34 @@ bool HttpResponder::Spin() noexcept
 	}
 }
 
+// Copy the characters at the start of the data that CharFromClient would just append to the message in the current parse state,
+// returning how many we copied. Most of a request is made of such characters, so this saves calling CharFromClient for each one.
+// We stop one short of the end of clientMessage, so that CharFromClient still detects overflow.
+size_t HttpResponder::CopyOrdinaryChars(const uint8_t *data, size_t length) noexcept
+{
+	const char *specialChars;
+	switch (parseState)
+	{
+	case HttpParseState::doingCommandWord:		specialChars = "\r\n \t"; break;
+	case HttpParseState::doingFilename:			specialChars = "\r\n \t?%"; break;
+	case HttpParseState::doingQualifierKey:		specialChars = "\r\n \t=%&"; break;
+	case HttpParseState::doingQualifierValue:	specialChars = "\r\n \t%&+"; break;
+	case HttpParseState::doingHeaderKey:		specialChars = "\r\n:"; break;
+	case HttpParseState::doingHeaderValue:		specialChars = "\r\n"; break;
+	default:									return 0;
+	}
+
+	const size_t limit = min<size_t>(length, ARRAY_SIZE(clientMessage) - 1 - clientPointer);
+	size_t n = 0;
+	while (n < limit && strchr(specialChars, (char)data[n]) == nullptr)		// a null character counts as special because strchr finds the terminator
+	{
+		++n;
+	}
+	memcpy(clientMessage + clientPointer, data, n);
+	clientPointer += n;
+	return n;
+}
+
 // Process a character from the client
 // Rewritten as a state machine by dc42 to increase capability and speed, and reduce RAM requirement.
 // On entry:
@@ -453,7 +541,7 @@ bool HttpResponder::CharFromClient(char c) noexcept
 // This may also return true with response == nullptr if we tried to generate a response but ran out of buffers.
 bool HttpResponder::GetJsonResponse(const char* request, OutputBuffer *&response, bool& keepOpen) noexcept
 {
-	keepOpen = false;	// assume we don't want to persist the connection
+	keepOpen = true;	// assume the connection may persist if the client wants it to
 	const char *parameter;
 	if (StringEqualsIgnoreCase(request, "connect") && (parameter = GetKeyValue("password")) != nullptr)
 	{
@@ -515,13 +603,13 @@ bool HttpResponder::GetJsonResponse(const char* request, OutputBuffer *&response
 			}
 
 			OutputBuffer::ReleaseAll(response);
-			response = reprap.GetStatusResponse(type, ResponseSource::HTTP);		// this may return nullptr
+			response = StatusSnapshot::GetStatusResponse(type, ResponseSource::HTTP);		// this may return nullptr
 		}
 		else
 		{
 			// Deprecated
 			OutputBuffer::ReleaseAll(response);
-			response = reprap.GetLegacyStatusResponse(1, 0);
+			response = StatusSnapshot::GetLegacyStatusResponse(1, 0);
 		}
 	}
 	else if (StringEqualsIgnoreCase(request, "gcode"))
@@ -539,6 +627,7 @@ bool HttpResponder::GetJsonResponse(const char* request, OutputBuffer *&response
 	else if (StringEqualsIgnoreCase(request, "upload"))
 	{
 		response->printf("{\"err\":%d}", (uploadError) ? 1 : 0);
+		keepOpen = false;	// if the upload failed then some of the data may still be waiting to be read
 	}
 	else if (StringEqualsIgnoreCase(request, "delete") && (parameter = GetKeyValue("name")) != nullptr)
 	{
@@ -625,7 +714,25 @@ bool HttpResponder::GetJsonResponse(const char* request, OutputBuffer *&response
 		OutputBuffer::ReleaseAll(response);
 		const char *const filterVal = GetKeyValue("key");
 		const char *const flagsVal = GetKeyValue("flags");
-		response = reprap.GetModelResponse(filterVal, flagsVal);
+		if (!modelWaitOver && StartWaitingForModel(filterVal, flagsVal))
+		{
+			return false;
+		}
+		if (StartModelReport(filterVal, flagsVal))
+		{
+			return false;
+		}
+		response = StatusSnapshot::GetModelResponse(filterVal, flagsVal);
+	}
+#endif
+#if SUPPORT_TELEMETRY
+	else if (StringEqualsIgnoreCase(request, "telemetry"))
+	{
+		const char *const tierVal = GetKeyValue("tier");
+		const char *const channelVal = GetKeyValue("channel");
+		const uint32_t tier = (tierVal == nullptr) ? 0 : StrToU32(tierVal);
+		OutputBuffer::ReleaseAll(response);
+		response = Telemetry::GetJsonResponse(min<uint32_t>(tier, NumTelemetryTiers - 1), (channelVal == nullptr) ? -1 : (int)StrToI32(channelVal));
 	}
 #endif
 	else if (StringEqualsIgnoreCase(request, "config"))
@@ -654,6 +761,18 @@ const char* HttpResponder::GetKeyValue(const char *key) const noexcept
 	return nullptr;
 }
 
+const char* HttpResponder::GetHeaderValue(const char *key) const noexcept
+{
+	for (size_t i = 0; i < numHeaderKeys; ++i)
+	{
+		if (StringEqualsIgnoreCase(headers[i].key, key))
+		{
+			return headers[i].value;
+		}
+	}
+	return nullptr;
+}
+
 // Called to process a FileInfo request, which may take several calls
 // Return true if complete
 bool HttpResponder::SendFileInfo(bool quitEarly) noexcept
@@ -671,7 +790,8 @@ bool HttpResponder::SendFileInfo(bool quitEarly) noexcept
 					);
 		outBuf->catf("Content-Length: %u\r\n", (jsonResponse != nullptr) ? jsonResponse->Length() : 0);
 		AddCorsHeader();
-		outBuf->cat("Connection: close\r\n\r\n");
+		const bool keepOpen = KeepAlive();
+		outBuf->catf("Connection: %s\r\n\r\n", (keepOpen) ? "keep-alive" : "close");
 		outBuf->Append(jsonResponse);
 		if (outBuf->HadOverflow())
 		{
@@ -682,7 +802,7 @@ bool HttpResponder::SendFileInfo(bool quitEarly) noexcept
 		else
 		{
 			filenameBeingProcessed.Clear();
-			Commit();
+			Commit((keepOpen) ? ResponderState::reading : ResponderState::free);
 		}
 	}
 	return gotFileInfo;
@@ -755,6 +875,36 @@ bool HttpResponder::RemoveAuthentication() noexcept
 	}
 }
 
+#if HAS_MASS_STORAGE
+
+// Return true if the name of a file contains a content hash, e.g. app.3f2a9c1b.js or chunk-vendors.3f2a9c1b.css.
+// We look for a part of the name between two dots that is 8, 16 or 20 hex digits long, which are the lengths that bundlers such as webpack use,
+// and that includes at least one of the letters a-f so that dates and version numbers such as app.20201019.js are not mistaken for hashes.
+static bool HasContentHash(const char *fileName) noexcept
+{
+	const char *p = strrchr(fileName, '/');
+	p = (p == nullptr) ? strchr(fileName, '.') : strchr(p, '.');
+	while (p != nullptr)
+	{
+		++p;
+		size_t numHexDigits = 0;
+		bool hadLetter = false;
+		while (isxdigit(p[numHexDigits]))
+		{
+			hadLetter = hadLetter || !isdigit(p[numHexDigits]);
+			++numHexDigits;
+		}
+		if ((numHexDigits == 8 || numHexDigits == 16 || numHexDigits == 20) && hadLetter && p[numHexDigits] == '.')
+		{
+			return true;
+		}
+		p = strchr(p, '.');
+	}
+	return false;
+}
+
+#endif
+
 void HttpResponder::SendFile(const char* nameOfFileToSend, bool isWebFile) noexcept
 {
 #if HAS_MASS_STORAGE
@@ -849,12 +999,55 @@ void HttpResponder::SendFile(const char* nameOfFileToSend, bool isWebFile) noexc
 		}
 	}
 
-	fileBeingSent = fileToSend;
-	outBuf->copy("HTTP/1.1 200 OK\r\n");
+	if (isWebFile)
+	{
+		// Web files may be cached by the browser. Build the ETag from the file size and last modified time, and if the browser already has
+		// the current version then tell it so instead of sending the file. The ETag includes whether we send the gzipped version because that is
+		// a different representation. We don't send Last-Modified, because FAT file times are local time and we don't know the time zone, so we
+		// can't give the time in GMT as HTTP requires. Browsers revalidate using If-None-Match instead.
+		time_t lastModified = 0;
+		String<MaxFilenameLength> location;
+		if (MassStorage::CombineName(location.GetRef(), GetPlatform().GetWebDir(), nameOfFileToSend))
+		{
+			if (zip)
+			{
+				location.cat(".gz");
+			}
+			lastModified = MassStorage::GetLastModifiedTime(location.c_str());
+		}
+		String<StringLength50> eTag;
+		eTag.printf("\"%08" PRIx32 "-%08" PRIx32 "%s\"", (uint32_t)fileToSend->Length(), (uint32_t)lastModified, (zip) ? "-gz" : "");
+
+		const char * const ifNoneMatch = GetHeaderValue("If-None-Match");
+		const bool notModified = (ifNoneMatch != nullptr && strstr(ifNoneMatch, eTag.c_str()) != nullptr);
+		if (notModified)
+		{
+			fileToSend->Close();
+			outBuf->copy("HTTP/1.1 304 Not Modified\r\n");
+		}
+		else
+		{
+			fileBeingSent = fileToSend;
+			outBuf->copy("HTTP/1.1 200 OK\r\n");
+		}
+
+		// Files whose names contain a content hash never change, so they can be cached indefinitely. Other files must be revalidated.
+		outBuf->cat((HasContentHash(nameOfFileToSend)) ? "Cache-Control: max-age=31536000, immutable\r\n" : "Cache-Control: no-cache\r\n");
+		outBuf->catf("ETag: %s\r\n", eTag.c_str());
 
-	// Don't cache files served by rr_download
-	if (!isWebFile)
+		if (notModified)
+		{
+			const bool keepOpen = KeepAlive();
+			outBuf->catf("Connection: %s\r\n\r\n", (keepOpen) ? "keep-alive" : "close");
+			Commit((keepOpen) ? ResponderState::reading : ResponderState::free);
+			return;
+		}
+	}
+	else
 	{
+		// Don't cache files served by rr_download
+		fileBeingSent = fileToSend;
+		outBuf->copy("HTTP/1.1 200 OK\r\n");
 		outBuf->cat(	"Cache-Control: no-cache, no-store, must-revalidate\r\n"
 						"Pragma: no-cache\r\n"
 						"Expires: 0\r\n"
@@ -904,8 +1097,9 @@ void HttpResponder::SendFile(const char* nameOfFileToSend, bool isWebFile) noexc
 	}
 
 	outBuf->catf("Content-Length: %lu\r\n", fileToSend->Length());
-	outBuf->cat("Connection: close\r\n\r\n");
-	Commit();
+	const bool keepOpen = KeepAlive();
+	outBuf->catf("Connection: %s\r\n\r\n", (keepOpen) ? "keep-alive" : "close");
+	Commit((keepOpen) ? ResponderState::reading : ResponderState::free);
 #else
 	RejectMessage("file not found", 404);
 #endif
@@ -948,7 +1142,7 @@ void HttpResponder::SendGCodeReply() noexcept
 					);
 		outBuf->catf("Content-Length: %u\r\n", gcodeReply.DataLength());
 		AddCorsHeader();
-		outBuf->cat("Connection: close\r\n\r\n");
+		outBuf->catf("Connection: %s\r\n\r\n", (KeepAlive()) ? "keep-alive" : "close");
 		outStack.Append(gcodeReply);
 
 		// Possibly clean up the G-code reply once again
@@ -958,7 +1152,7 @@ void HttpResponder::SendGCodeReply() noexcept
 		}
 	}
 
-	Commit();
+	Commit((persistent) ? ResponderState::reading : ResponderState::free);
 }
 
 // Send a JSON response to the current command. outBuf is non-null on entry.
@@ -1024,20 +1218,7 @@ void HttpResponder::SendJsonResponse(const char* command) noexcept
 	}
 
 	// Send the JSON response
-	bool keepOpen = false;
-	if (mayKeepOpen)
-	{
-		// Check that the browser wants to persist the connection too
-		for (size_t i = 0; i < numHeaderKeys; ++i)
-		{
-			if (StringEqualsIgnoreCase(headers[i].key, "Connection"))
-			{
-				// Comment out the following line to disable persistent connections
-				keepOpen = StringEqualsIgnoreCase(headers[i].value, "keep-alive");
-				break;
-			}
-		}
-	}
+	const bool keepOpen = mayKeepOpen && KeepAlive();
 
 	// Note that when using RTOS the following response should preferably be small enough to fit in a single buffer.
 	// This is because the current task may get suspended e.g. when reading from SD card to build a file list,
@@ -1048,8 +1229,8 @@ void HttpResponder::SendJsonResponse(const char* command) noexcept
 					"Cache-Control: no-cache, no-store, must-revalidate\r\n"
 					"Pragma: no-cache\r\n"
 					"Expires: 0\r\n"
-					"Content-Type: application/json\r\n"
 				);
+	outBuf->catf("Content-Type: %s\r\n", (StringEqualsIgnoreCase(command, "model") && WantBinaryModel()) ? "application/cbor" : "application/json");
 	const unsigned int replyLength = (jsonResponse != nullptr) ? jsonResponse->Length() : 0;
 	outBuf->catf("Content-Length: %u\r\n", replyLength);
 	AddCorsHeader();
@@ -1143,7 +1324,8 @@ void HttpResponder::ProcessRequest() noexcept
 				outBuf->catf("Access-Control-Allow-Headers: Content-Type\r\n");
 				AddCorsHeader();
 			}
-			outBuf->cat("\r\n");
+			const bool keepOpen = KeepAlive();
+			outBuf->catf("Connection: %s\r\n\r\n", (keepOpen) ? "keep-alive" : "close");
 			if (outBuf->HadOverflow())
 			{
 				OutputBuffer::ReleaseAll(outBuf);
@@ -1151,7 +1333,7 @@ void HttpResponder::ProcessRequest() noexcept
 			}
 			else
 			{
-				Commit();
+				Commit((keepOpen) ? ResponderState::reading : ResponderState::free);
 			}
 			return;
 		}
@@ -1167,23 +1349,15 @@ void HttpResponder::ProcessRequest() noexcept
 				if (filename != nullptr)
 				{
 					// See how many bytes we expect to read
-					bool contentLengthFound = false;
-					for (size_t i = 0; i < numHeaderKeys; i++)
-					{
-						if (StringEqualsIgnoreCase(headers[i].key, "Content-Length"))
-						{
-							postFileLength = StrToU32(headers[i].value);
-							contentLengthFound = true;
-							break;
-						}
-					}
+					const char * const contentLength = GetHeaderValue("Content-Length");
 
 					// Start POST file upload
-					if (!contentLengthFound)
+					if (contentLength == nullptr)
 					{
 						RejectMessage("invalid POST upload request");
 						return;
 					}
+					postFileLength = StrToU32(contentLength);
 
 					// Try to get the expected CRC
 					const char* const expectedCrc = GetKeyValue("crc32");
@@ -1253,8 +1427,8 @@ void HttpResponder::ProcessRequest() noexcept
 	}
 	else
 	{
-		// No output buffers available. Ideally we would wait for one with timeout. For now we just quit.
-		responderState = ResponderState::free;
+		// No output buffers available. Ideally we would wait for one with timeout. For now we just drop the connection.
+		ConnectionLost();
 	}
 }
 
@@ -1276,8 +1450,8 @@ void HttpResponder::RejectMessage(const char* response, unsigned int code) noexc
 	}
 	else
 	{
-		// No output buffers available. Ideally we would wait for one with timeout. For now we just quit.
-		responderState = ResponderState::free;
+		// No output buffers available. Ideally we would wait for one with timeout. For now we just drop the connection.
+		ConnectionLost();
 	}
 }
 
@@ -1375,6 +1549,201 @@ void HttpResponder::SendData() noexcept
 	}
 }
 
+void HttpResponder::ConnectionLost() noexcept
+{
+	ConnectionEnded();
+#if SUPPORT_OBJECT_MODEL
+	if (responderState == ResponderState::waitingForModelChange)
+	{
+		--numModelWaiters;
+	}
+	delete reportCursor;
+	reportCursor = nullptr;
+#endif
+	UploadingNetworkResponder::ConnectionLost();
+}
+
+// Decide whether to keep the connection open after the response we are about to send. HTTP/1.1 connections persist unless the client asks
+// us to close them, HTTP/1.0 ones only if the client asks us to keep them open. We always leave one responder free for new connections.
+// Only call this when the response has a known length, or uses chunked encoding, so that the client can tell where it ends.
+bool HttpResponder::KeepAlive() noexcept
+{
+	const char * const connection = GetHeaderValue("Connection");
+	const bool wanted = (connection != nullptr)
+							? StringEqualsIgnoreCase(connection, "keep-alive")
+								: numCommandWords >= 3 && StringEqualsIgnoreCase(commandWords[2], "HTTP/1.1");
+	if (wanted != persistent && (!wanted || numPersistentConnections + 1 < NumHttpResponders))
+	{
+		persistent = wanted;
+		if (wanted)
+		{
+			++numPersistentConnections;
+		}
+		else
+		{
+			--numPersistentConnections;
+		}
+	}
+	return persistent;
+}
+
+// Called when the connection has been closed or lost
+void HttpResponder::ConnectionEnded() noexcept
+{
+	if (persistent)
+	{
+		persistent = false;
+		--numPersistentConnections;
+	}
+}
+
+// Return true if the client asked for the object model in CBOR binary format instead of JSON
+bool HttpResponder::WantBinaryModel() const noexcept
+{
+	const char * const flags = GetKeyValue("flags");
+	return flags != nullptr && strchr(flags, 'b') != nullptr;
+}
+
+#if SUPPORT_OBJECT_MODEL
+
+// Start sending an object model report that we generate as we send it, returning true if we did.
+// We don't know the length in advance, so we use chunked transfer encoding.
+bool HttpResponder::StartModelReport(const char *key, const char *flags) noexcept
+{
+	reportCursor = reprap.StartModelReport(key, flags);
+	if (reportCursor == nullptr)
+	{
+		return false;
+	}
+
+	outBuf->copy(	"HTTP/1.1 200 OK\r\n"
+					"Cache-Control: no-cache, no-store, must-revalidate\r\n"
+					"Pragma: no-cache\r\n"
+					"Expires: 0\r\n"
+					"Transfer-Encoding: chunked\r\n"
+				);
+	outBuf->catf("Content-Type: %s\r\n", (WantBinaryModel()) ? "application/cbor" : "application/json");
+	AddCorsHeader();
+	const bool keepOpen = KeepAlive();
+	outBuf->catf("Connection: %s\r\n\r\n", (keepOpen) ? "keep-alive" : "close");
+	if (outBuf->HadOverflow())
+	{
+		delete reportCursor;
+		reportCursor = nullptr;
+		return false;
+	}
+
+	Commit((keepOpen) ? ResponderState::reading : ResponderState::free, false);
+	return true;
+}
+
+// Handle a long-poll object model request, e.g. rr_model?key=heat&flags=c1234&wait=3000. The client passes the sequence number from its
+// last report in the delta flag. If that part of the model hasn't changed since then, we hold the request until it changes or the wait time
+// expires, then send a delta report as usual. Return true if we are holding the request. Changes to live values such as temperatures are
+// found by sampling them, so a request for them is answered only when the values it selects have actually changed.
+// We always leave one responder free for other requests, and we don't reply within MinModelPushInterval so that a client that sends a new
+// request as soon as it gets a reply can't flood the network when the model is changing continuously.
+bool HttpResponder::StartWaitingForModel(const char *key, const char *flags) noexcept
+{
+	const char * const waitVal = GetKeyValue("wait");
+	const char * const sinceVal = (flags == nullptr) ? nullptr : strchr(flags, 'c');
+	if (waitVal == nullptr || sinceVal == nullptr || numModelWaiters + 1 >= NumHttpResponders)
+	{
+		return false;
+	}
+
+	modelWaitSeq = StrToU32(sinceVal + 1);
+	modelWaitTime = min<uint32_t>(StrToU32(waitVal), MaxModelWaitTime);
+	startedProcessingRequestAt = millis();
+	++numModelWaiters;
+	responderState = ResponderState::waitingForModelChange;
+	return true;
+}
+
+bool HttpResponder::ModelWaitFinished() const noexcept
+{
+	const uint32_t timeWaiting = millis() - startedProcessingRequestAt;
+	if (timeWaiting >= modelWaitTime)
+	{
+		return true;
+	}
+	if (timeWaiting < MinModelPushInterval)
+	{
+		return false;
+	}
+	const char * const key = GetKeyValue("key");
+	return reprap.KeyChangedSince((key == nullptr) ? "" : key, modelWaitSeq);
+}
+
+void HttpResponder::StopWaitingForModel() noexcept
+{
+	--numModelWaiters;
+	responderState = ResponderState::processingRequest;
+}
+
+#endif
+
+// Generate the next chunk of the object model report we are sending, if any.
+// If we run out of output buffers part way through a chunk then we can't go back, so we drop the connection and the client sees an incomplete response.
+bool HttpResponder::GetMoreData() noexcept
+{
+#if SUPPORT_OBJECT_MODEL
+	if (reportCursor == nullptr)
+	{
+		return false;
+	}
+
+	if (!OutputBuffer::Allocate(outBuf))
+	{
+		return true;						// no buffer available, try again later
+	}
+
+	if (reportCursor->IsFinished())
+	{
+		outBuf->copy("0\r\n\r\n");			// the last chunk
+		delete reportCursor;
+		reportCursor = nullptr;
+		return true;
+	}
+
+	OutputBuffer *chunk;
+	if (!OutputBuffer::Allocate(chunk))
+	{
+		outBuf = OutputBuffer::Release(outBuf);
+		return true;						// no buffer available, try again later
+	}
+
+	bool ok = true;
+	try
+	{
+		reportCursor->GetNextPieces(chunk, ModelReportChunkLength);
+	}
+	catch (const GCodeException&)
+	{
+		ok = false;
+	}
+
+	if (ok && !chunk->HadOverflow())
+	{
+		outBuf->printf("%x\r\n", (unsigned int)chunk->Length());
+		outBuf->Append(chunk);
+		outBuf->cat("\r\n");
+		if (!outBuf->HadOverflow())
+		{
+			return true;
+		}
+		chunk = nullptr;					// it has been appended to outBuf
+	}
+
+	OutputBuffer::ReleaseAll(chunk);
+	ReportOutputBufferExhaustion(__FILE__, __LINE__);
+	ConnectionLost();						// this releases outBuf and the cursor
+	return true;							// outBuf is now null, so the caller will return without sending anything more
+#else
+	return false;
+#endif
+}
+
 void HttpResponder::Diagnostics(MessageType mt) const noexcept
 {
 	GetPlatform().MessageF(mt, " HTTP(%d)", (int)responderState);
@@ -1517,6 +1886,10 @@ void HttpResponder::AddCorsHeader() noexcept
 HttpResponder::HttpSession HttpResponder::sessions[MaxHttpSessions];
 unsigned int HttpResponder::numSessions = 0;
 unsigned int HttpResponder::clientsServed = 0;
+unsigned int HttpResponder::numPersistentConnections = 0;
+#if SUPPORT_OBJECT_MODEL
+unsigned int HttpResponder::numModelWaiters = 0;
+#endif
 
 volatile uint16_t HttpResponder::seq = 0;
 volatile OutputStack HttpResponder::gcodeReply;
@@ -30,6 +30,8 @@ public:
 protected:
 	void CancelUpload() noexcept override;
 	void SendData() noexcept override;
+	void ConnectionLost() noexcept override;
+	bool GetMoreData() noexcept override;
 
 private:
 #if __LPC17xx__
@@ -44,6 +46,10 @@ private:
 	static const uint32_t HttpSessionTimeout = 8000;	// HTTP session timeout in milliseconds
 	static const uint32_t MaxFileInfoGetTime = 2000;	// maximum length of time we spend getting file info, to avoid the client timing out (actual time will be a little longer than this)
 	static const uint32_t MaxBufferWaitTime = 1000;		// maximum length of time we spend waiting for a buffer before we discard gcodeReply buffers
+	static const size_t ModelReportChunkLength = 2 * OUTPUT_BUFFER_SIZE;	// the amount of an object model report we generate before sending it
+	static const uint32_t MaxModelWaitTime = 5000;		// maximum time we hold an object model request waiting for a change, must be less than HttpSessionTimeout
+	static const uint32_t MinModelPushInterval = 250;	// minimum time we hold an object model request waiting for a change, to limit the rate of reports
+	static const uint32_t HttpKeepAliveTimeout = 5000;	// how long we keep an idle persistent connection open waiting for the next request
 
 	enum class HttpParseState
 	{
@@ -80,7 +86,11 @@ private:
 	bool CheckAuthenticated() noexcept;
 	bool RemoveAuthentication() noexcept;
 
+	void StartReadingRequest() noexcept;
+	size_t CopyOrdinaryChars(const uint8_t *data, size_t length) noexcept;
 	bool CharFromClient(char c) noexcept;
+	bool KeepAlive() noexcept;
+	void ConnectionEnded() noexcept;
 	void SendFile(const char* nameOfFileToSend, bool isWebFile) noexcept;
 	void SendGCodeReply() noexcept;
 	void SendJsonResponse(const char* command) noexcept;
@@ -89,6 +99,13 @@ private:
 	void ProcessRequest() noexcept;
 	void RejectMessage(const char* s, unsigned int code = 500) noexcept;
 	bool SendFileInfo(bool quitEarly) noexcept;
+	bool WantBinaryModel() const noexcept;
+#if SUPPORT_OBJECT_MODEL
+	bool StartModelReport(const char *key, const char *flags) noexcept;
+	bool StartWaitingForModel(const char *key, const char *flags) noexcept;
+	bool ModelWaitFinished() const noexcept;
+	void StopWaitingForModel() noexcept;
+#endif
 	void AddCorsHeader() noexcept;
 
 #if HAS_MASS_STORAGE
@@ -96,6 +113,7 @@ private:
 #endif
 
 	const char* GetKeyValue(const char *key) const noexcept;	// return the value of the specified key, or nullptr if not present
+	const char* GetHeaderValue(const char *key) const noexcept;	// return the value of the specified header, or nullptr if not present
 
 	static void RemoveSession(size_t sessionToRemove) noexcept;
 
@@ -122,11 +140,26 @@ private:
 	uint32_t postFileExpectedCrc;
 	time_t fileLastModified;
 	bool postFileGotCrc;
+	bool persistent;								// true if we have told the client that we will keep the connection open
+
+#if SUPPORT_OBJECT_MODEL
+	// rr_model requests for large parts of the object model are generated as they are sent
+	ObjectModelReportCursor *reportCursor;
+
+	// rr_model requests with a wait time are held until the part of the model they ask for changes
+	uint32_t modelWaitSeq;							// the sequence number the client already has
+	uint32_t modelWaitTime;							// how long to hold the request
+	bool modelWaitOver;								// true while we generate the response to a request we held
+#endif
 
 	// Keeping track of HTTP sessions
 	static HttpSession sessions[MaxHttpSessions];
 	static unsigned int numSessions;
 	static unsigned int clientsServed;
+	static unsigned int numPersistentConnections;	// number of responders whose connections we are keeping open between requests
+#if SUPPORT_OBJECT_MODEL
+	static unsigned int numModelWaiters;			// number of responders holding object model requests
+#endif
 
 	// Responses from GCodes class
 	static volatile uint16_t seq;					// Sequence number for G-Code replies
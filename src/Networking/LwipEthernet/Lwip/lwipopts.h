@@ -109,13 +109,13 @@
  * per active UDP "connection".
  * (requires the LWIP_UDP option)
  */
-#define MEMP_NUM_UDP_PCB                3
+#define MEMP_NUM_UDP_PCB                4		// DHCP, mDNS, NetBIOS and telemetry publishing
 
 /**
  * MEMP_NUM_TCP_PCB: the number of simulatenously active TCP connections.
  * (requires the LWIP_TCP option)
  */
-#define MEMP_NUM_TCP_PCB                8
+#define MEMP_NUM_TCP_PCB                9		// 8 server connections and one MQTT client connection
 
 /**
  * MEMP_NUM_TCP_PCB_LISTEN: the number of listening TCP connections.
@@ -36,6 +36,7 @@ extern "C"
 
 #include "lwip/dhcp.h"
 #include "lwip/tcp.h"
+#include "lwip/udp.h"
 
 #include "lwip/apps/netbiosns.h"
 #include "lwip/apps/mdns.h"
@@ -87,7 +88,7 @@ extern "C"
 /*-----------------------------------------------------------------------------------*/
 
 LwipEthernetInterface::LwipEthernetInterface(Platform& p) noexcept
-	: platform(p), closeDataPort(false), activated(false), initialised(false), usingDhcp(false)
+	: platform(p), closeDataPort(false), udpPcb(nullptr), activated(false), initialised(false), usingDhcp(false)
 {
 	ethernetInterface = this;
 
@@ -372,6 +373,12 @@ void LwipEthernetInterface::Stop() noexcept
 {
 	if (GetState() != NetworkState::disabled)
 	{
+		if (udpPcb != nullptr)
+		{
+			MutexLocker lock(lwipMutex);
+			udp_remove(udpPcb);
+			udpPcb = nullptr;
+		}
 		netif_set_down(&gs_net_if);
 
 		pinMode(EthernetPhyResetPin, OUTPUT_LOW);		// hold the Ethernet Phy chip in reset
@@ -500,6 +507,51 @@ void LwipEthernetInterface::Diagnostics(MessageType mtype) noexcept
 #endif
 }
 
+// Send a UDP packet from an ephemeral port. The data is copied, so the caller's buffer may be reused as soon as we return.
+bool LwipEthernetInterface::SendUdpPacket(IPAddress dest, TcpPort port, const uint8_t *data, size_t length) noexcept
+{
+	MutexLocker lock(lwipMutex);
+
+	if (GetState() != NetworkState::active)
+	{
+		return false;
+	}
+
+	if (udpPcb == nullptr)
+	{
+		udpPcb = udp_new();
+		if (udpPcb == nullptr)
+		{
+			return false;
+		}
+	}
+
+	pbuf * const p = pbuf_alloc(PBUF_TRANSPORT, length, PBUF_RAM);
+	if (p == nullptr)
+	{
+		return false;
+	}
+	memcpy(p->payload, data, length);
+
+	ip_addr_t destAddr;
+	ip_addr_set_ip4_u32(&destAddr, dest.GetV4LittleEndian());
+	const err_t err = udp_sendto(udpPcb, p, &destAddr, port);
+	pbuf_free(p);
+	return err == ERR_OK;
+}
+
+// Start opening a connection for a client protocol
+bool LwipEthernetInterface::ConnectClient(NetworkProtocol protocol, IPAddress ip, TcpPort port) noexcept
+{
+#if SUPPORT_MQTT
+	if (protocol == MqttProtocol && GetState() == NetworkState::active)
+	{
+		return sockets[MqttSocketNumber]->Connect(ip, port, protocol);
+	}
+#endif
+	return false;
+}
+
 // Enable or disable the network. For Ethernet the ssid parameter is not used.
 GCodeResult LwipEthernetInterface::EnableInterface(int mode, const StringRef& ssid, const StringRef& reply) noexcept
 {
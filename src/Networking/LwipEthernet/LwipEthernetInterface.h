@@ -13,16 +13,22 @@
 #include "RepRapFirmware.h"
 #include "MessageType.h"
 
-// We have 8 sockets available for Ethernet
+// We have 8 sockets available for Ethernet servers, plus one for the MQTT client if it is supported
 const size_t NumHttpSockets = 5;				// sockets 0-4 are for HTTP
 const SocketNumber FtpSocketNumber = 5;
 const SocketNumber FtpDataSocketNumber = 6;
 const SocketNumber TelnetSocketNumber = 7;
+#if SUPPORT_MQTT
+const SocketNumber MqttSocketNumber = 8;		// used for the outgoing connection to the MQTT broker
+const size_t NumEthernetSockets = 9;
+#else
 const size_t NumEthernetSockets = 8;
+#endif
 
 // Forward declarations
 class LwipSocket;
 struct tcp_pcb;
+struct udp_pcb;
 
 // The main network class that drives Ethernet network.
 class LwipEthernetInterface : public NetworkInterface
@@ -57,6 +63,10 @@ public:
 	void OpenDataPort(TcpPort port) noexcept override;
 	void TerminateDataPort() noexcept override;
 
+	bool SupportsUdp() const noexcept override { return true; }
+	bool SendUdpPacket(IPAddress dest, TcpPort port, const uint8_t *data, size_t length) noexcept override;
+	bool ConnectClient(NetworkProtocol protocol, IPAddress ip, TcpPort port) noexcept override;
+
 protected:
 	DECLARE_OBJECT_MODEL
 
@@ -86,6 +96,7 @@ private:
 	bool protocolEnabled[NumProtocols];				// whether each protocol is enabled
 	bool closeDataPort;
 	tcp_pcb *listeningPcbs[NumTcpPorts];
+	udp_pcb *udpPcb;								// used to send UDP packets, created when first needed
 
 	bool activated;
 	bool initialised;
@@ -58,6 +58,21 @@ static err_t conn_recv(void *arg, tcp_pcb *pcb, pbuf *p, err_t err)
 	return ERR_ABRT;
 }
 
+static err_t conn_connected(void *arg, tcp_pcb *pcb, err_t err)
+{
+	UNUSED(err);
+
+	LwipSocket *socket = (LwipSocket *)arg;
+	if (socket != nullptr)
+	{
+		socket->ConnectionMade();
+		return ERR_OK;
+	}
+
+	tcp_abort(pcb);
+	return ERR_ABRT;
+}
+
 static err_t conn_sent(void *arg, tcp_pcb *pcb, u16_t len)
 {
 	UNUSED(pcb);
@@ -104,6 +119,56 @@ bool LwipSocket::AcceptConnection(tcp_pcb *pcb) noexcept
 	return false;
 }
 
+// Start opening a connection to a server. The socket must be disabled, i.e. not used for a server port.
+// When the connection has been made we look for a responder for it in the same way as for an incoming connection.
+bool LwipSocket::Connect(IPAddress ip, TcpPort port, NetworkProtocol p) noexcept
+{
+	MutexLocker lock(lwipMutex);
+
+	if (state != SocketState::disabled)
+	{
+		return false;
+	}
+
+	tcp_pcb * const pcb = tcp_new();
+	if (pcb == nullptr)
+	{
+		return false;
+	}
+
+	ReInit();
+	localPort = 0;						// don't listen when the connection has been closed
+	protocol = p;
+	connectionPcb = pcb;
+	remoteIPAddress = ip;
+	remotePort = port;
+	whenConnected = millis();			// so that Poll can time out the attempt
+	state = SocketState::connecting;
+
+	tcp_arg(pcb, this);
+	tcp_err(pcb, conn_err);
+	tcp_recv(pcb, conn_recv);
+	tcp_sent(pcb, conn_sent);
+
+	ip_addr_t addr;
+	ip_addr_set_ip4_u32(&addr, ip.GetV4LittleEndian());
+	if (tcp_connect(pcb, &addr, port, conn_connected) != ERR_OK)
+	{
+		Terminate();
+		return false;
+	}
+	return true;
+}
+
+void LwipSocket::ConnectionMade() noexcept
+{
+	if (state == SocketState::connecting)
+	{
+		state = SocketState::connected;
+		whenConnected = millis();
+	}
+}
+
 void LwipSocket::DataReceived(pbuf *data) noexcept
 {
 	if (state != SocketState::closing)
@@ -157,7 +222,7 @@ void LwipSocket::ConnectionClosedGracefully() noexcept
 
 	if (state == SocketState::closing)
 	{
-		state = SocketState::listening;
+		state = (localPort == 0) ? SocketState::disabled : SocketState::listening;
 	}
 	else
 	{
@@ -335,6 +400,14 @@ void LwipSocket::Poll() noexcept
 		// Socket is listening but no client has connected to it yet
 		break;
 
+	case SocketState::connecting:
+		// We are waiting for a server to accept our connection
+		if (millis() - whenConnected >= MaxConnectTime)
+		{
+			Terminate();
+		}
+		break;
+
 	case SocketState::connected:
 		// A connection has been established, but no responder has been found yet
 		// See if we can assign this socket
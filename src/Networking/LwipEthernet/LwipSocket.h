@@ -26,6 +26,8 @@ public:
 
 	// LwIP interfaces
 	bool AcceptConnection(tcp_pcb *pcb) noexcept;
+	bool Connect(IPAddress ip, TcpPort port, NetworkProtocol p) noexcept;
+	void ConnectionMade() noexcept;
 	void DataReceived(pbuf *data) noexcept;
 	void DataSent(size_t numBytes) noexcept;
 	void ConnectionClosedGracefully() noexcept;
@@ -45,6 +47,8 @@ public:
 	bool CanSend() const noexcept override;
 	size_t Send(const uint8_t *data, size_t length) noexcept override;
 	void Send() noexcept override { }
+	bool SendsByReference() const noexcept override { return true; }		// we don't ask LwIP to copy the data
+	size_t GetUnacknowledgedBytes() const noexcept override { return unAcked; }
 
 private:
 	enum class SocketState : uint8_t
@@ -52,6 +56,7 @@ private:
 		disabled,
 		inactive,
 		listening,
+		connecting,
 		connected,
 		clientDisconnecting,
 		closing,
@@ -0,0 +1,624 @@
+/*
+ * MqttClient.cpp
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#include "MqttClient.h"
+
+#if SUPPORT_MQTT
+
+#include "Socket.h"
+#include "Network.h"
+#include <Platform.h>
+#include <GCodes/GCodeBuffer/GCodeBuffer.h>
+#include <General/IP4String.h>
+
+#if SUPPORT_TELEMETRY
+# include <Telemetry.h>
+#endif
+
+Mutex MqttClient::mqttMutex;
+MqttClient::Event MqttClient::queue[QueueLength];
+size_t MqttClient::queueHead = 0;
+size_t MqttClient::queueCount = 0;
+uint16_t MqttClient::nextPacketId = 1;
+
+bool MqttClient::enabled = false;
+bool MqttClient::connectNow = false;
+bool MqttClient::refusalReported = false;
+IPAddress MqttClient::brokerAddress;
+TcpPort MqttClient::brokerPort = DefaultMqttPort;
+uint8_t MqttClient::defaultQos = 0;
+uint32_t MqttClient::telemetryInterval = 0;
+String<StringLength20> MqttClient::clientId;
+String<StringLength20> MqttClient::userName;
+String<StringLength20> MqttClient::password;
+String<StringLength50> MqttClient::topicPrefix;
+
+unsigned int MqttClient::connectionsMade = 0;
+unsigned int MqttClient::messagesPublished = 0;
+unsigned int MqttClient::messagesDropped = 0;
+
+MqttClient::MqttClient(NetworkResponder *n) noexcept
+	: NetworkResponder(n), rxState(RxState::header), rxHeader(0), rxShift(0), rxLength(0), rxCount(0),
+	  whenLastSent(0), whenLastReceived(0), whenPublished(0), whenPingSent(0), whenTelemetrySent(0), awaitingPuback(false), awaitingPingresp(false)
+{
+}
+
+/*static*/ void MqttClient::InitStatic() noexcept
+{
+	mqttMutex.Create("MQTT");
+	topicPrefix.copy("reprap");
+}
+
+// Do some work, returning true if we did something significant
+bool MqttClient::Spin() noexcept
+{
+	switch (responderState)
+	{
+	case ResponderState::free:
+		// Try to connect to the broker if we have been asked to, but not too often
+		if (enabled && (connectNow || millis() - timer >= ReconnectInterval))
+		{
+			timer = millis();
+			if (GetNetwork().ConnectClient(MqttProtocol, brokerAddress, brokerPort))
+			{
+				connectNow = false;
+				responderState = ResponderState::connectingToBroker;
+				return true;
+			}
+		}
+		return false;
+
+	case ResponderState::connectingToBroker:
+		// Accept is called when the connection has been made. If it hasn't been made by now then the socket has given up.
+		if (millis() - timer >= MaxConnectTime + 1000)
+		{
+			timer = millis();
+			responderState = ResponderState::free;
+		}
+		return false;
+
+	case ResponderState::waitingForConnack:
+	case ResponderState::connectedToBroker:
+		return ProcessConnection();
+
+	case ResponderState::sending:
+		SendData();
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+// This is called when the connection to the broker has been made
+bool MqttClient::Accept(Socket *s, NetworkProtocol protocol) noexcept
+{
+	if (responderState == ResponderState::connectingToBroker && protocol == MqttProtocol)
+	{
+		skt = s;
+		rxState = RxState::header;
+		awaitingPuback = awaitingPingresp = false;
+		whenLastReceived = timer = millis();
+		if (SendConnect())
+		{
+			if (reprap.Debug(moduleWebserver))
+			{
+				debugPrintf("Connected to MQTT broker\n");
+			}
+			return true;
+		}
+		skt = nullptr;
+		responderState = ResponderState::free;
+	}
+	return false;
+}
+
+// This is called to force termination if we implement the specified protocol
+void MqttClient::Terminate(NetworkProtocol protocol, NetworkInterface *interface) noexcept
+{
+	if (responderState != ResponderState::free && (protocol == MqttProtocol || protocol == AnyProtocol) && skt != nullptr && skt->GetInterface() == interface)
+	{
+		ConnectionLost();
+	}
+}
+
+void MqttClient::ConnectionLost() noexcept
+{
+	awaitingPuback = awaitingPingresp = false;
+	timer = millis();					// wait a while before reconnecting
+	NetworkResponder::ConnectionLost();
+}
+
+// Process what the broker has sent us and decide what to send next. Return true if we did something significant.
+bool MqttClient::ProcessConnection() noexcept
+{
+	const bool readSomething = ReadPackets();
+	if (skt == nullptr)
+	{
+		return true;					// we dropped the connection because of what the broker sent
+	}
+	if (!skt->CanRead())
+	{
+		ConnectionLost();
+		return true;
+	}
+
+	const uint32_t now = millis();
+	if (responderState == ResponderState::waitingForConnack)
+	{
+		if (now - timer >= ResponseTimeout)
+		{
+			ConnectionLost();
+			return true;
+		}
+		return readSomething;
+	}
+
+	if (!enabled || connectNow)
+	{
+		// We have been disabled or reconfigured, so disconnect cleanly
+		if (!SendShortPacket(Disconnect, ResponderState::free))
+		{
+			ConnectionLost();
+		}
+		return true;
+	}
+
+	if ((awaitingPuback && now - whenPublished >= ResponseTimeout) || (awaitingPingresp && now - whenPingSent >= ResponseTimeout))
+	{
+		// The broker hasn't replied, so assume that the connection has failed. An unacknowledged event is sent again when we reconnect.
+		ConnectionLost();
+		return true;
+	}
+
+	if (!awaitingPuback)
+	{
+		if (SendEvent())
+		{
+			return true;
+		}
+#if SUPPORT_TELEMETRY
+		if (telemetryInterval != 0 && now - whenTelemetrySent >= telemetryInterval)
+		{
+			whenTelemetrySent = now;
+			if (SendTelemetry())
+			{
+				return true;
+			}
+		}
+#endif
+	}
+
+	// If we have been quiet or not heard from the broker for half the keep-alive time, send a ping so that we find out whether the connection still works
+	if (!awaitingPingresp && (now - whenLastSent >= KeepAliveSeconds * 500 || now - whenLastReceived >= KeepAliveSeconds * 500))
+	{
+		if (SendShortPacket(Pingreq, ResponderState::connectedToBroker))
+		{
+			awaitingPingresp = true;
+			whenPingSent = now;
+			return true;
+		}
+	}
+	return readSomething;
+}
+
+// Read packets from the broker. Return true if we read anything.
+bool MqttClient::ReadPackets() noexcept
+{
+	bool readSomething = false;
+	char c;
+	while (skt != nullptr && skt->ReadChar(c))
+	{
+		readSomething = true;
+		switch (rxState)
+		{
+		case RxState::header:
+			rxHeader = (uint8_t)c;
+			rxLength = rxCount = 0;
+			rxShift = 0;
+			rxState = RxState::length;
+			break;
+
+		case RxState::length:
+			// The remaining length is sent 7 bits at a time, least significant first, in at most 4 bytes
+			rxLength |= (size_t)(c & 0x7F) << rxShift;
+			rxShift += 7;
+			if ((c & 0x80) == 0)
+			{
+				if (rxLength == 0)
+				{
+					rxState = RxState::header;
+					PacketReceived();
+				}
+				else
+				{
+					rxState = RxState::body;
+				}
+			}
+			else if (rxShift >= 28)
+			{
+				ConnectionLost();				// malformed packet
+			}
+			break;
+
+		case RxState::body:
+			if (rxCount < ARRAY_SIZE(rxData))
+			{
+				rxData[rxCount] = (uint8_t)c;
+			}
+			++rxCount;
+			if (rxCount == rxLength)
+			{
+				rxState = RxState::header;
+				PacketReceived();
+			}
+			break;
+		}
+	}
+	return readSomething;
+}
+
+// Act on a packet from the broker
+void MqttClient::PacketReceived() noexcept
+{
+	whenLastReceived = millis();
+	switch (rxHeader & 0xF0)
+	{
+	case Connack:
+		if (responderState == ResponderState::waitingForConnack)
+		{
+			if (rxLength < 2)
+			{
+				GetPlatform().Message(WarningMessage, "MQTT broker sent a malformed CONNACK\n");
+				ConnectionLost();
+			}
+			else if (rxData[1] == 0)
+			{
+				responderState = ResponderState::connectedToBroker;
+				++connectionsMade;
+				refusalReported = false;
+			}
+			else
+			{
+				if (!refusalReported)
+				{
+					GetPlatform().MessageF(WarningMessage, "MQTT broker refused connection, reason code %u\n", rxData[1]);
+					refusalReported = true;
+				}
+				ConnectionLost();
+			}
+		}
+		break;
+
+	case Puback:
+		if (awaitingPuback && rxLength >= 2)
+		{
+			const uint16_t packetId = ((uint16_t)rxData[0] << 8) | rxData[1];
+			MutexLocker lock(mqttMutex);
+			if (queueCount != 0 && queue[queueHead].packetId == packetId)
+			{
+				queueHead = (queueHead + 1) % QueueLength;
+				--queueCount;
+				++messagesPublished;
+				awaitingPuback = false;
+			}
+		}
+		break;
+
+	case Pingresp:
+		awaitingPingresp = false;
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Send the CONNECT packet. We always ask for a clean session because we don't subscribe to anything.
+bool MqttClient::SendConnect() noexcept
+{
+	if (!OutputBuffer::Allocate(outBuf))
+	{
+		return false;
+	}
+
+	MutexLocker lock(mqttMutex);
+	const char * const id = (clientId.IsEmpty()) ? GetNetwork().GetHostname() : clientId.c_str();
+	uint8_t flags = 0x02;												// clean session
+	size_t length = 10 + 2 + strlen(id);								// variable header and client identifier
+	if (!userName.IsEmpty())
+	{
+		flags |= 0x80;
+		length += 2 + userName.strlen();
+		if (!password.IsEmpty())
+		{
+			flags |= 0x40;
+			length += 2 + password.strlen();
+		}
+	}
+
+	outBuf->cat((char)Connect);
+	AppendLength(outBuf, length);
+	AppendString(outBuf, "MQTT");
+	outBuf->cat((char)4);												// protocol level 4 is MQTT 3.1.1
+	outBuf->cat((char)flags);
+	AppendUint16(outBuf, KeepAliveSeconds);
+	AppendString(outBuf, id);
+	if ((flags & 0x80) != 0)
+	{
+		AppendString(outBuf, userName.c_str());
+		if ((flags & 0x40) != 0)
+		{
+			AppendString(outBuf, password.c_str());
+		}
+	}
+
+	whenLastSent = millis();
+	Commit(ResponderState::waitingForConnack, false);
+	return true;
+}
+
+// Publish the event at the head of the queue. QoS 0 events are removed from the queue as soon as they have been sent.
+bool MqttClient::SendEvent() noexcept
+{
+	MutexLocker lock(mqttMutex);
+	if (queueCount == 0 || !OutputBuffer::Allocate(outBuf))
+	{
+		return false;
+	}
+
+	Event& ev = queue[queueHead];
+	const bool dup = (ev.packetId != 0);								// if it has a packet ID then we have sent it before
+	if (ev.qos != 0 && ev.packetId == 0)
+	{
+		ev.packetId = nextPacketId++;
+		if (nextPacketId == 0)
+		{
+			nextPacketId = 1;											// packet ID 0 is not allowed
+		}
+	}
+
+	String<StringLength50> subtopic;
+	subtopic.printf("event/%s", ev.name.c_str());
+	AppendPublishHeader(outBuf, subtopic.c_str(), ev.payload.strlen(), ev.qos, dup, ev.packetId);
+	outBuf->cat(ev.payload.c_str(), ev.payload.strlen());
+
+	if (ev.qos == 0)
+	{
+		queueHead = (queueHead + 1) % QueueLength;
+		--queueCount;
+		++messagesPublished;
+	}
+	else
+	{
+		awaitingPuback = true;
+		whenPublished = millis();
+	}
+
+	whenLastSent = millis();
+	Commit(ResponderState::connectedToBroker, false);
+	return true;
+}
+
+#if SUPPORT_TELEMETRY
+
+// Publish the latest telemetry values at QoS 0. The payload is built first so that we know its length.
+bool MqttClient::SendTelemetry() noexcept
+{
+	OutputBuffer *payload;
+	if (!OutputBuffer::Allocate(payload))
+	{
+		return false;
+	}
+	Telemetry::AppendLatestValues(payload);
+	if (payload->HadOverflow() || !OutputBuffer::Allocate(outBuf))
+	{
+		OutputBuffer::ReleaseAll(payload);
+		return false;
+	}
+
+	{
+		MutexLocker lock(mqttMutex);
+		AppendPublishHeader(outBuf, "telemetry", payload->Length(), 0, false, 0);
+	}
+	outStack.Push(payload);
+	++messagesPublished;
+
+	whenLastSent = millis();
+	Commit(ResponderState::connectedToBroker, false);
+	return true;
+}
+
+#endif
+
+// Send a packet that has no variable header or payload, i.e. PINGREQ or DISCONNECT
+bool MqttClient::SendShortPacket(uint8_t header, ResponderState nextState) noexcept
+{
+	if (!OutputBuffer::Allocate(outBuf))
+	{
+		return false;
+	}
+	outBuf->cat((char)header);
+	outBuf->cat((char)0);
+	whenLastSent = millis();
+	Commit(nextState, false);
+	return true;
+}
+
+// Append the fixed header, topic name and packet identifier of a PUBLISH packet. The topic is <prefix>/<subtopic>. The mutex must be owned.
+/*static*/ void MqttClient::AppendPublishHeader(OutputBuffer *buf, const char *subtopic, size_t payloadLength, uint8_t qos, bool dup, uint16_t packetId) noexcept
+{
+	const size_t prefixLength = topicPrefix.strlen();
+	const size_t topicLength = (prefixLength == 0) ? strlen(subtopic) : prefixLength + 1 + strlen(subtopic);
+	buf->cat((char)(Publish | ((dup) ? 0x08 : 0) | (qos << 1)));
+	AppendLength(buf, 2 + topicLength + ((qos != 0) ? 2 : 0) + payloadLength);
+	AppendUint16(buf, topicLength);
+	if (prefixLength != 0)
+	{
+		buf->cat(topicPrefix.c_str(), prefixLength);
+		buf->cat('/');
+	}
+	buf->cat(subtopic);
+	if (qos != 0)
+	{
+		AppendUint16(buf, packetId);
+	}
+}
+
+/*static*/ void MqttClient::AppendLength(OutputBuffer *buf, size_t length) noexcept
+{
+	do
+	{
+		uint8_t b = length & 0x7F;
+		length >>= 7;
+		if (length != 0)
+		{
+			b |= 0x80;
+		}
+		buf->cat((char)b);
+	} while (length != 0);
+}
+
+/*static*/ void MqttClient::AppendUint16(OutputBuffer *buf, uint16_t val) noexcept
+{
+	buf->cat((char)(val >> 8));
+	buf->cat((char)(val & 0xFF));
+}
+
+/*static*/ void MqttClient::AppendString(OutputBuffer *buf, const char *s) noexcept
+{
+	const size_t length = strlen(s);
+	AppendUint16(buf, length);
+	buf->cat(s, length);
+}
+
+// Queue an event for publishing. If the queue is full the event is dropped.
+/*static*/ void MqttClient::PublishEvent(const char *event, const char *format, ...) noexcept
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	MutexLocker lock(mqttMutex);
+	if (queueCount == QueueLength)
+	{
+		++messagesDropped;
+		return;
+	}
+
+	Event& ev = queue[(queueHead + queueCount) % QueueLength];
+	ev.name.copy(event);
+	va_list vargs;
+	va_start(vargs, format);
+	ev.payload.vprintf(format, vargs);
+	va_end(vargs);
+	ev.qos = defaultQos;
+	ev.packetId = 0;
+	++queueCount;
+}
+
+// Configure the client. Called for M586.4.
+//  M586.4 S1 H"192.168.1.10" R1883 C"clientid" U"user" K"password" T"prefix" Q1 F5000
+/*static*/ GCodeResult MqttClient::Configure(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	bool seen = false;
+	MutexLocker lock(mqttMutex);
+
+	if (gb.Seen('H'))
+	{
+		IPAddress address;
+		gb.GetIPAddress(address);
+		brokerAddress = address;
+		seen = true;
+	}
+	if (gb.Seen('R'))
+	{
+		brokerPort = gb.GetLimitedUIValue('R', 65536, 1);
+		seen = true;
+	}
+	if (gb.Seen('C'))
+	{
+		gb.GetQuotedString(clientId.GetRef(), true);
+		seen = true;
+	}
+	if (gb.Seen('U'))
+	{
+		gb.GetQuotedString(userName.GetRef(), true);
+		seen = true;
+	}
+	if (gb.Seen('K'))
+	{
+		gb.GetQuotedString(password.GetRef(), true);
+		seen = true;
+	}
+	if (gb.Seen('T'))
+	{
+		gb.GetQuotedString(topicPrefix.GetRef(), true);
+		seen = true;
+	}
+	if (gb.Seen('Q'))
+	{
+		defaultQos = gb.GetLimitedUIValue('Q', 2);
+		seen = true;
+	}
+	if (gb.Seen('F'))
+	{
+#if SUPPORT_TELEMETRY
+		const uint32_t val = gb.GetUIValue();
+		if (val != 0 && (val < MinTelemetryInterval || val > MaxTelemetryInterval))
+		{
+			reply.printf("telemetry interval must be 0 or between %" PRIu32 " and %" PRIu32 "ms", MinTelemetryInterval, MaxTelemetryInterval);
+			return GCodeResult::error;
+		}
+		telemetryInterval = val;
+		seen = true;
+#else
+		reply.copy("telemetry is not supported");
+		return GCodeResult::error;
+#endif
+	}
+	if (gb.Seen('S'))
+	{
+		enabled = (gb.GetIValue() > 0);
+		seen = true;
+	}
+
+	if (seen)
+	{
+		if (enabled && brokerAddress.IsNull())
+		{
+			enabled = false;
+			reply.copy("no MQTT broker address has been set");
+			return GCodeResult::error;
+		}
+		connectNow = true;
+		refusalReported = false;
+	}
+	else if (enabled)
+	{
+		reply.printf("MQTT publishing to %s:%u with prefix '%s' at QoS %u", IP4String(brokerAddress).c_str(), brokerPort, topicPrefix.c_str(), defaultQos);
+		if (telemetryInterval != 0)
+		{
+			reply.catf(", telemetry every %" PRIu32 "ms", telemetryInterval);
+		}
+		reply.catf(", %u messages published, %u dropped", messagesPublished, messagesDropped);
+	}
+	else
+	{
+		reply.copy("MQTT is disabled");
+	}
+	return GCodeResult::ok;
+}
+
+void MqttClient::Diagnostics(MessageType mtype) const noexcept
+{
+	GetPlatform().MessageF(mtype, " MQTT(%d), %u connections, %u published, %u dropped, %u queued", (int)responderState, connectionsMade, messagesPublished, messagesDropped, queueCount);
+}
+
+#endif
+
+// End
@@ -0,0 +1,123 @@
+/*
+ * MqttClient.h
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#ifndef SRC_NETWORKING_MQTTCLIENT_H_
+#define SRC_NETWORKING_MQTTCLIENT_H_
+
+#include "NetworkResponder.h"
+
+#if SUPPORT_MQTT
+
+#include <GCodes/GCodeResult.h>
+
+// Minimal MQTT 3.1.1 client that publishes machine events and telemetry to a broker. It never subscribes, so the only packets we expect from
+// the broker are CONNACK, PUBACK and PINGRESP. Events are queued by PublishEvent, which may be called from any task. The queue is bounded:
+// if the broker is unreachable or slow then new events are dropped and counted, rather than using more memory. QoS 1 messages are sent one
+// at a time and stay at the head of the queue until the broker acknowledges them. If the acknowledgement doesn't arrive we drop the connection
+// and send the message again with the DUP flag when we have reconnected. Telemetry isn't queued: when it is due, the latest values are
+// published at QoS 0 if no event is waiting. Configured using M586.4.
+class MqttClient : public NetworkResponder
+{
+public:
+	MqttClient(NetworkResponder *n) noexcept;
+	bool Spin() noexcept override;								// do some work, returning true if we did anything significant
+	bool Accept(Socket *s, NetworkProtocol protocol) noexcept override;	// ask the responder to accept this connection, returns true if it did
+	void Terminate(NetworkProtocol protocol, NetworkInterface *interface) noexcept override;	// terminate the responder if it is serving the specified protocol on the specified interface
+	void Diagnostics(MessageType mtype) const noexcept override;
+
+	static void InitStatic() noexcept;
+	static GCodeResult Configure(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
+
+	// Queue an event for publishing to topic <prefix>/event/<event>. The payload is formatted like printf and is normally a JSON object.
+	static void PublishEvent(const char *event, const char *format, ...) noexcept __attribute__ ((format (printf, 2, 3)));
+
+	static constexpr size_t MaxPayloadLength = StringLength100;	// longer payloads are truncated
+
+private:
+	static constexpr size_t QueueLength = 8;					// maximum number of events waiting to be published
+	static constexpr uint16_t KeepAliveSeconds = 60;
+	static constexpr uint32_t ReconnectInterval = 10000;		// how long we wait between attempts to connect to the broker
+	static constexpr uint32_t ResponseTimeout = 5000;			// how long we wait for the broker to reply to CONNECT, PUBLISH at QoS 1 or PINGREQ
+
+	// MQTT control packet types, already shifted into the top 4 bits of the fixed header
+	enum PacketType : uint8_t
+	{
+		Connect = 0x10,
+		Connack = 0x20,
+		Publish = 0x30,
+		Puback = 0x40,
+		Pingreq = 0xC0,
+		Pingresp = 0xD0,
+		Disconnect = 0xE0
+	};
+
+	enum class RxState : uint8_t { header, length, body };
+
+	struct Event
+	{
+		String<StringLength20> name;
+		String<MaxPayloadLength> payload;
+		uint16_t packetId;										// 0 until it has been sent at QoS 1
+		uint8_t qos;
+	};
+
+	bool ProcessConnection() noexcept;
+	bool ReadPackets() noexcept;
+	void PacketReceived() noexcept;
+	bool SendConnect() noexcept;
+	bool SendEvent() noexcept;
+#if SUPPORT_TELEMETRY
+	bool SendTelemetry() noexcept;
+#endif
+	bool SendShortPacket(uint8_t header, ResponderState nextState) noexcept;
+	void ConnectionLost() noexcept override;
+
+	static void AppendLength(OutputBuffer *buf, size_t length) noexcept;
+	static void AppendUint16(OutputBuffer *buf, uint16_t val) noexcept;
+	static void AppendString(OutputBuffer *buf, const char *s) noexcept;
+	static void AppendPublishHeader(OutputBuffer *buf, const char *subtopic, size_t payloadLength, uint8_t qos, bool dup, uint16_t packetId) noexcept;
+
+	// Receive state. We only need the first two bytes of any packet the broker sends us.
+	RxState rxState;
+	uint8_t rxHeader;
+	uint8_t rxShift;
+	uint8_t rxData[2];
+	size_t rxLength;
+	size_t rxCount;
+
+	uint32_t whenLastSent;
+	uint32_t whenLastReceived;
+	uint32_t whenPublished;									// when we sent the QoS 1 message we are waiting for an acknowledgement of
+	uint32_t whenPingSent;
+	uint32_t whenTelemetrySent;
+	bool awaitingPuback;
+	bool awaitingPingresp;
+
+	static Mutex mqttMutex;										// protects the configuration and the event queue
+	static Event queue[QueueLength];
+	static size_t queueHead, queueCount;
+	static uint16_t nextPacketId;
+
+	static bool enabled;
+	static bool connectNow;										// set when the configuration has changed, so that we don't wait to reconnect
+	static bool refusalReported;								// so that we only warn once if the broker refuses to accept us
+	static IPAddress brokerAddress;
+	static TcpPort brokerPort;
+	static uint8_t defaultQos;
+	static uint32_t telemetryInterval;							// 0 if we are not publishing telemetry
+	static String<StringLength20> clientId;
+	static String<StringLength20> userName;
+	static String<StringLength20> password;
+	static String<StringLength50> topicPrefix;
+
+	static unsigned int connectionsMade;
+	static unsigned int messagesPublished;
+	static unsigned int messagesDropped;
+};
+
+#endif
+
+#endif /* SRC_NETWORKING_MQTTCLIENT_H_ */
@@ -40,10 +40,18 @@
 #if SUPPORT_TELNET
 #include "TelnetResponder.h"
 #endif
+#if SUPPORT_MQTT
+#include "MqttClient.h"
+#endif
 #include <General/IP4String.h>
 #include <Version.h>
 #include <Movement/StepTimer.h>
 #include <TaskPriorities.h>
+#include <GCodes/GCodeBuffer/GCodeBuffer.h>
+
+#if SUPPORT_TELEMETRY
+# include <Telemetry.h>
+#endif
 
 #if __LPC17xx__
 constexpr size_t NetworkStackWords = 575;
@@ -164,6 +172,9 @@ void Network::Init() noexcept
 	telnetMutex.Create("Telnet");
 	TelnetResponder::InitStatic();
 # endif
+# if SUPPORT_MQTT
+	MqttClient::InitStatic();
+# endif
 
 # if defined(DUET_NG)
 #  if HAS_WIFI_NETWORKING && HAS_W5500_NETWORKING
@@ -285,6 +296,50 @@ GCodeResult Network::ReportProtocols(unsigned int interface, const StringRef& re
 #endif
 }
 
+// Configure the network buffer pool and the quotas of a protocol. Called for M586 with N, B or K parameters.
+//  M586 Nnn					set the number of network buffers
+//  M586 Pn Bnn Knn			set the maximum number of buffers that protocol n may use, and that one connection using it may use. Zero restores the default.
+// With LwIP, received data is held in LwIP's own buffers and not in network buffers, so the quotas only limit the buffers used to send files.
+GCodeResult Network::ConfigureBuffers(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+#if HAS_NETWORKING
+	if (gb.Seen('N'))
+	{
+		const GCodeResult rslt = NetworkBuffer::SetPoolSize(gb.GetLimitedUIValue('N', MaxNetworkBufferCount + 1, MinNetworkBufferCount), reply);
+		if (rslt != GCodeResult::ok)
+		{
+			return rslt;
+		}
+	}
+
+	if (gb.Seen('B') || gb.Seen('K'))
+	{
+		if (!gb.Seen('P'))
+		{
+			reply.copy("missing P parameter");
+			return GCodeResult::error;
+		}
+		const NetworkProtocol protocol = gb.GetLimitedUIValue('P', NumProtocols);
+		const int protocolQuota = (gb.Seen('B')) ? (int)gb.GetLimitedUIValue('B', MaxNetworkBufferCount + 1) : -1;
+		const int connectionQuota = (gb.Seen('K')) ? (int)gb.GetLimitedUIValue('K', MaxNetworkBufferCount + 1) : -1;
+		NetworkBuffer::SetQuotas(protocol, protocolQuota, connectionQuota);
+	}
+	return GCodeResult::ok;
+#else
+	reply.copy(notSupportedText);
+	return GCodeResult::error;
+#endif
+}
+
+// Append the network buffer configuration to a reply
+void Network::ReportBuffers(const StringRef& reply) const noexcept
+{
+#if HAS_NETWORKING
+	reply.cat('\n');
+	NetworkBuffer::ReportQuotas(reply);
+#endif
+}
+
 GCodeResult Network::EnableInterface(unsigned int interface, int mode, const StringRef& ssid, const StringRef& reply) noexcept
 {
 #if HAS_NETWORKING
@@ -389,6 +444,17 @@ void Network::ResetWiFiForUpload(bool external) noexcept
 #endif
 }
 
+// Configure publishing to an MQTT broker. Called for M586.4.
+GCodeResult Network::ConfigureMqtt(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+#if SUPPORT_MQTT
+	return MqttClient::Configure(gb, reply);
+#else
+	reply.copy(notSupportedText);
+	return GCodeResult::error;
+#endif
+}
+
 #if HAS_NETWORKING
 extern "C" [[noreturn]]void NetworkLoop(void *) noexcept
 {
@@ -402,7 +468,7 @@ void Network::Activate() noexcept
 {
 #if HAS_NETWORKING
 	// Allocate network buffers
-	NetworkBuffer::AllocateBuffers(NetworkBufferCount);
+	NetworkBuffer::AllocateBuffers();
 
 	// Activate the interfaces
 	for (NetworkInterface *iface : interfaces)
@@ -435,6 +501,10 @@ void Network::Activate() noexcept
 	}
 # endif
 
+# if SUPPORT_MQTT
+	responders = new MqttClient(responders);
+# endif
+
 	// Finally, create the network task
 	networkTask.Create(NetworkLoop, "NETWORK", nullptr, TaskPriority::SpinPriority);
 #endif
@@ -495,6 +565,21 @@ bool Network::IsWiFiInterface(unsigned int interface) const noexcept
 #endif
 }
 
+// Return true if any interface can send UDP packets
+bool Network::CanSendUdp() const noexcept
+{
+#if HAS_NETWORKING
+	for (const NetworkInterface *iface : interfaces)
+	{
+		if (iface->SupportsUdp())
+		{
+			return true;
+		}
+	}
+#endif
+	return false;
+}
+
 #if HAS_NETWORKING
 
 // Main spin loop
@@ -530,6 +615,10 @@ void Network::Spin() noexcept
 		HttpResponder::CheckSessions();		// time out any sessions that have gone away
 #endif
 
+#if SUPPORT_TELEMETRY
+		PublishTelemetry();
+#endif
+
 		// Keep track of the loop time
 		const uint32_t dt = StepTimer::GetTimerTicks() - lastTime;
 		if (dt < fastLoop)
@@ -545,6 +634,32 @@ void Network::Spin() noexcept
 }
 #endif
 
+#if HAS_NETWORKING && SUPPORT_TELEMETRY
+
+// Send the latest telemetry values if they are due, using the first interface that can send UDP packets
+void Network::PublishTelemetry() noexcept
+{
+	uint8_t packet[Telemetry::MaxPacketLength];
+	IPAddress dest;
+	uint16_t port;
+	const size_t length = Telemetry::GetPacketIfDue(packet, dest, port);
+	if (length != 0)
+	{
+		bool sent = false;
+		for (NetworkInterface *iface : interfaces)
+		{
+			if (iface->SendUdpPacket(dest, port, packet, length))
+			{
+				sent = true;
+				break;
+			}
+		}
+		Telemetry::PacketSent(sent);
+	}
+}
+
+#endif
+
 void Network::Diagnostics(MessageType mtype) noexcept
 {
 #if HAS_NETWORKING
@@ -567,6 +682,8 @@ void Network::Diagnostics(MessageType mtype) noexcept
 	HttpResponder::CommonDiagnostics(mtype);
 #endif
 
+	NetworkBuffer::Diagnostics(mtype);
+
 	for (NetworkInterface *iface : interfaces)
 	{
 		iface->Diagnostics(mtype);
@@ -686,6 +803,23 @@ bool Network::FindResponder(Socket *skt, NetworkProtocol protocol) noexcept
 	return false;
 }
 
+#if SUPPORT_MQTT
+
+// Start opening a connection to a server, using the first interface that can make one
+bool Network::ConnectClient(NetworkProtocol protocol, IPAddress ip, TcpPort port) noexcept
+{
+	for (NetworkInterface *iface : interfaces)
+	{
+		if (iface->ConnectClient(protocol, ip, port))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif
+
 void Network::HandleHttpGCodeReply(const char *msg) noexcept
 {
 #if SUPPORT_HTTP
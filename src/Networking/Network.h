@@ -45,7 +45,7 @@ const size_t NumTelnetResponders = 1;	// the number of concurrent Telnet session
 const size_t NumFtpResponders = 1;		// the number of concurrent FTP sessions we support
 #endif // not __LPC17xx__
 
-#define HAS_RESPONDERS	(SUPPORT_HTTP || SUPPORT_FTP || SUPPORT_TELNET)
+#define HAS_RESPONDERS	(SUPPORT_HTTP || SUPPORT_FTP || SUPPORT_TELNET || SUPPORT_MQTT)
 
 // Forward declarations
 class NetworkResponder;
@@ -81,11 +81,15 @@ public:
 #endif
 	void Diagnostics(MessageType mtype) noexcept;
 	bool IsWiFiInterface(unsigned int interface) const noexcept;
+	bool CanSendUdp() const noexcept;
 
 	GCodeResult EnableInterface(unsigned int interface, int mode, const StringRef& ssid, const StringRef& reply) noexcept;
 	GCodeResult EnableProtocol(unsigned int interface, NetworkProtocol protocol, int port, int secure, const StringRef& reply) noexcept;
 	GCodeResult DisableProtocol(unsigned int interface, NetworkProtocol protocol, const StringRef& reply) noexcept;
 	GCodeResult ReportProtocols(unsigned int interface, const StringRef& reply) const noexcept;
+	GCodeResult ConfigureBuffers(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
+	void ReportBuffers(const StringRef& reply) const noexcept;
+	GCodeResult ConfigureMqtt(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
 
 	// WiFi interfaces
 	GCodeResult HandleWiFiCode(int mcode, GCodeBuffer& gb, const StringRef& reply, OutputBuffer*& longReply);
@@ -110,6 +114,9 @@ public:
 #endif
 
 	bool FindResponder(Socket *skt, NetworkProtocol protocol) noexcept;
+#if SUPPORT_MQTT
+	bool ConnectClient(NetworkProtocol protocol, IPAddress ip, TcpPort port) noexcept;
+#endif
 
 	void HandleHttpGCodeReply(const char *msg) noexcept;
 	void HandleTelnetGCodeReply(const char *msg) noexcept;
@@ -123,6 +130,9 @@ protected:
 
 private:
 	WiFiInterface *FindWiFiInterface() const noexcept;
+#if HAS_NETWORKING && SUPPORT_TELEMETRY
+	void PublishTelemetry() noexcept;
+#endif
 
 	Platform& platform;
 
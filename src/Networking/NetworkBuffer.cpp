@@ -7,16 +7,30 @@
 
 #include "NetworkBuffer.h"
 #include "Storage/FileStore.h"
+#include <Platform.h>
+#include <RepRap.h>
 
 NetworkBuffer *NetworkBuffer::freelist = nullptr;
+unsigned int NetworkBuffer::poolSize = NetworkBufferCount;
+unsigned int NetworkBuffer::numAllocated = 0;
+unsigned int NetworkBuffer::numFree = 0;
+unsigned int NetworkBuffer::minFree = 0;
+NetworkBuffer::ProtocolUsage NetworkBuffer::usage[NumProtocols] = { 0 };
 
-NetworkBuffer::NetworkBuffer(NetworkBuffer *n) noexcept : next(n), dataLength(0), readPointer(0)
+NetworkBuffer::NetworkBuffer(NetworkBuffer *n) noexcept : next(n), dataLength(0), readPointer(0), protocol(AnyProtocol)
 {
 }
 
 // Release this buffer and return the next one in the chain
 NetworkBuffer *NetworkBuffer::Release() noexcept
 {
+	if (protocol < NumProtocols)
+	{
+		--usage[protocol].numInUse;
+	}
+	protocol = AnyProtocol;
+	++numFree;
+
 	NetworkBuffer *ret = next;
 	next = freelist;
 	freelist = this;
@@ -107,24 +121,148 @@ void NetworkBuffer::Empty() noexcept
 	return list;
 }
 
-/*static*/ NetworkBuffer *NetworkBuffer::Allocate() noexcept
+// Return the index into the usage table of a protocol, or NumProtocols if we don't keep track of its buffers.
+// FTP data connections count against the FTP quota.
+/*static*/ size_t NetworkBuffer::GetQuotaIndex(NetworkProtocol protocol) noexcept
 {
-	NetworkBuffer *ret = freelist;
-	if (ret != nullptr)
+	return (protocol == FtpDataProtocol) ? FtpProtocol : (protocol < NumProtocols) ? protocol : NumProtocols;
+}
+
+/*static*/ unsigned int NetworkBuffer::GetProtocolQuota(size_t index) noexcept
+{
+	const unsigned int quota = usage[index].protocolQuota;
+	return (quota == 0 || quota > poolSize) ? poolSize : quota;
+}
+
+// By default one connection may use half the pool, so that a large upload or download can't starve other clients of buffers
+/*static*/ unsigned int NetworkBuffer::GetConnectionQuota(size_t index) noexcept
+{
+	const unsigned int quota = usage[index].connectionQuota;
+	return (quota == 0) ? (poolSize + 1)/2 : quota;
+}
+
+/*static*/ NetworkBuffer *NetworkBuffer::Allocate(NetworkProtocol protocol, unsigned int numHeld) noexcept
+{
+	NetworkBuffer * const ret = freelist;
+	const size_t index = GetQuotaIndex(protocol);
+	if (index < NumProtocols)
+	{
+		ProtocolUsage& u = usage[index];
+		if (numHeld >= GetConnectionQuota(index))
+		{
+			return nullptr;										// this connection has had its share, which doesn't count as waiting
+		}
+		if (ret == nullptr || u.numInUse >= GetProtocolQuota(index))
+		{
+			if (u.whenWaitStarted == 0)
+			{
+				u.whenWaitStarted = max<uint32_t>(millis(), 1);
+			}
+			return nullptr;
+		}
+		if (u.whenWaitStarted != 0)
+		{
+			const uint32_t waitTime = millis() - u.whenWaitStarted;
+			++u.numWaits;
+			u.totalWaitTime += waitTime;
+			if (waitTime > u.longestWait)
+			{
+				u.longestWait = waitTime;
+			}
+			u.whenWaitStarted = 0;
+		}
+		++u.numInUse;
+		if (u.numInUse > u.maxInUse)
+		{
+			u.maxInUse = u.numInUse;
+		}
+	}
+	else if (ret == nullptr)
+	{
+		return nullptr;
+	}
+
+	freelist = ret->next;
+	ret->next = nullptr;
+	ret->dataLength = ret->readPointer = 0;
+	ret->protocol = index;
+	--numFree;
+	if (numFree < minFree)
 	{
-		freelist = ret->next;
-		ret->next = nullptr;
-		ret->dataLength = ret->readPointer = 0;
+		minFree = numFree;
 	}
 	return ret;
 }
 
-/*static*/ void NetworkBuffer::AllocateBuffers(unsigned int number) noexcept
+// Allocate buffers up to the configured pool size. Called when the network is activated at the end of config.g, and if the pool size is increased after that.
+/*static*/ void NetworkBuffer::AllocateBuffers() noexcept
 {
-	while (number != 0)
+	while (numAllocated < poolSize)
 	{
 		freelist = new NetworkBuffer(freelist);
-		--number;
+		++numAllocated;
+		++numFree;
+	}
+	minFree = numFree;
+}
+
+// Set the number of buffers. Buffers are never freed, so once the network has started the pool can only grow.
+/*static*/ GCodeResult NetworkBuffer::SetPoolSize(unsigned int number, const StringRef& reply) noexcept
+{
+	if (number < numAllocated)
+	{
+		reply.printf("Cannot reduce the number of network buffers below %u after the network has started", numAllocated);
+		return GCodeResult::error;
+	}
+	poolSize = number;
+	if (numAllocated != 0)
+	{
+		AllocateBuffers();
+	}
+	return GCodeResult::ok;
+}
+
+// Set the quotas for a protocol. A negative value leaves that quota unchanged and zero restores the default.
+/*static*/ void NetworkBuffer::SetQuotas(NetworkProtocol protocol, int protocolQuota, int connectionQuota) noexcept
+{
+	const size_t index = GetQuotaIndex(protocol);
+	if (index < NumProtocols)
+	{
+		if (protocolQuota >= 0)
+		{
+			usage[index].protocolQuota = (uint8_t)protocolQuota;
+		}
+		if (connectionQuota >= 0)
+		{
+			usage[index].connectionQuota = (uint8_t)connectionQuota;
+		}
+	}
+}
+
+/*static*/ void NetworkBuffer::ReportQuotas(const StringRef& reply) noexcept
+{
+	reply.catf("Network buffers %u", poolSize);
+	for (size_t i = 0; i < NumProtocols; ++i)
+	{
+		reply.catf(", %s max %u per connection %u", ProtocolNames[i], GetProtocolQuota(i), GetConnectionQuota(i));
+	}
+#if HAS_LWIP_NETWORKING
+	reply.cat(" (quotas apply to file sends only, received data uses LwIP buffers)");
+#endif
+}
+
+/*static*/ void NetworkBuffer::Diagnostics(MessageType mtype) noexcept
+{
+	Platform& p = reprap.GetPlatform();
+	p.MessageF(mtype, "Network buffers %u, free %u, min free %u\n", numAllocated, numFree, minFree);
+	minFree = numFree;
+	for (size_t i = 0; i < NumProtocols; ++i)
+	{
+		ProtocolUsage& u = usage[i];
+		p.MessageF(mtype, "%s buffers: in use %u, max %u/%u, waits %" PRIu32 ", longest %" PRIu32 "ms, average %" PRIu32 "ms\n",
+					ProtocolNames[i], u.numInUse, u.maxInUse, GetProtocolQuota(i), u.numWaits, u.longestWait, (u.numWaits == 0) ? 0 : u.totalWaitTime/u.numWaits);
+		u.maxInUse = u.numInUse;
+		u.numWaits = u.totalWaitTime = u.longestWait = 0;
 	}
 }
 
@@ -10,6 +10,7 @@
 
 #include "RepRapFirmware.h"
 #include "NetworkDefs.h"
+#include <GCodes/GCodeResult.h>
 
 #if __LPC17xx__ && HAS_RTOSPLUSTCP_NETWORKING
 # include "RTOSPlusTCPEthernetInterface.h"
@@ -47,6 +48,9 @@ public:
 	// Mark some data as taken
 	void Taken(size_t amount) noexcept { readPointer += amount; }
 
+	// Return the amount of data that has been taken
+	size_t BytesTaken() const noexcept { return readPointer; }
+
 	// Return the length available for writing
 	size_t SpaceLeft() const noexcept { return bufferSize - dataLength; }
 
@@ -70,11 +74,19 @@ public:
 	// Find the last buffer in a list
 	static NetworkBuffer *FindLast(NetworkBuffer *list) noexcept;
 
-	// Allocate a buffer
-	static NetworkBuffer *Allocate() noexcept;
+	// Allocate a buffer for a connection using the specified protocol that already holds numHeld buffers.
+	// Return null if there are no free buffers or the protocol or the connection has used its quota.
+	static NetworkBuffer *Allocate(NetworkProtocol protocol, unsigned int numHeld) noexcept;
+
+	// Allocate buffers up to the configured pool size and put them in the freelist
+	static void AllocateBuffers() noexcept;
 
-	// Alocate buffers and put them in the freelist
-	static void AllocateBuffers(unsigned int number) noexcept;
+	// Set the pool size and quotas
+	static GCodeResult SetPoolSize(unsigned int number, const StringRef& reply) noexcept;
+	static void SetQuotas(NetworkProtocol protocol, int protocolQuota, int connectionQuota) noexcept;
+	static void ReportQuotas(const StringRef& reply) noexcept;
+
+	static void Diagnostics(MessageType mtype) noexcept;
 
 	// Count how many buffers there are in a chain
 	static unsigned int Count(NetworkBuffer*& ptr) noexcept;
@@ -98,12 +110,35 @@ private:
 	uint8_t *Data() noexcept { return reinterpret_cast<uint8_t*>(data32); }
 	const uint8_t *Data() const noexcept { return reinterpret_cast<const uint8_t*>(data32); }
 
+	static size_t GetQuotaIndex(NetworkProtocol protocol) noexcept;
+	static unsigned int GetProtocolQuota(size_t index) noexcept;
+	static unsigned int GetConnectionQuota(size_t index) noexcept;
+
+	// Buffer usage and wait times of one protocol. A wait starts when we refuse to allocate a buffer and ends when we next allocate one.
+	struct ProtocolUsage
+	{
+		uint8_t protocolQuota;								// the most buffers the protocol may hold, or 0 to allow the whole pool
+		uint8_t connectionQuota;							// the most buffers one connection may hold, or 0 to allow half the pool
+		uint8_t numInUse;
+		uint8_t maxInUse;
+		uint32_t whenWaitStarted;							// 0 if we are not waiting
+		uint32_t numWaits;
+		uint32_t totalWaitTime;
+		uint32_t longestWait;
+	};
+
 	NetworkBuffer *next;
 	size_t dataLength;
 	size_t readPointer;
+	NetworkProtocol protocol;								// the protocol we allocated this buffer for
 	// When doing unaligned transfers on the WiFi interface, up to 3 extra bytes may be returned, hence the +1 in the following
 	uint32_t data32[bufferSize/sizeof(uint32_t) + 1];		// 32-bit aligned buffer so we can do direct DMA
 	static NetworkBuffer *freelist;
+	static unsigned int poolSize;							// the number of buffers configured
+	static unsigned int numAllocated;						// the number of buffers we have allocated
+	static unsigned int numFree;
+	static unsigned int minFree;
+	static ProtocolUsage usage[NumProtocols];
 };
 
 #endif /* SRC_NETWORKING_NETWORKBUFFER_H_ */
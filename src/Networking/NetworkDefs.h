@@ -37,8 +37,8 @@ constexpr IPAddress DefaultIpAddress;				// will be initialised to 0 by construc
 constexpr IPAddress DefaultNetMask(0x00FFFFFF);		// equivalent to 255.255.255.0. Use constexpr constructor to avoid it being allocated in RAM.
 constexpr IPAddress DefaultGateway;					// will be initialised to 0 by constructor
 
-constexpr size_t NumProtocols = 3;					// number of network protocols we support, not counting FtpDataProtocol, MdnsProtocol or AnyProtocol
-constexpr NetworkProtocol HttpProtocol = 0, FtpProtocol = 1, TelnetProtocol = 2, FtpDataProtocol = 3, MdnsProtocol = 4, AnyProtocol = 255;
+constexpr size_t NumProtocols = 3;					// number of network protocols we support, not counting FtpDataProtocol, MdnsProtocol, MqttProtocol or AnyProtocol
+constexpr NetworkProtocol HttpProtocol = 0, FtpProtocol = 1, TelnetProtocol = 2, FtpDataProtocol = 3, MdnsProtocol = 4, MqttProtocol = 5, AnyProtocol = 255;
 
 constexpr size_t NumTcpPorts = NumProtocols + 1;
 constexpr TcpPort DefaultHttpPort = 80;
@@ -52,13 +52,19 @@ constexpr uint8_t MdnsMacAddress[6] = { 0x01, 0x00, 0x5E, 0x00, 0x00, 0xFB };
 constexpr uint8_t MdnsIPAddress[4] = { 224, 0, 0, 251 };
 constexpr TcpPort MdnsPort = 5353;
 
+constexpr TcpPort DefaultMqttPort = 1883;			// port of the MQTT broker that we connect to
+
 #if __LPC17xx__
-constexpr size_t NetworkBufferCount = 2;			// number of MSS sized buffers
+constexpr size_t NetworkBufferCount = 2;			// default number of MSS sized buffers
+constexpr size_t MaxNetworkBufferCount = 4;			// maximum number of buffers that M586 N may configure
 #elif SAME70 || SAME5x
-constexpr size_t NetworkBufferCount = 10;			// number of 2K network buffers
+constexpr size_t NetworkBufferCount = 10;			// default number of 2K network buffers
+constexpr size_t MaxNetworkBufferCount = 24;
 #else
-constexpr size_t NetworkBufferCount = 6;			// number of 2K network buffers
+constexpr size_t NetworkBufferCount = 6;			// default number of 2K network buffers
+constexpr size_t MaxNetworkBufferCount = 12;
 #endif
+constexpr size_t MinNetworkBufferCount = 2;
 
 constexpr size_t SsidBufferLength = 32;				// maximum characters in an SSID
 
@@ -44,6 +44,14 @@ public:
 	virtual void OpenDataPort(TcpPort port) noexcept = 0;
 	virtual void TerminateDataPort() noexcept = 0;
 
+	// Send a UDP datagram, returning true if it was queued. Interfaces that don't support UDP return false.
+	virtual bool SupportsUdp() const noexcept { return false; }
+	virtual bool SendUdpPacket(IPAddress dest, TcpPort port, const uint8_t *data, size_t length) noexcept { return false; }
+
+	// Start opening a TCP connection to a server, returning true if the attempt was started. When the connection has been made the socket
+	// is offered to the responders in the same way as an incoming connection. Interfaces that can't make outgoing connections return false.
+	virtual bool ConnectClient(NetworkProtocol protocol, IPAddress ip, TcpPort port) noexcept { return false; }
+
 	Mutex interfaceMutex;							// mutex to protect against multiple tasks using the same interface concurrently. Public so that sockets can lock it.
 
 protected:
@@ -15,7 +15,7 @@ NetworkResponder::NetworkResponder(NetworkResponder *n) noexcept
 	: next(n), responderState(ResponderState::free), skt(nullptr),
 	  outBuf(nullptr),
 #if HAS_MASS_STORAGE
-	  fileBeingSent(nullptr),
+	  fileBeingSent(nullptr), unackedFileBuffers(nullptr), unackedFileBytes(0),
 #endif
 	  fileBuffer(nullptr)
 {
@@ -40,56 +40,74 @@ void NetworkResponder::Commit(ResponderState nextState, bool report) noexcept
 // We send outBuf first, then outStack, and finally fileBeingSent.
 void NetworkResponder::SendData() noexcept
 {
-	// Send our output buffer and output stack
-	for(;;)
+	for (;;)
 	{
-		if (outBuf == nullptr)
+		// Send our output buffer and output stack
+		for(;;)
 		{
-			outBuf = outStack.Pop();
 			if (outBuf == nullptr)
 			{
-				break;
+				outBuf = outStack.Pop();
+				if (outBuf == nullptr)
+				{
+					break;
+				}
 			}
-		}
-		const size_t bytesLeft = outBuf->BytesLeft();
-		if (bytesLeft == 0)
-		{
-			outBuf = OutputBuffer::Release(outBuf);
-		}
-		else
-		{
-			const size_t sent = skt->Send(reinterpret_cast<const uint8_t *>(outBuf->UnreadData()), bytesLeft);
-			if (sent == 0)
+			const size_t bytesLeft = outBuf->BytesLeft();
+			if (bytesLeft == 0)
 			{
-				// Check whether the connection has been closed
-				if (!skt->CanSend())
+				outBuf = OutputBuffer::Release(outBuf);
+			}
+			else
+			{
+				const size_t sent = skt->Send(reinterpret_cast<const uint8_t *>(outBuf->UnreadData()), bytesLeft);
+				if (sent == 0)
 				{
-					// The connection has been lost or the other end has closed it
-					if (reprap.Debug(moduleWebserver))
+					// Check whether the connection has been closed
+					if (!skt->CanSend())
 					{
-						debugPrintf("Can't send anymore\n");
+						// The connection has been lost or the other end has closed it
+						if (reprap.Debug(moduleWebserver))
+						{
+							debugPrintf("Can't send anymore\n");
+						}
+						ConnectionLost();
 					}
-					ConnectionLost();
+					return;
 				}
-				return;
-			}
 
-			outBuf->Taken(sent);				// tell the output buffer how much data we have taken
-			if (sent < bytesLeft)
-			{
-				return;
+				outBuf->Taken(sent);				// tell the output buffer how much data we have taken
+				if (sent < bytesLeft)
+				{
+					return;
+				}
+				outBuf = OutputBuffer::Release(outBuf);
 			}
-			outBuf = OutputBuffer::Release(outBuf);
+		}
+
+		// See whether there is more data to come, for example the next piece of an object model report that is generated as it is sent.
+		// If there is more to come but it isn't ready yet, outBuf is left null and we try again later.
+		if (!GetMoreData())
+		{
+			break;
+		}
+		if (outBuf == nullptr)
+		{
+			return;
 		}
 	}
 
 	// If we get here then there are no output buffers left to send
 
 #if HAS_MASS_STORAGE
+	// File data is read from the card directly into the network buffers. FatFs transfers whole sectors straight into the buffer, and sockets
+	// that send by reference pass the buffer to the TCP stack without copying it, so we keep the buffer until the data has been acknowledged.
+	(void)ReleaseAcknowledgedFileBuffers(skt);
+
 	// If we have a file to send, send it
 	if (fileBeingSent != nullptr && fileBuffer == nullptr)
 	{
-		fileBuffer = NetworkBuffer::Allocate();
+		fileBuffer = NetworkBuffer::Allocate(skt->GetProtocol(), NetworkBuffer::Count(unackedFileBuffers));
 		if (fileBuffer == nullptr)
 		{
 			return;					// no buffer available, try again later
@@ -135,6 +153,14 @@ void NetworkResponder::SendData() noexcept
 			}
 
 			fileBuffer->Taken(sent);
+			if (fileBuffer->IsEmpty() && skt->SendsByReference())
+			{
+				// The socket may still need this data, so use a new buffer for the next part of the file
+				unackedFileBytes += fileBuffer->BytesTaken();
+				NetworkBuffer::AppendToList(&unackedFileBuffers, fileBuffer);
+				fileBuffer = nullptr;
+				return;
+			}
 
 			if (   sent < remaining				// if we couldn't send it all...
 				|| fileBuffer->IsEmpty()		// ...or if we've sent the whole buffer, return to allow other sockets to be polled
@@ -149,6 +175,18 @@ void NetworkResponder::SendData() noexcept
 	// If we get here then there is nothing left to send
 	skt->Send();						// tell the socket there is no more data
 
+#if HAS_MASS_STORAGE
+	// Don't finish until the socket no longer needs the file data we sent, because the buffers may be reused as soon as we release them
+	if (!ReleaseAcknowledgedFileBuffers(skt))
+	{
+		if (!skt->CanSend())
+		{
+			ConnectionLost();
+		}
+		return;
+	}
+#endif
+
 	// If we are going to free up this responder after sending, then we must close the connection
 	if (stateAfterSending == ResponderState::free)
 	{
@@ -172,21 +210,52 @@ void NetworkResponder::ConnectionLost() noexcept
 	}
 #endif
 
+	if (skt != nullptr)
+	{
+		skt->Terminate();
+		skt = nullptr;
+	}
+
+	// Release the file buffers after terminating the socket, so that the TCP stack no longer refers to them
 	if (fileBuffer != nullptr)
 	{
 		fileBuffer->Release();
 		fileBuffer = nullptr;
 	}
 
-	if (skt != nullptr)
+#if HAS_MASS_STORAGE
+	while (unackedFileBuffers != nullptr)
 	{
-		skt->Terminate();
-		skt = nullptr;
+		unackedFileBuffers = unackedFileBuffers->Release();
 	}
+	unackedFileBytes = 0;
+#endif
 
 	responderState = ResponderState::free;
 }
 
+#if HAS_MASS_STORAGE
+
+// Release the file buffers at the start of the list whose data the sending socket has had acknowledged. Return true if there are none left.
+// The socket's count of unacknowledged data includes data sent after those buffers, which is the rest of the list and the part of the
+// current buffer that we have sent. It may also include the response headers sent before the file, which only delays releasing the first buffer.
+bool NetworkResponder::ReleaseAcknowledgedFileBuffers(Socket *sendingSocket) noexcept
+{
+	if (unackedFileBuffers != nullptr)
+	{
+		const size_t unacked = sendingSocket->GetUnacknowledgedBytes();
+		const size_t currentBytesSent = (fileBuffer != nullptr) ? fileBuffer->BytesTaken() : 0;
+		while (unackedFileBuffers != nullptr && unacked <= unackedFileBytes - unackedFileBuffers->BytesTaken() + currentBytesSent)
+		{
+			unackedFileBytes -= unackedFileBuffers->BytesTaken();
+			unackedFileBuffers = unackedFileBuffers->Release();
+		}
+	}
+	return unackedFileBuffers == nullptr;
+}
+
+#endif
+
 IPAddress NetworkResponder::GetRemoteIP() const noexcept
 {
 	return (skt == nullptr) ? IPAddress() : skt->GetRemoteIP();
@@ -44,6 +44,7 @@ protected:
 		// HTTP responder additional states
 		processingRequest,
 		gettingFileInfo,								// getting file info
+		waitingForModelChange,							// holding an object model request until the model changes
 
 		// FTP responder additional states
 		waitingForPasvPort,
@@ -53,7 +54,12 @@ protected:
 
 		// Telnet responder additional states
 		justConnected,
-		authenticating
+		authenticating,
+
+		// MQTT client additional states
+		connectingToBroker,								// waiting for the connection to the broker to be made
+		waitingForConnack,								// sent CONNECT, waiting for the broker to accept it
+		connectedToBroker								// ready to publish
 	};
 
 	NetworkResponder(NetworkResponder *n) noexcept;
@@ -61,6 +67,10 @@ protected:
 	void Commit(ResponderState nextState = ResponderState::free, bool report = true) noexcept;
 	virtual void SendData() noexcept;
 	virtual void ConnectionLost() noexcept;
+	virtual bool GetMoreData() noexcept { return false; }	// called when the output buffers have been sent, to generate more data to send
+#if HAS_MASS_STORAGE
+	bool ReleaseAcknowledgedFileBuffers(Socket *sendingSocket) noexcept;
+#endif
 
 	IPAddress GetRemoteIP() const noexcept;
 	void ReportOutputBufferExhaustion(const char *sourceFile, int line) noexcept;
@@ -80,6 +90,8 @@ protected:
 	OutputStack outStack;								// not volatile because only one task accesses it
 #if HAS_MASS_STORAGE
 	FileStore *fileBeingSent;
+	NetworkBuffer *unackedFileBuffers;					// file buffers that we have sent but the socket may still refer to, oldest first
+	size_t unackedFileBytes;							// the amount of data in unackedFileBuffers
 #endif
 	NetworkBuffer *fileBuffer;
 };
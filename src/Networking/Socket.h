@@ -14,6 +14,7 @@
 const uint32_t FindResponderTimeout = 2000;		// how long we wait for a responder to become available
 const uint32_t MaxAckTime = 4000;				// how long we wait for a connection to acknowledge the remaining data before it is closed
 const uint32_t MaxWriteTime = 2000;				// how long we wait for a write operation to complete before it is cancelled
+const uint32_t MaxConnectTime = 5000;			// how long we wait for an outgoing connection to be established
 
 
 class NetworkInterface;
@@ -44,6 +45,10 @@ public:
 	virtual size_t Send(const uint8_t *data, size_t length) noexcept = 0;
 	virtual void Send() noexcept = 0;
 
+	// Sockets that refer to the data passed to Send until it has been acknowledged, instead of copying it, override these
+	virtual bool SendsByReference() const noexcept { return false; }
+	virtual size_t GetUnacknowledgedBytes() const noexcept { return 0; }
+
 protected:
 	enum class SocketState : uint8_t
 	{
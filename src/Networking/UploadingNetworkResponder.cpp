@@ -68,6 +68,9 @@ bool UploadingNetworkResponder::StartUpload(const char* folder, const char *file
 			return false;
 		}
 		fileBeingUploaded.Set(file);
+#if SUPPORT_FILE_WRITE_BEHIND
+		fileBeingUploaded.StartWriteBehind();			// so that we can receive more data while the card is being written
+#endif
 		dummyUpload = false;
 	}
 	responderState = ResponderState::uploading;
@@ -80,8 +83,8 @@ void UploadingNetworkResponder::FinishUpload(uint32_t fileLength, time_t fileLas
 {
 	if (!dummyUpload)
 	{
-		// Flush remaining data for FSO
-		if (!fileBeingUploaded.Flush())
+		// Flush remaining data for FSO and truncate the file to the data written, because pre-allocating space sets the file size
+		if (!fileBeingUploaded.Truncate())
 		{
 			uploadError = true;
 			GetPlatform().Message(ErrorMessage, "Could not flush remaining data while finishing upload\n");
@@ -129,6 +132,12 @@ void UploadingNetworkResponder::FinishUpload(uint32_t fileLength, time_t fileLas
 					// Update the file timestamp if it was specified
 					(void)MassStorage::SetLastModifiedTime(origFilename.c_str(), fileLastModified);
 				}
+
+				// If it is a file that can be printed, parse it now so that the file info is ready when the user looks for it
+				if (MassStorage::IsPrintableFile(origFilename.c_str()))
+				{
+					MassStorage::QueueFileInfo(origFilename.c_str());
+				}
 			}
 			filenameBeingProcessed.Clear();
 		}
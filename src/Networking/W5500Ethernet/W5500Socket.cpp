@@ -269,7 +269,7 @@ void W5500Socket::ReceiveData() noexcept
 		}
 		else if (NetworkBuffer::Count(receivedData) < MaxBuffersPerSocket)
 		{
-			NetworkBuffer * const buf = NetworkBuffer::Allocate();
+			NetworkBuffer * const buf = NetworkBuffer::Allocate(protocol, NetworkBuffer::Count(receivedData));
 			if (buf != nullptr)
 			{
 				wiz_recv_data(socketNum, buf->Data(), len);
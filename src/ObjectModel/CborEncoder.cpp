@@ -0,0 +1,80 @@
+/*
+ * CborEncoder.cpp
+ *
+ *  Created on: 12 Oct 2020
+ *      Author: David
+ */
+
+#include "CborEncoder.h"
+
+// Write the initial bytes of a data item, using the shortest form that can hold the value
+void CborEncoder::WriteHead(OutputBuffer *buf, uint8_t majorType, uint64_t val) noexcept
+{
+	char bytes[9];
+	size_t numBytes;
+	majorType <<= 5;
+	if (val < 24)
+	{
+		bytes[0] = (char)(majorType | (uint8_t)val);
+		numBytes = 1;
+	}
+	else
+	{
+		const unsigned int numValueBytes = (val <= 0xFF) ? 1 : (val <= 0xFFFF) ? 2 : (val <= 0xFFFFFFFF) ? 4 : 8;
+		bytes[0] = (char)(majorType | ((numValueBytes == 1) ? 24 : (numValueBytes == 2) ? 25 : (numValueBytes == 4) ? 26 : 27));
+		for (unsigned int i = numValueBytes; i != 0; --i)
+		{
+			bytes[i] = (char)(uint8_t)val;					// CBOR is big-endian
+			val >>= 8;
+		}
+		numBytes = numValueBytes + 1;
+	}
+	buf->cat(bytes, numBytes);
+}
+
+void CborEncoder::WriteSigned(OutputBuffer *buf, int64_t val) noexcept
+{
+	if (val < 0)
+	{
+		WriteHead(buf, MajorNegative, (uint64_t)(-1 - val));
+	}
+	else
+	{
+		WriteHead(buf, MajorUnsigned, (uint64_t)val);
+	}
+}
+
+// Write a float. We write zero as an integer, like the JSON report does, and we use half precision if it represents the value exactly.
+void CborEncoder::WriteFloat(OutputBuffer *buf, float val) noexcept
+{
+	if (val == 0.0)
+	{
+		WriteHead(buf, MajorUnsigned, 0);
+		return;
+	}
+
+	uint32_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	const uint32_t exponent = (bits >> 23) & 0xFF;
+	const uint32_t mantissa = bits & 0x007FFFFF;
+	if (exponent >= 127 - 14 && exponent <= 127 + 15 && (mantissa & 0x1FFF) == 0)
+	{
+		// Normal number that half precision represents exactly
+		const uint16_t half = (uint16_t)(((bits >> 16) & 0x8000) | ((exponent - 127 + 15) << 10) | (mantissa >> 13));
+		const char bytes[3] = { (char)0xF9, (char)(half >> 8), (char)half };
+		buf->cat(bytes, sizeof(bytes));
+	}
+	else
+	{
+		const char bytes[5] = { (char)0xFA, (char)(bits >> 24), (char)(bits >> 16), (char)(bits >> 8), (char)bits };
+		buf->cat(bytes, sizeof(bytes));
+	}
+}
+
+void CborEncoder::WriteText(OutputBuffer *buf, const char *s, size_t len) noexcept
+{
+	WriteHead(buf, MajorText, len);
+	buf->cat(s, len);
+}
+
+// End
@@ -0,0 +1,41 @@
+/*
+ * CborEncoder.h
+ *
+ *  Created on: 12 Oct 2020
+ *      Author: David
+ */
+
+#ifndef SRC_OBJECTMODEL_CBORENCODER_H_
+#define SRC_OBJECTMODEL_CBORENCODER_H_
+
+#include <RepRapFirmware.h>
+#include <OutputMemory.h>
+
+// Functions to write values in CBOR (RFC 8949) binary format to an output buffer. Used for binary object model reports.
+// Maps and arrays are written with indefinite length, so that we don't need to know the number of members before we start.
+class CborEncoder
+{
+public:
+	static void WriteUnsigned(OutputBuffer *buf, uint64_t val) noexcept { WriteHead(buf, MajorUnsigned, val); }
+	static void WriteSigned(OutputBuffer *buf, int64_t val) noexcept;
+	static void WriteFloat(OutputBuffer *buf, float val) noexcept;
+	static void WriteText(OutputBuffer *buf, const char *s) noexcept { WriteText(buf, s, strlen(s)); }
+	static void WriteText(OutputBuffer *buf, const char *s, size_t len) noexcept;
+	static void WriteBool(OutputBuffer *buf, bool b) noexcept { buf->cat((char)((b) ? 0xF5 : 0xF4)); }
+	static void WriteNull(OutputBuffer *buf) noexcept { buf->cat((char)0xF6); }
+	static void WriteEmptyMap(OutputBuffer *buf) noexcept { buf->cat((char)0xA0); }
+	static void StartMap(OutputBuffer *buf) noexcept { buf->cat((char)0xBF); }
+	static void StartArray(OutputBuffer *buf) noexcept { buf->cat((char)0x9F); }
+	static void EndContainer(OutputBuffer *buf) noexcept { buf->cat((char)0xFF); }
+
+private:
+	CborEncoder() = delete;
+
+	static constexpr uint8_t MajorUnsigned = 0;
+	static constexpr uint8_t MajorNegative = 1;
+	static constexpr uint8_t MajorText = 3;
+
+	static void WriteHead(OutputBuffer *buf, uint8_t majorType, uint64_t val) noexcept;
+};
+
+#endif /* SRC_OBJECTMODEL_CBORENCODER_H_ */
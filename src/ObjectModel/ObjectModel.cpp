@@ -12,14 +12,123 @@
 #include <RepRap.h>
 #include <Platform.h>
 #include <OutputMemory.h>
+#include <Movement/StepTimer.h>
 #include <cstring>
 #include <General/SafeStrtod.h>
 #include <General/IP4String.h>
+#include "CborEncoder.h"
+#include "ObjectModelQuery.h"
 
 ExpressionValue::ExpressionValue(const MacAddress& mac) noexcept : type((uint32_t)TypeCode::MacAddress), param(mac.HighWord()), uVal(mac.LowWord())
 {
 }
 
+// Functions to write the parts of a report that are common to several value types, in JSON or CBOR binary format as requested by the report flags
+
+static void ReportNull(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (context.BinaryReport())
+	{
+		CborEncoder::WriteNull(buf);
+	}
+	else
+	{
+		buf->cat("null");
+	}
+}
+
+static void ReportUnsigned(OutputBuffer *buf, const ObjectExplorationContext& context, uint64_t val) noexcept
+{
+	if (context.BinaryReport())
+	{
+		CborEncoder::WriteUnsigned(buf, val);
+	}
+	else if (val <= 0xFFFFFFFF)
+	{
+		buf->AppendUnsigned((uint32_t)val);
+	}
+	else
+	{
+		buf->catf("%" PRIu64, val);
+	}
+}
+
+static void ReportEmptyObject(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (context.BinaryReport())
+	{
+		CborEncoder::WriteEmptyMap(buf);
+	}
+	else
+	{
+		buf->cat("{}");
+	}
+}
+
+// Write the name of an object member, preceded by the start of the object if it is the first member
+static void ReportMemberName(OutputBuffer *buf, const ObjectExplorationContext& context, const char *name, bool first) noexcept
+{
+	if (context.BinaryReport())
+	{
+		if (first)
+		{
+			CborEncoder::StartMap(buf);
+		}
+		CborEncoder::WriteText(buf, name);
+	}
+	else
+	{
+		buf->cat((first) ? "{\"" : ",\"");
+		buf->cat(name);
+		buf->cat("\":");
+	}
+}
+
+static void ReportEndObject(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (context.BinaryReport())
+	{
+		CborEncoder::EndContainer(buf);
+	}
+	else
+	{
+		buf->cat('}');
+	}
+}
+
+static void ReportStartArray(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (context.BinaryReport())
+	{
+		CborEncoder::StartArray(buf);
+	}
+	else
+	{
+		buf->cat('[');
+	}
+}
+
+// Write the separator before an array element other than the first. CBOR doesn't need one.
+static void ReportArraySeparator(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (!context.BinaryReport())
+	{
+		buf->cat(',');
+	}
+}
+
+static void ReportEndArray(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (context.BinaryReport())
+	{
+		CborEncoder::EndContainer(buf);
+	}
+	else
+	{
+		buf->cat(']');
+	}
+}
+
 // Append a string representation of this value to a string
 void ExpressionValue::AppendAsString(const StringRef& str) const noexcept
 {
@@ -166,6 +275,111 @@ void ExpressionValue::ExtractRequestedPart(const StringRef& rslt) const noexcept
 
 #endif
 
+// Add a value to an aggregate, returning false if it is of the wrong type
+// Null values are ignored. The count operation counts values that are neither null nor false.
+bool ArrayAggregator::Accumulate(const ExpressionValue& val) noexcept
+{
+	bool isFloatValue;
+	int32_t iv = 0;
+	float fv = 0.0;
+	switch (val.GetType())
+	{
+	case TypeCode::None:
+		return true;
+
+	case TypeCode::Bool:
+		if (op != Operation::count)
+		{
+			return false;
+		}
+		if (val.bVal)
+		{
+			++numValues;
+		}
+		return true;
+
+	case TypeCode::Int32:
+		iv = val.iVal;
+		isFloatValue = false;
+		break;
+
+	case TypeCode::Uint32:
+		iv = (int32_t)val.uVal;
+		isFloatValue = false;
+		break;
+
+	case TypeCode::Float:
+		fv = val.fVal;
+		isFloatValue = true;
+		break;
+
+	default:
+		if (op != Operation::count)
+		{
+			return false;
+		}
+		++numValues;
+		return true;
+	}
+
+	if (op != Operation::count)
+	{
+		if (isFloatValue && !isFloat)
+		{
+			fResult = (float)iResult;						// switch to floating point
+			isFloat = true;
+		}
+
+		if (isFloat)
+		{
+			const float f = (isFloatValue) ? fv : (float)iv;
+			fResult = (numValues == 0) ? f
+						: (op == Operation::min) ? min<float>(fResult, f)
+							: (op == Operation::max) ? max<float>(fResult, f)
+								: fResult + f;
+			if (isFloatValue)
+			{
+				decimals = max<uint8_t>(decimals, val.param);
+			}
+		}
+		else
+		{
+			iResult = (numValues == 0) ? iv
+						: (op == Operation::min) ? min<int32_t>(iResult, iv)
+							: (op == Operation::max) ? max<int32_t>(iResult, iv)
+								: iResult + iv;
+		}
+	}
+	++numValues;
+	return true;
+}
+
+ExpressionValue ArrayAggregator::GetResult() const noexcept
+{
+	switch (op)
+	{
+	case Operation::count:
+		return ExpressionValue((int32_t)numValues);
+
+	case Operation::sum:
+		return (isFloat) ? ExpressionValue(fResult, decimals) : ExpressionValue(iResult);
+
+	case Operation::mean:
+		if (numValues == 0)
+		{
+			return ExpressionValue(nullptr);
+		}
+		return ExpressionValue(((isFloat) ? fResult : (float)iResult)/numValues, constrain<uint8_t>(decimals + 1, 1, MaxFloatDigitsDisplayedAfterPoint));
+
+	default:
+		if (numValues == 0)
+		{
+			return ExpressionValue(nullptr);
+		}
+		return (isFloat) ? ExpressionValue(fResult, decimals) : ExpressionValue(iResult);
+	}
+}
+
 void ObjectExplorationContext::AddIndex(int32_t index) THROWS(GCodeException)
 {
 	if (numIndicesCounted == MaxIndices)
@@ -213,9 +427,9 @@ ObjectModel::ObjectModel() noexcept
 
 // Constructor used when reporting the OM as JSON
 ObjectExplorationContext::ObjectExplorationContext(bool wal, const char *reportFlags, unsigned int initialMaxDepth) noexcept
-	: startMillis(millis()), maxDepth(initialMaxDepth), currentDepth(0), numIndicesProvided(0), numIndicesCounted(0),
-	  line(-1), column(-1),
-	  shortForm(false), onlyLive(false), includeVerbose(false), wantArrayLength(wal), includeNulls(false)
+	: startMillis(millis()), maxDepth(initialMaxDepth), currentDepth(0), numIndicesProvided(0), numIndicesCounted(0), aggregator(nullptr),
+	  changedSince(0), line(-1), column(-1),
+	  shortForm(false), onlyLive(false), includeVerbose(false), wantArrayLength(wal), includeNulls(false), binary(false), ignoreClocks(false)
 {
 	while (true)
 	{
@@ -235,6 +449,9 @@ ObjectExplorationContext::ObjectExplorationContext(bool wal, const char *reportF
 		case 'n':
 			includeNulls = true;
 			break;
+		case 'b':
+			binary = true;
+			break;
 		case 'd':
 			maxDepth = 0;
 			while (isdigit(*reportFlags))
@@ -243,6 +460,14 @@ ObjectExplorationContext::ObjectExplorationContext(bool wal, const char *reportF
 				++reportFlags;
 			}
 			break;
+		case 'c':
+			changedSince = 0;
+			while (isdigit(*reportFlags))
+			{
+				changedSince = (10 * changedSince) + (*reportFlags - '0');
+				++reportFlags;
+			}
+			break;
 		case ' ':
 		case ',':
 			break;
@@ -255,9 +480,9 @@ ObjectExplorationContext::ObjectExplorationContext(bool wal, const char *reportF
 
 // Constructor when evaluating expressions
 ObjectExplorationContext::ObjectExplorationContext(bool wal, int p_line, int p_col) noexcept
-	: startMillis(millis()), maxDepth(99), currentDepth(0), numIndicesProvided(0), numIndicesCounted(0),
-	  line(p_line), column(p_col),
-	  shortForm(false), onlyLive(false), includeVerbose(true), wantArrayLength(wal), includeNulls(false)
+	: startMillis(millis()), maxDepth(99), currentDepth(0), numIndicesProvided(0), numIndicesCounted(0), aggregator(nullptr),
+	  changedSince(0), line(p_line), column(p_col),
+	  shortForm(false), onlyLive(false), includeVerbose(true), wantArrayLength(wal), includeNulls(false), binary(false), ignoreClocks(false)
 {
 }
 
@@ -282,7 +507,8 @@ int32_t ObjectExplorationContext::GetLastIndex() const THROWS(GCodeException)
 bool ObjectExplorationContext::ShouldReport(const ObjectModelEntryFlags f) const noexcept
 {
 	return (!onlyLive || ((uint8_t)f & (uint8_t)ObjectModelEntryFlags::live) != 0)
-		&& (includeVerbose || ((uint8_t)f & (uint8_t)ObjectModelEntryFlags::verbose) == 0);
+		&& (includeVerbose || ((uint8_t)f & (uint8_t)ObjectModelEntryFlags::verbose) == 0)
+		&& (!ignoreClocks || ((uint8_t)f & (uint8_t)ObjectModelEntryFlags::clock) == 0);
 }
 
 GCodeException ObjectExplorationContext::ConstructParseException(const char *msg) const noexcept
@@ -321,7 +547,7 @@ void ObjectModel::ReportAsJson(OutputBuffer* buf, ObjectExplorationContext& cont
 				size_t numEntries = descriptor[tableNumber + 1];
 				while (numEntries != 0)
 				{
-					if (tbl->Matches(filter, context))
+					if (tbl->Matches(filter, context) && !(context.IsDeltaReport() && IsUnchangedSince(*tbl, context)))
 					{
 						if (tbl->ReportAsJson(buf, context, classDescriptor, this, filter, !added))
 						{
@@ -343,24 +569,47 @@ void ObjectModel::ReportAsJson(OutputBuffer* buf, ObjectExplorationContext& cont
 		{
 			if (*filter == 0)
 			{
-				buf->cat('}');
+				ReportEndObject(buf, context);
 			}
 		}
+		else if (*filter == 0)
+		{
+			ReportEmptyObject(buf, context);
+		}
 		else
 		{
-			buf->cat((*filter == 0) ? "{}" : "null");
+			ReportNull(buf, context);
 		}
 		context.DecreaseDepth();
 	}
 	else
 	{
-		buf->cat("{}");
+		ReportEmptyObject(buf, context);
 	}
 }
 
 // Construct a JSON representation of those parts of the object model requested by the user. This version is called on the root of the tree.
+// If the filter uses the query syntax then we report all the parts it selects in one walk of the model.
 void ObjectModel::ReportAsJson(OutputBuffer *buf, const char *filter, const char *reportFlags, bool wantArrayLength) const THROWS(GCodeException)
 {
+	if (!wantArrayLength && ObjectModelQuery::IsQuery(filter))
+	{
+		ObjectModelQuery * const query = new ObjectModelQuery;		// this is too big to put on the stack
+		try
+		{
+			query->Parse(filter);
+			ObjectExplorationContext context(false, reportFlags, 99);
+			ReportQueryAsJson(buf, context, nullptr, 0, *query, query->GetFirstNode());
+		}
+		catch (...)
+		{
+			delete query;
+			throw;
+		}
+		delete query;
+		return;
+	}
+
 	const unsigned int defaultMaxDepth = (wantArrayLength) ? 99 : (filter[0] == 0) ? 1 : 99;
 	ObjectExplorationContext context(wantArrayLength, reportFlags, defaultMaxDepth);
 	ReportAsJson(buf, context, nullptr, 0, filter);
@@ -383,7 +632,7 @@ inline void ObjectModel::ReportItemAsJson(OutputBuffer *buf, ObjectExplorationCo
 			|| val.omVal == nullptr					// OM arrays may contain null entries, so we need to handle them here
 		   )
 		{
-			buf->cat("null");
+			ReportNull(buf, context);
 		}
 		else
 		{
@@ -405,24 +654,24 @@ void ObjectModel::ReportArrayLengthAsJson(OutputBuffer *buf, ObjectExplorationCo
 	switch (val.GetType())
 	{
 	case TypeCode::Array:
-		buf->catf("%u", val.omadVal->GetNumElements(this, context));
+		ReportUnsigned(buf, context, val.omadVal->GetNumElements(this, context));
 		break;
 
 	case TypeCode::Bitmap16:
 	case TypeCode::Bitmap32:
-		buf->catf("%u", Bitmap<uint32_t>::MakeFromRaw(val.uVal).CountSetBits());
+		ReportUnsigned(buf, context, Bitmap<uint32_t>::MakeFromRaw(val.uVal).CountSetBits());
 		break;
 
 	case TypeCode::Bitmap64:
-		buf->catf("%u", Bitmap<uint64_t>::MakeFromRaw(val.Get56BitValue()).CountSetBits());
+		ReportUnsigned(buf, context, Bitmap<uint64_t>::MakeFromRaw(val.Get56BitValue()).CountSetBits());
 		break;
 
 	case TypeCode::CString:
-		buf->catf("%u", strlen(val.sVal));
+		ReportUnsigned(buf, context, strlen(val.sVal));
 		break;
 
 	default:
-		buf->cat("null");
+		ReportNull(buf, context);
 		break;
 	}
 }
@@ -432,6 +681,27 @@ void ObjectModel::ReportArrayLengthAsJson(OutputBuffer *buf, ObjectExplorationCo
 void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor,
 										const ExpressionValue& val, const char *filter) const THROWS(GCodeException)
 {
+	if (context.BinaryReport())
+	{
+		switch (val.GetType())
+		{
+		case TypeCode::Char:
+		case TypeCode::IPAddress:
+		case TypeCode::DateTime:
+		case TypeCode::DriverId:
+		case TypeCode::MacAddress:
+		case TypeCode::Special:
+#if SUPPORT_CAN_EXPANSION
+		case TypeCode::CanExpansionBoardDetails:
+#endif
+			ReportAsCborText(buf, val);			// these are all reported as strings
+			return;
+
+		default:
+			break;
+		}
+	}
+
 	switch (val.GetType())
 	{
 	case TypeCode::Array:
@@ -448,12 +718,12 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 				const int32_t index = StrToI32(filter, &endptr);
 				if (endptr == filter || *endptr != ']' || index < 0 || (size_t)index >= val.omadVal->GetNumElements(this, context))
 				{
-					buf->cat("null");					// avoid returning badly-formed JSON
+					ReportNull(buf, context);			// avoid returning badly-formed JSON
 					break;								// invalid syntax, or index out of range
 				}
 				if (*filter == 0)
 				{
-					buf->cat('[');
+					ReportStartArray(buf, context);
 				}
 				context.AddIndex(index);
 				{
@@ -465,7 +735,7 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 				context.RemoveIndex();
 				if (*filter == 0)
 				{
-					buf->cat(']');
+					ReportEndArray(buf, context);
 				}
 			}
 		}
@@ -475,28 +745,49 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 		}
 		else
 		{
-			buf->cat("null");
+			ReportNull(buf, context);
 		}
 		break;
 
 	case TypeCode::Float:
-		ReportFloat(buf, val);
+		if (context.BinaryReport())
+		{
+			CborEncoder::WriteFloat(buf, val.fVal);
+		}
+		else
+		{
+			ReportFloat(buf, val);
+		}
 		break;
 
 	case TypeCode::Uint32:
-		buf->catf("%" PRIu32, val.uVal);
+		ReportUnsigned(buf, context, val.uVal);
 		break;
 
 	case TypeCode::Uint64:
-		buf->catf("%" PRIu64, ((uint64_t)val.param << 32) | val.uVal);	// convert unsigned integer to string
+		ReportUnsigned(buf, context, ((uint64_t)val.param << 32) | val.uVal);
 		break;
 
 	case TypeCode::Int32:
-		buf->catf("%" PRIi32, val.iVal);
+		if (context.BinaryReport())
+		{
+			CborEncoder::WriteSigned(buf, val.iVal);
+		}
+		else
+		{
+			buf->AppendInt(val.iVal);
+		}
 		break;
 
 	case TypeCode::CString:
-		buf->catf("\"%.s\"", val.sVal);
+		if (context.BinaryReport())
+		{
+			CborEncoder::WriteText(buf, val.sVal);
+		}
+		else
+		{
+			buf->catf("\"%.s\"", val.sVal);
+		}
 		break;
 
 #if SUPPORT_CAN_EXPANSION
@@ -520,22 +811,22 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 				const int32_t index = StrToI32(filter, &endptr);
 				if (endptr == filter || *endptr != ']' || index < 0 || (size_t)index >= val.omadVal->GetNumElements(this, context))
 				{
-					buf->cat("null");				// avoid returning badly-formed JSON
+					ReportNull(buf, context);		// avoid returning badly-formed JSON
 					break;							// invalid syntax, or index out of range
 				}
 				const auto bm = Bitmap<uint32_t>::MakeFromRaw(val.uVal);
-				buf->catf("%u", bm.GetSetBitNumber(index));
+				ReportUnsigned(buf, context, bm.GetSetBitNumber(index));
 				break;
 			}
 		}
 		else if (context.ShortFormReport())
 		{
-			buf->catf("%" PRIu32, val.uVal);
+			ReportUnsigned(buf, context, val.uVal);
 			break;
 		}
 
 		// If we get here then we want a long form report
-		ReportBitmap1632Long(buf, val);
+		ReportBitmap1632Long(buf, val, context.BinaryReport());
 		break;
 
 	case TypeCode::Bitmap64:
@@ -552,28 +843,32 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 				const int32_t index = StrToI32(filter, &endptr);
 				if (endptr == filter || *endptr != ']' || index < 0 || (size_t)index >= val.omadVal->GetNumElements(this, context))
 				{
-					buf->cat("null");				// avoid returning badly-formed JSON
+					ReportNull(buf, context);		// avoid returning badly-formed JSON
 					break;							// invalid syntax, or index out of range
 				}
 				const auto bm = Bitmap<uint64_t>::MakeFromRaw(val.uVal);
-				buf->catf("%u", bm.GetSetBitNumber(index));
+				ReportUnsigned(buf, context, bm.GetSetBitNumber(index));
 				break;
 			}
 		}
 		else if (context.ShortFormReport())
 		{
-			buf->catf("%" PRIu64, val.Get56BitValue());
+			ReportUnsigned(buf, context, val.Get56BitValue());
 			break;
 		}
 
 		// If we get here then we want a long form report
-		ReportBitmap64Long(buf, val);
+		ReportBitmap64Long(buf, val, context.BinaryReport());
 		break;
 
 	case TypeCode::Enum32:
 		if (context.ShortFormReport())
 		{
-			buf->catf("%" PRIu32, val.uVal);
+			ReportUnsigned(buf, context, val.uVal);
+		}
+		else if (context.BinaryReport())
+		{
+			CborEncoder::WriteText(buf, "unimplemented");
 		}
 		else
 		{
@@ -583,7 +878,14 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 		break;
 
 	case TypeCode::Bool:
-		buf->cat((val.bVal) ? "true" : "false");
+		if (context.BinaryReport())
+		{
+			CborEncoder::WriteBool(buf, val.bVal);
+		}
+		else
+		{
+			buf->cat((val.bVal) ? "true" : "false");
+		}
 		break;
 
 	case TypeCode::Char:
@@ -635,7 +937,7 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 		break;
 
 	case TypeCode::None:
-		buf->cat("null");
+		ReportNull(buf, context);
 		break;
 
 	case TypeCode::ObjectModel:
@@ -643,29 +945,153 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 	}
 }
 
+// Report the members of this object that are selected by the query nodes starting at firstNode and their siblings
+void ObjectModel::ReportQueryAsJson(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor * null classDescriptor, uint8_t tableNumber,
+										const ObjectModelQuery& query, uint8_t firstNode) const THROWS(GCodeException)
+{
+	if (!context.IncreaseDepth())
+	{
+		ReportEmptyObject(buf, context);
+		return;
+	}
+
+	bool added = false;
+	if (classDescriptor == nullptr)
+	{
+		classDescriptor = GetObjectModelClassDescriptor();
+	}
+
+	while (classDescriptor != nullptr)
+	{
+		const uint8_t * const descriptor = classDescriptor->omd;
+		if (tableNumber < descriptor[0])
+		{
+			const ObjectModelTableEntry *tbl = classDescriptor->omt;
+			for (size_t i = 0; i < tableNumber; ++i)
+			{
+				tbl += descriptor[i + 1];
+			}
+
+			for (size_t numEntries = descriptor[tableNumber + 1]; numEntries != 0; --numEntries, ++tbl)
+			{
+				const uint8_t node = query.FindNode(firstNode, tbl->name);
+				if (node != ObjectModelQuery::NoNode && context.ShouldReport(tbl->flags) && !(context.IsDeltaReport() && IsUnchangedSince(*tbl, context)))
+				{
+					const ExpressionValue val = tbl->func(this, context);
+					if (val.GetType() != TypeCode::None || context.ShouldIncludeNulls())
+					{
+						ReportMemberName(buf, context, tbl->name, !added);
+						added = true;
+						ReportQueryItemAsJson(buf, context, classDescriptor, val, query, node, false);
+					}
+				}
+			}
+		}
+		if (tableNumber != 0)
+		{
+			break;
+		}
+		classDescriptor = classDescriptor->parent;			// do parent table too
+	}
+
+	if (added)
+	{
+		ReportEndObject(buf, context);
+	}
+	else
+	{
+		ReportEmptyObject(buf, context);
+	}
+	context.DecreaseDepth();
+}
+
+// Report a value selected by a query node. If the node has a subscript that we haven't applied yet then the value must be an array.
+// An array selected without a subscript but with a projection is treated as if the subscript was [*].
+void ObjectModel::ReportQueryItemAsJson(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor,
+											const ExpressionValue& val, const ObjectModelQuery& query, uint8_t nodeNumber, bool subscripted) const THROWS(GCodeException)
+{
+	const ObjectModelQuery::Node& node = query.GetNode(nodeNumber);
+	if (!subscripted && (node.subscript != ObjectModelQuery::SubscriptType::none || (val.GetType() == TypeCode::Array && !node.whole)))
+	{
+		if (val.GetType() != TypeCode::Array)
+		{
+			ReportNull(buf, context);
+			return;
+		}
+
+		const ObjectModelArrayDescriptor * const omad = val.omadVal;
+		ReadLocker lock(omad->lockPointer);
+		const int32_t count = (int32_t)omad->GetNumElements(this, context);
+		if (node.subscript == ObjectModelQuery::SubscriptType::index)
+		{
+			const int32_t index = (node.first < 0) ? count + node.first : node.first;
+			if (index < 0 || index >= count)
+			{
+				ReportNull(buf, context);
+				return;
+			}
+			context.AddIndex(index);
+			const ExpressionValue element = omad->GetElement(this, context);
+			ReportQueryItemAsJson(buf, context, classDescriptor, element, query, nodeNumber, true);
+			context.RemoveIndex();
+			return;
+		}
+
+		const int32_t first = (node.first < 0) ? max<int32_t>(count + node.first, 0) : min<int32_t>(node.first, count);
+		const int32_t last = (node.last == ObjectModelQuery::NoBound) ? count : (node.last < 0) ? count + node.last : min<int32_t>(node.last, count);
+		ReportStartArray(buf, context);
+		for (int32_t i = first; i < last; ++i)
+		{
+			if (i != first)
+			{
+				ReportArraySeparator(buf, context);
+			}
+			context.AddIndex(i);
+			const ExpressionValue element = omad->GetElement(this, context);
+			ReportQueryItemAsJson(buf, context, classDescriptor, element, query, nodeNumber, true);
+			context.RemoveIndex();
+		}
+		ReportEndArray(buf, context);
+	}
+	else if (node.whole || node.firstChild == ObjectModelQuery::NoNode)
+	{
+		ReportItemAsJson(buf, context, classDescriptor, val, "");
+	}
+	else if (val.GetType() == TypeCode::ObjectModel && val.omVal != nullptr)
+	{
+		val.omVal->ReportQueryAsJson(buf, context, (val.omVal == this) ? classDescriptor : nullptr, val.param, query, node.firstChild);
+	}
+	else
+	{
+		ReportNull(buf, context);
+	}
+}
+
 // Report an entire array as JSON
 void ObjectModel::ReportArrayAsJson(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor,
 										const ObjectModelArrayDescriptor *omad, const char *filter) const THROWS(GCodeException)
 {
 	ReadLocker lock(omad->lockPointer);
 
-	buf->cat('[');
+	ReportStartArray(buf, context);
 	const size_t count = omad->GetNumElements(this, context);
 	for (size_t i = 0; i < count; ++i)
 	{
 		if (i != 0)
 		{
-			buf->cat(',');
+			ReportArraySeparator(buf, context);
 		}
 		context.AddIndex(i);
 		const ExpressionValue element = omad->GetElement(this, context);
 		ReportItemAsJson(buf, context, classDescriptor, element, filter);
 		context.RemoveIndex();
 	}
-	buf->cat(']');
+	ReportEndArray(buf, context);
 }
 
 // Find the requested entry
+// Normally we use the perfect hash computed at compile time, so this costs one hash and one string comparison.
+// An empty or wildcard ID matches any entry, so for those we fall back to a binary search to give the same result as before.
 const ObjectModelTableEntry* ObjectModel::FindObjectModelTableEntry(const ObjectModelClassDescriptor *classDescriptor, uint8_t tableNumber, const char* idString) const noexcept
 {
 	const uint8_t * const descriptor = classDescriptor->omd;
@@ -674,13 +1100,19 @@ const ObjectModelTableEntry* ObjectModel::FindObjectModelTableEntry(const Object
 		return nullptr;
 	}
 
-	const ObjectModelTableEntry *tbl = classDescriptor->omt;
-	for (size_t i = 0; i < tableNumber; ++i)
+	const ObjectModelTableHashInfo& hashInfo = classDescriptor->hashInfo[tableNumber];
+	const ObjectModelTableEntry * const tbl = classDescriptor->omt + hashInfo.firstEntry;
+	if (idString[0] != 0 && idString[0] != '*')
 	{
-		tbl += descriptor[i + 1];
+		const uint8_t slot = classDescriptor->hashSlots[hashInfo.firstSlot + (ObjectModelTableEntry::Hash(idString, hashInfo.seed) & hashInfo.slotMask)];
+		return (slot != 0 && tbl[slot - 1].IdCompare(idString) == 0) ? &tbl[slot - 1] : nullptr;
 	}
 
-	const size_t numEntries = descriptor[tableNumber + 1];
+	return SearchObjectModelTable(tbl, descriptor[tableNumber + 1], idString);
+}
+
+/*static*/ const ObjectModelTableEntry *ObjectModel::SearchObjectModelTable(const ObjectModelTableEntry *tbl, size_t numEntries, const char *idString) noexcept
+{
 	size_t low = 0, high = numEntries;
 	while (high > low)
 	{
@@ -715,6 +1147,55 @@ const ObjectModelTableEntry* ObjectModel::FindObjectModelTableEntry(const Object
 	return id;
 }
 
+bool ObjectModel::TimeTableLookups(unsigned int iterations, uint32_t& hashTicks, uint32_t& searchTicks, size_t& numNames, size_t& numTables) const noexcept
+{
+	const ObjectModelClassDescriptor * const classDescriptor = GetObjectModelClassDescriptor();
+	const uint8_t * const descriptor = classDescriptor->omd;
+	numTables = descriptor[0];
+	numNames = 0;
+	for (size_t t = 0; t < numTables; ++t)
+	{
+		numNames += descriptor[t + 1];
+	}
+
+	// Both loops look up the same names in the same order and count the failures rather than stopping at the first one, so that they do the same work
+	unsigned int numErrors = 0;
+	uint32_t startTime = StepTimer::GetTimerTicks();
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		for (size_t t = 0; t < numTables; ++t)
+		{
+			const ObjectModelTableEntry * const tbl = classDescriptor->omt + classDescriptor->hashInfo[t].firstEntry;
+			for (size_t j = 0; j < descriptor[t + 1]; ++j)
+			{
+				if (FindObjectModelTableEntry(classDescriptor, t, tbl[j].name) != &tbl[j])
+				{
+					++numErrors;
+				}
+			}
+		}
+	}
+	hashTicks = StepTimer::GetTimerTicks() - startTime;
+
+	startTime = StepTimer::GetTimerTicks();
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		for (size_t t = 0; t < numTables; ++t)
+		{
+			const ObjectModelTableEntry * const tbl = classDescriptor->omt + classDescriptor->hashInfo[t].firstEntry;
+			for (size_t j = 0; j < descriptor[t + 1]; ++j)
+			{
+				if (SearchObjectModelTable(tbl, descriptor[t + 1], tbl[j].name) != &tbl[j])
+				{
+					++numErrors;
+				}
+			}
+		}
+	}
+	searchTicks = StepTimer::GetTimerTicks() - startTime;
+	return numErrors == 0;
+}
+
 bool ObjectModelTableEntry::Matches(const char* filterString, const ObjectExplorationContext& context) const noexcept
 {
 	return IdCompare(filterString) == 0 && context.ShouldReport(flags);
@@ -729,9 +1210,7 @@ bool ObjectModelTableEntry::ReportAsJson(OutputBuffer* buf, ObjectExplorationCon
 	{
 		if (*filter == 0)
 		{
-			buf->cat((first) ? "{\"" : ",\"");
-			buf->cat(name);
-			buf->cat("\":");
+			ReportMemberName(buf, context, name, first);
 		}
 		self->ReportItemAsJson(buf, context, classDescriptor, val, nextElement);
 		return true;
@@ -791,6 +1270,15 @@ ExpressionValue ObjectModel::GetObjectValue(ObjectExplorationContext& context, c
 	{
 	case TypeCode::Array:
 		{
+			if (context.GetAggregator() != nullptr && (*idString == 0 || *idString == '['))
+			{
+				AggregateArray(context, classDescriptor, val.omadVal, idString);
+				return ExpressionValue(nullptr);
+			}
+			if (*idString == '[')
+			{
+				throw context.ConstructParseException("'[]' may only be used in the argument of an aggregate function");
+			}
 			if (*idString == 0)
 			{
 				if (context.WantArrayLength())
@@ -936,6 +1424,52 @@ ExpressionValue ObjectModel::GetObjectValue(ObjectExplorationContext& context, c
 	throw context.ConstructParseException("reached primitive type before end of selector string");
 }
 
+// Pass the values of all elements of an array, or of a member of each element, to the aggregator in the context
+// If idString starts with '[' then the array was followed by [] and the expression parser has provided a placeholder index for it, which we replace by each element index in turn.
+// Otherwise the array was the last element of the path and we aggregate the element values directly.
+void ObjectModel::AggregateArray(ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor, const ObjectModelArrayDescriptor *omad, const char *idString) const THROWS(GCodeException)
+{
+	ArrayAggregator * const aggregator = context.GetAggregator();
+	ReadLocker lock(omad->lockPointer);
+
+	const size_t numElements = omad->GetNumElements(this, context);
+	const bool wildcard = (*idString == '[');
+	if (wildcard)
+	{
+		context.AddIndex();											// count the placeholder index
+		idString += 2;												// skip the []
+	}
+	else
+	{
+		context.AddIndex(0);
+	}
+
+	const size_t numIndicesCounted = context.GetNumIndicesCounted();
+	for (size_t i = 0; i < numElements; ++i)
+	{
+		context.SelectWildcardElement(numIndicesCounted, (int32_t)i);		// this also discards any indices used by nested arrays in the previous element
+		const ExpressionValue element = omad->GetElement(this, context);
+		if (element.GetType() != TypeCode::None)					// skip null entries, e.g. unused heater slots
+		{
+			const ExpressionValue elementVal = (*idString == 0) ? element : GetObjectValue(context, classDescriptor, element, idString);
+			if (!aggregator->Accumulate(elementVal))		// nested aggregation returns null, which is ignored
+			{
+				throw context.ConstructParseException("array elements must be numeric");
+			}
+		}
+	}
+
+	if (wildcard)
+	{
+		context.SelectWildcardElement(numIndicesCounted, 0);
+	}
+	else
+	{
+		context.RemoveIndex();
+	}
+	aggregator->SetAggregated();
+}
+
 // Separate function to avoid the tm object (44 bytes) being allocated on the stack frame of a recursive function
 void ObjectModel::ReportDateTime(OutputBuffer *buf, const ExpressionValue& val) noexcept
 {
@@ -946,6 +1480,14 @@ void ObjectModel::ReportDateTime(OutputBuffer *buf, const ExpressionValue& val)
 				timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday, timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec);
 }
 
+// Separate function to avoid the string being allocated on the stack frame of a recursive function
+void ObjectModel::ReportAsCborText(OutputBuffer *buf, const ExpressionValue& val) noexcept
+{
+	String<MaxFilenameLength> rslt;
+	val.AppendAsString(rslt.GetRef());
+	CborEncoder::WriteText(buf, rslt.c_str(), rslt.strlen());
+}
+
 // Separate function to avoid a recursive function saving all the FP registers
 void ObjectModel::ReportFloat(OutputBuffer *buf, const ExpressionValue& val) noexcept
 {
@@ -959,13 +1501,21 @@ void ObjectModel::ReportFloat(OutputBuffer *buf, const ExpressionValue& val) noe
 	}
 	else
 	{
-		buf->catf(val.GetFloatFormatString(), (double)val.fVal);
+		buf->AppendFloat(val.fVal, val.param);
 	}
 }
 
-void ObjectModel::ReportBitmap1632Long(OutputBuffer *buf, const ExpressionValue& val) noexcept
+void ObjectModel::ReportBitmap1632Long(OutputBuffer *buf, const ExpressionValue& val, bool binary) noexcept
 {
 	const auto bm = Bitmap<uint32_t>::MakeFromRaw(val.uVal);
+	if (binary)
+	{
+		CborEncoder::StartArray(buf);
+		bm.Iterate([buf](unsigned int bn, unsigned int count) noexcept { CborEncoder::WriteUnsigned(buf, bn); });
+		CborEncoder::EndContainer(buf);
+		return;
+	}
+
 	buf->cat('[');
 	bm.Iterate
 		([buf](unsigned int bn, unsigned int count) noexcept
@@ -980,9 +1530,17 @@ void ObjectModel::ReportBitmap1632Long(OutputBuffer *buf, const ExpressionValue&
 	buf->cat(']');
 }
 
-void ObjectModel::ReportBitmap64Long(OutputBuffer *buf, const ExpressionValue& val) noexcept
+void ObjectModel::ReportBitmap64Long(OutputBuffer *buf, const ExpressionValue& val, bool binary) noexcept
 {
 	const auto bm = Bitmap<uint64_t>::MakeFromRaw(val.Get56BitValue());
+	if (binary)
+	{
+		CborEncoder::StartArray(buf);
+		bm.Iterate([buf](unsigned int bn, unsigned int count) noexcept { CborEncoder::WriteUnsigned(buf, bn); });
+		CborEncoder::EndContainer(buf);
+		return;
+	}
+
 	buf->cat('[');
 	bm.Iterate
 		([buf](unsigned int bn, unsigned int count) noexcept
@@ -1016,6 +1574,355 @@ ExpressionValue ObjectModel::GetExpansionBoardDetailLength(const ExpressionValue
 
 #endif
 
+// Write the start of a report, up to the point where the result goes. The change sequence number is reported if the flags request a delta report.
+/*static*/ void ObjectModel::ReportHeader(OutputBuffer *buf, const char *key, const char *flags, uint32_t seq, bool binary) noexcept
+{
+	const bool wantSeq = (strchr(flags, 'c') != nullptr);
+	if (binary)
+	{
+		CborEncoder::StartMap(buf);
+		CborEncoder::WriteText(buf, "key");
+		CborEncoder::WriteText(buf, key);
+		CborEncoder::WriteText(buf, "flags");
+		CborEncoder::WriteText(buf, flags);
+		if (wantSeq)
+		{
+			CborEncoder::WriteText(buf, "seq");
+			CborEncoder::WriteUnsigned(buf, seq);
+		}
+		CborEncoder::WriteText(buf, "result");
+	}
+	else
+	{
+		buf->catf("{\"key\":\"%.s\",\"flags\":\"%.s\"", key, flags);
+		if (wantSeq)
+		{
+			buf->catf(",\"seq\":%" PRIu32, seq);
+		}
+		buf->cat(",\"result\":");
+	}
+}
+
+// Write the end of a report
+/*static*/ void ObjectModel::ReportTrailer(OutputBuffer *buf, bool binary) noexcept
+{
+	if (binary)
+	{
+		CborEncoder::EndContainer(buf);
+	}
+	else
+	{
+		buf->cat("}\n");
+	}
+}
+
+// ObjectModelReportCursor members
+
+// Return the entry with the specified index in a table. When the table number is zero, the entries of the parent classes follow those of the class itself.
+// On return, classDescriptor is the descriptor of the class that the entry belongs to.
+static const ObjectModelTableEntry *GetTableEntry(const ObjectModelClassDescriptor *& classDescriptor, uint8_t tableNumber, size_t index) noexcept
+{
+	while (classDescriptor != nullptr)
+	{
+		const uint8_t * const descriptor = classDescriptor->omd;
+		if (tableNumber < descriptor[0])
+		{
+			if (index < descriptor[tableNumber + 1])
+			{
+				const ObjectModelTableEntry *tbl = classDescriptor->omt;
+				for (size_t i = 0; i < tableNumber; ++i)
+				{
+					tbl += descriptor[i + 1];
+				}
+				return tbl + index;
+			}
+			index -= descriptor[tableNumber + 1];
+		}
+		if (tableNumber != 0)
+		{
+			break;
+		}
+		classDescriptor = classDescriptor->parent;
+	}
+	return nullptr;
+}
+
+ObjectModelReportCursor::ObjectModelReportCursor(const ObjectModel *p_root, const char *p_key, const char *p_flags, uint32_t p_seq) noexcept
+	: root(p_root), rootDescriptor(p_root->GetObjectModelClassDescriptor()), seq(p_seq), sectionIndex(0), numLevels(0),
+	  stage(Stage::header), wholeModel(p_key[0] == 0), sectionAdded(false)
+{
+	key.copy(p_key);
+	flags.copy(p_flags);
+}
+
+// Create a cursor, returning null if the report can't be generated incrementally
+/*static*/ ObjectModelReportCursor *ObjectModelReportCursor::Create(const ObjectModel *root, const char *key, const char *flags, uint32_t seq) noexcept
+{
+	if (key == nullptr) { key = ""; }
+	if (flags == nullptr) { flags = ""; }
+	if (strlen(key) >= StringLength50 || strlen(flags) >= StringLength20)
+	{
+		return nullptr;
+	}
+
+	size_t index = 0;
+	if (key[0] != 0)
+	{
+		// The key must be exactly the name of a top-level entry
+		const ObjectModelClassDescriptor * const classDescriptor = root->GetObjectModelClassDescriptor();
+		const ObjectModelTableEntry * const entry = root->FindObjectModelTableEntry(classDescriptor, 0, key);
+		if (entry == nullptr || strcmp(entry->GetName(), key) != 0)
+		{
+			return nullptr;
+		}
+		index = entry - classDescriptor->omt;
+	}
+
+	ObjectModelReportCursor * const cursor = new ObjectModelReportCursor(root, key, flags, seq);
+	if (cursor != nullptr)
+	{
+		cursor->sectionIndex = index;
+	}
+	return cursor;
+}
+
+// Append the next pieces of the report to the buffer until it holds at least the target length or the report is complete.
+// The output is the same as RepRap::GetModelResponse would produce for the same key and flags.
+void ObjectModelReportCursor::GetNextPieces(OutputBuffer *buf, size_t targetLength) THROWS(GCodeException)
+{
+	ObjectExplorationContext context(false, flags.c_str(), (wholeModel) ? 1 : 99);
+	const bool rootDepthOk = context.IncreaseDepth();
+	while (stage != Stage::finished && buf->Length() < targetLength && !buf->HadOverflow())
+	{
+		switch (stage)
+		{
+		case Stage::header:
+			ObjectModel::ReportHeader(buf, key.c_str(), flags.c_str(), seq, context.BinaryReport());
+			if (rootDepthOk)
+			{
+				stage = Stage::sections;
+			}
+			else
+			{
+				ReportEmptyObject(buf, context);
+				stage = Stage::trailer;
+			}
+			break;
+
+		case Stage::sections:
+			{
+				const ObjectModelClassDescriptor *classDescriptor = rootDescriptor;
+				const ObjectModelTableEntry * const entry = GetTableEntry(classDescriptor, 0, sectionIndex);
+				if (entry == nullptr)
+				{
+					// We have reported all the top-level entries
+					if (sectionAdded)
+					{
+						ReportEndObject(buf, context);
+					}
+					else
+					{
+						ReportEmptyObject(buf, context);
+					}
+					stage = Stage::trailer;
+				}
+				else if (numLevels == 0)
+				{
+					StartSection(buf, context, classDescriptor, entry);
+				}
+				else
+				{
+					ContinueLevel(buf, context, 0, root, classDescriptor, entry->func(root, context));
+				}
+			}
+			break;
+
+		case Stage::trailer:
+			ObjectModel::ReportTrailer(buf, context.BinaryReport());
+			stage = Stage::finished;
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+// Start reporting a top-level entry
+void ObjectModelReportCursor::StartSection(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor, const ObjectModelTableEntry *entry) THROWS(GCodeException)
+{
+	bool wanted = entry->Matches("", context) && !(context.IsDeltaReport() && root->IsUnchangedSince(*entry, context));
+	ExpressionValue val;
+	if (wanted)
+	{
+		val = entry->func(root, context);
+		wanted = val.GetType() != TypeCode::None || context.ShouldIncludeNulls();
+	}
+
+	if (!wanted)
+	{
+		if (!wholeModel)
+		{
+			ReportNull(buf, context);
+		}
+		NextSection();
+		return;
+	}
+
+	if (wholeModel)
+	{
+		ReportMemberName(buf, context, entry->GetName(), !sectionAdded);
+		sectionAdded = true;
+	}
+	StartItem(buf, context, root, classDescriptor, val);
+}
+
+// Start reporting a value that belongs to 'owner'. If it is an array or object and we have a spare level then we leave it open so that we can report its
+// elements or members one at a time, otherwise we report all of it.
+void ObjectModelReportCursor::StartItem(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModel *owner, const ObjectModelClassDescriptor *ownerDescriptor,
+											const ExpressionValue& val) THROWS(GCodeException)
+{
+	if (numLevels < MaxLevels)
+	{
+		if (val.GetType() == TypeCode::Array)
+		{
+			ReportStartArray(buf, context);
+			levels[numLevels++] = Level{ 0, LevelKind::array, false };
+			return;
+		}
+		if (val.GetType() == TypeCode::ObjectModel && val.omVal != nullptr && context.IncreaseDepth())
+		{
+			context.DecreaseDepth();
+			levels[numLevels++] = Level{ 0, LevelKind::object, false };		// the object is started when we report its first member
+			return;
+		}
+	}
+	owner->ReportItemAsJson(buf, context, ownerDescriptor, val, "");
+	ItemDone();
+}
+
+// Find our place in the array or object at the specified level, whose value is 'val', and report its next piece or close it.
+// We call this recursively to get from the top-level entry to the innermost open level, holding the locks and indices that the full report would hold.
+void ObjectModelReportCursor::ContinueLevel(OutputBuffer *buf, ObjectExplorationContext& context, size_t level, const ObjectModel *owner,
+												const ObjectModelClassDescriptor *ownerDescriptor, const ExpressionValue& val) THROWS(GCodeException)
+{
+	Level& lv = levels[level];
+	if (lv.kind == LevelKind::array)
+	{
+		if (val.GetType() == TypeCode::Array)
+		{
+			const ObjectModelArrayDescriptor * const omad = val.omadVal;
+			ReadLocker lock(omad->lockPointer);
+			if (lv.index < omad->GetNumElements(owner, context))
+			{
+				context.AddIndex(lv.index);
+				const ExpressionValue element = omad->GetElement(owner, context);
+				if (level + 1 < numLevels)
+				{
+					ContinueLevel(buf, context, level + 1, owner, ownerDescriptor, element);
+				}
+				else
+				{
+					if (lv.added)
+					{
+						ReportArraySeparator(buf, context);
+					}
+					lv.added = true;
+					StartItem(buf, context, owner, ownerDescriptor, element);
+				}
+				context.RemoveIndex();
+				return;
+			}
+		}
+	}
+	else if (val.GetType() == TypeCode::ObjectModel && val.omVal != nullptr)
+	{
+		const ObjectModel * const obj = val.omVal;
+		const ObjectModelClassDescriptor *objDescriptor = (obj == owner) ? ownerDescriptor : obj->GetObjectModelClassDescriptor();
+		const ObjectModelTableEntry * const tbl = GetTableEntry(objDescriptor, val.param, lv.index);
+		if (tbl != nullptr)
+		{
+			(void)context.IncreaseDepth();				// we checked that this succeeds when we opened the object
+			if (level + 1 < numLevels)
+			{
+				ContinueLevel(buf, context, level + 1, obj, objDescriptor, tbl->func(obj, context));
+			}
+			else if (tbl->Matches("", context) && !(context.IsDeltaReport() && obj->IsUnchangedSince(*tbl, context)))
+			{
+				const ExpressionValue member = tbl->func(obj, context);
+				if (member.GetType() != TypeCode::None || context.ShouldIncludeNulls())
+				{
+					ReportMemberName(buf, context, tbl->GetName(), !lv.added);
+					lv.added = true;
+					StartItem(buf, context, obj, objDescriptor, member);
+				}
+				else
+				{
+					ItemDone();
+				}
+			}
+			else
+			{
+				ItemDone();
+			}
+			context.DecreaseDepth();
+			return;
+		}
+	}
+
+	// There are no more elements or members, or the value has changed type since we opened it
+	CloseLevels(buf, context, level);
+}
+
+// Close the arrays and objects from the specified level inwards and move on to the next item of the enclosing one
+void ObjectModelReportCursor::CloseLevels(OutputBuffer *buf, const ObjectExplorationContext& context, size_t level) noexcept
+{
+	while (numLevels > level)
+	{
+		const Level& lv = levels[--numLevels];
+		if (lv.kind == LevelKind::array)
+		{
+			ReportEndArray(buf, context);
+		}
+		else if (lv.added)
+		{
+			ReportEndObject(buf, context);
+		}
+		else
+		{
+			ReportEmptyObject(buf, context);
+		}
+	}
+	ItemDone();
+}
+
+// Move on from the item we just finished to the next one at the same level
+void ObjectModelReportCursor::ItemDone() noexcept
+{
+	if (numLevels == 0)
+	{
+		NextSection();
+	}
+	else
+	{
+		++levels[numLevels - 1].index;
+	}
+}
+
+// Move on from the current top-level entry
+void ObjectModelReportCursor::NextSection() noexcept
+{
+	numLevels = 0;
+	if (wholeModel)
+	{
+		++sectionIndex;
+	}
+	else
+	{
+		stage = Stage::trailer;
+	}
+}
+
 #endif
 
 // End
@@ -15,6 +15,7 @@
 
 #include <General/IPAddress.h>
 #include <General/Bitmap.h>
+#include <General/FreelistManager.h>
 #include <RTOSIface/RTOSIface.h>
 #include <Networking/NetworkDefs.h>
 
@@ -151,6 +152,32 @@ struct ExpressionValue
 #endif
 };
 
+// Class used to accumulate the elements of an array when evaluating an aggregate function such as max() or sum()
+class ArrayAggregator
+{
+public:
+	enum class Operation : uint8_t { min, max, sum, mean, count };
+
+	ArrayAggregator(Operation p_op) noexcept : iResult(0), numValues(0), op(p_op), decimals(0), isFloat(false), aggregated(false) { }
+
+	bool Accumulate(const ExpressionValue& val) noexcept;			// add a value, returning false if it has an unsuitable type
+	void SetAggregated() noexcept { aggregated = true; }			// flag that the argument was an array and we have processed it
+	bool HasAggregated() const noexcept { return aggregated; }
+	ExpressionValue GetResult() const noexcept;
+
+private:
+	union
+	{
+		int32_t iResult;
+		float fResult;
+	};
+	uint32_t numValues;
+	Operation op;
+	uint8_t decimals;
+	bool isFloat;
+	bool aggregated;
+};
+
 // Flags field of a table entry
 enum class ObjectModelEntryFlags : uint8_t
 {
@@ -162,6 +189,10 @@ enum class ObjectModelEntryFlags : uint8_t
 	// canAlter can be or'ed in
 	canAlter = 4,			// we can alter this value
 	liveCanAlter = 5,		// we can alter this value
+
+	// clock can be or'ed in
+	clock = 8,				// this value follows the clock, so it is left out when checking whether the live values have changed
+	liveClock = 9,			// live and follows the clock
 };
 
 // Context passed to object model functions
@@ -188,7 +219,15 @@ public:
 	bool ShouldReport(const ObjectModelEntryFlags f) const noexcept;
 	bool WantArrayLength() const noexcept { return wantArrayLength; }
 	bool ShouldIncludeNulls() const noexcept { return includeNulls; }
+	void SetIgnoreClocks() noexcept { ignoreClocks = true; }
+	bool BinaryReport() const noexcept { return binary; }
+	bool IsDeltaReport() const noexcept { return changedSince != 0; }
+	uint32_t GetChangedSince() const noexcept { return changedSince; }
 	uint64_t GetStartMillis() const { return startMillis; }
+	void SetAggregator(ArrayAggregator *agg) noexcept { aggregator = agg; }
+	ArrayAggregator *GetAggregator() const noexcept { return aggregator; }
+	void SelectWildcardElement(size_t numCounted, int32_t index) noexcept pre(numCounted != 0)
+		{ numIndicesCounted = numCounted; indices[numCounted - 1] = index; }
 
 	GCodeException ConstructParseException(const char *msg) const noexcept;
 	GCodeException ConstructParseException(const char *msg, const char *sparam) const noexcept;
@@ -202,13 +241,17 @@ private:
 	size_t numIndicesProvided;						// the number of indices provided, when we are doing a value lookup
 	size_t numIndicesCounted;						// the number of indices passed in the search string
 	int32_t indices[MaxIndices];
+	ArrayAggregator *aggregator;					// non-null if we are evaluating the argument of an aggregate function
+	uint32_t changedSince;							// if nonzero, only report sections that changed after this sequence number
 	int line;
 	int column;
 	unsigned int shortForm : 1,
 				onlyLive : 1,
 				includeVerbose : 1,
 				wantArrayLength : 1,
-				includeNulls : 1;
+				includeNulls : 1,
+				binary : 1,
+				ignoreClocks : 1;
 };
 
 // Entry to describe an array of objects or values. These must be brace-initializable into flash memory.
@@ -221,17 +264,24 @@ public:
 };
 
 struct ObjectModelClassDescriptor;
+class ObjectModelQuery;
 
 // Class from which other classes that represent part of the object model are derived
 class ObjectModel
 {
 public:
+	friend class ObjectModelReportCursor;
+
 	ObjectModel() noexcept;
 	virtual ~ObjectModel() { }
 
 	// Construct a JSON representation of those parts of the object model requested by the user. This version is called on the root of the tree.
 	void ReportAsJson(OutputBuffer *buf, const char *filter, const char *reportFlags, bool wantArrayLength) const THROWS(GCodeException);
 
+	// Write the parts of a report that go before and after the result, in JSON or CBOR binary format
+	static void ReportHeader(OutputBuffer *buf, const char *key, const char *flags, uint32_t seq, bool binary) noexcept;
+	static void ReportTrailer(OutputBuffer *buf, bool binary) noexcept;
+
 	// Get the value of an object via the table
 	ExpressionValue GetObjectValue(ObjectExplorationContext& context, const ObjectModelClassDescriptor * null classDescriptor, const char *idString, uint8_t tableNumber = 0) const THROWS(GCodeException);
 
@@ -242,30 +292,50 @@ public:
 	// Skip the current element in the ID or filter string
 	static const char* GetNextElement(const char *id) noexcept;
 
+	// Time looking up every name in every section of our table using the perfect hash and using a binary search, for M122 P108.
+	// Return false if either method failed to find the right entry for any name.
+	bool TimeTableLookups(unsigned int iterations, uint32_t& hashTicks, uint32_t& searchTicks, size_t& numNames, size_t& numTables) const noexcept;
+
 protected:
 	// Construct a JSON representation of those parts of the object model requested by the user
 	void ReportAsJson(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor * null classDescriptor, uint8_t tableNumber, const char *filter) const THROWS(GCodeException);
 
+	// Report the parts of an object selected by the sibling query nodes starting at firstNode
+	void ReportQueryAsJson(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor * null classDescriptor, uint8_t tableNumber,
+							const ObjectModelQuery& query, uint8_t firstNode) const THROWS(GCodeException);
+
 	// Report an entire array as JSON
 	void ReportArrayAsJson(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor, const ObjectModelArrayDescriptor *omad, const char *filter) const THROWS(GCodeException);
 
 	// Get the value of an object that we hold
 	ExpressionValue GetObjectValue(ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor, const ExpressionValue& val, const char *idString) const THROWS(GCodeException);
 
+	// Pass the values of all elements of an array, or of a member of each element, to the aggregator in the context
+	void AggregateArray(ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor, const ObjectModelArrayDescriptor *omad, const char *idString) const THROWS(GCodeException);
+
 	// Get the object model table entry for the current level object in the query
 	const ObjectModelTableEntry *FindObjectModelTableEntry(const ObjectModelClassDescriptor *classDescriptor, uint8_t tableNumber, const char *idString) const noexcept;
 
+	// Find an entry in a section of the object model table using a binary search. We use this for IDs that the perfect hash can't handle.
+	static const ObjectModelTableEntry *SearchObjectModelTable(const ObjectModelTableEntry *tbl, size_t numEntries, const char *idString) noexcept;
+
 	virtual const ObjectModelClassDescriptor *GetObjectModelClassDescriptor() const noexcept = 0;
 
+	// Return true if the value of a table entry hasn't changed since the sequence number in the context, so it can be left out of a delta report
+	virtual bool IsUnchangedSince(const ObjectModelTableEntry& entry, ObjectExplorationContext& context) const noexcept { return false; }
+
 private:
 	// These functions have been separated from ReportItemAsJson to avoid high stack usage in the recursive functions, therefore they must not be inlined
 	__attribute__ ((noinline)) void ReportArrayLengthAsJson(OutputBuffer *buf, ObjectExplorationContext& context, const ExpressionValue& val) const noexcept;
 	__attribute__ ((noinline)) void ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor,
 															const ExpressionValue& val, const char *filter) const THROWS(GCodeException);
+	__attribute__ ((noinline)) void ReportQueryItemAsJson(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor,
+															const ExpressionValue& val, const ObjectModelQuery& query, uint8_t node, bool subscripted) const THROWS(GCodeException);
 	__attribute__ ((noinline)) static void ReportDateTime(OutputBuffer *buf, const ExpressionValue& val) noexcept;
 	__attribute__ ((noinline)) static void ReportFloat(OutputBuffer *buf, const ExpressionValue& val) noexcept;
-	__attribute__ ((noinline)) static void ReportBitmap1632Long(OutputBuffer *buf, const ExpressionValue& val) noexcept;
-	__attribute__ ((noinline)) static void ReportBitmap64Long(OutputBuffer *buf, const ExpressionValue& val) noexcept;
+	__attribute__ ((noinline)) static void ReportBitmap1632Long(OutputBuffer *buf, const ExpressionValue& val, bool binary) noexcept;
+	__attribute__ ((noinline)) static void ReportBitmap64Long(OutputBuffer *buf, const ExpressionValue& val, bool binary) noexcept;
+	__attribute__ ((noinline)) static void ReportAsCborText(OutputBuffer *buf, const ExpressionValue& val) noexcept;
 
 #if SUPPORT_CAN_EXPANSION
 	__attribute__ ((noinline)) static void ReportExpansionBoardDetail(OutputBuffer *buf, const ExpressionValue& val) noexcept;
@@ -326,6 +396,111 @@ public:
 	{
 		return IsOrdered(descriptor[0], descriptor + 1, omt);
 	}
+
+	// Hash a field name or the first element of an ID. The element ends at the end of the string or at the start of the next element.
+	static inline constexpr uint32_t Hash(const char *id, uint32_t seed) noexcept
+	{
+		uint32_t h = 2166136261u ^ seed;
+		while (*id != 0 && *id != '.' && *id != '[' && *id != '^')
+		{
+			h = (h ^ (uint8_t)*id++) * 16777619u;
+		}
+		return h ^ (h >> 15);
+	}
+
+	// Return true if a seed hashes the names in a section of the OMT into the specified number of slots without collisions
+	static inline constexpr bool IsPerfectHash(const ObjectModelTableEntry *omt, size_t len, uint32_t seed, unsigned int slotBits) noexcept
+	{
+		bool used[1u << MaxHashSlotBits] = { };
+		for (size_t i = 0; i < len; ++i)
+		{
+			const uint32_t slot = Hash(omt[i].name, seed) & ((1u << slotBits) - 1);
+			if (used[slot])
+			{
+				return false;
+			}
+			used[slot] = true;
+		}
+		return true;
+	}
+
+	// Find the smallest number of slots and a seed that give a perfect hash of a section of the OMT, returning the number of slot bits in the top byte and the seed in the bottom byte.
+	// We start with at least twice as many slots as entries, which makes it likely that we find a seed quickly. Returns zero if we fail.
+	static inline constexpr uint16_t FindPerfectHash(const ObjectModelTableEntry *omt, size_t len) noexcept
+	{
+		unsigned int slotBits = 0;
+		while ((1u << slotBits) < 2 * len)
+		{
+			++slotBits;
+		}
+		for (; slotBits <= MaxHashSlotBits; ++slotBits)
+		{
+			for (unsigned int seed = 0; seed < 256; ++seed)
+			{
+				if (IsPerfectHash(omt, len, seed, slotBits))
+				{
+					return (slotBits << 8) | seed | 0x8000;
+				}
+			}
+		}
+		return 0;
+	}
+
+	static constexpr unsigned int MaxHashSlotBits = 7;
+};
+
+// Per-section data for looking up entries in the OMT using the perfect hash
+struct ObjectModelTableHashInfo
+{
+	uint16_t firstEntry;			// index in the OMT of the first entry in this section
+	uint16_t firstSlot;				// index of the first hash slot for this section
+	uint8_t slotMask;				// number of slots for this section minus one
+	uint8_t seed;					// the seed that makes the hash perfect
+};
+
+// Return the total number of hash slots needed for an OMT, or zero if we failed to find a perfect hash for any section
+static inline constexpr size_t ObjectModelHashSlots(const ObjectModelTableEntry *omt, const uint8_t *descriptor) noexcept
+{
+	size_t numSlots = 0;
+	for (size_t i = 0; i < descriptor[0]; ++i)
+	{
+		const uint16_t hash = ObjectModelTableEntry::FindPerfectHash(omt, descriptor[i + 1]);
+		if (hash == 0)
+		{
+			return 0;
+		}
+		numSlots += 1u << ((hash >> 8) & 0x7F);
+		omt += descriptor[i + 1];
+	}
+	return numSlots;
+}
+
+// Perfect hash lookup tables for an OMT, computed at compile time. Each slot holds the index of the entry within its section plus one, or zero if it is empty.
+template<size_t NumSections, size_t NumSlots> struct ObjectModelTableHash
+{
+	constexpr ObjectModelTableHash(const ObjectModelTableEntry *omt, const uint8_t *descriptor) noexcept : info{ }, slots{ }
+	{
+		size_t firstEntry = 0, firstSlot = 0;
+		for (size_t i = 0; i < NumSections; ++i)
+		{
+			const size_t len = descriptor[i + 1];
+			const uint16_t hash = ObjectModelTableEntry::FindPerfectHash(omt + firstEntry, len);
+			const size_t numSlots = 1u << ((hash >> 8) & 0x7F);
+			info[i].firstEntry = firstEntry;
+			info[i].firstSlot = firstSlot;
+			info[i].slotMask = numSlots - 1;
+			info[i].seed = hash & 0xFF;
+			for (size_t j = 0; j < len; ++j)
+			{
+				slots[firstSlot + (ObjectModelTableEntry::Hash(omt[firstEntry + j].name, info[i].seed) & (numSlots - 1))] = j + 1;
+			}
+			firstEntry += len;
+			firstSlot += numSlots;
+		}
+	}
+
+	ObjectModelTableHashInfo info[NumSections];
+	uint8_t slots[NumSlots];
 };
 
 struct ObjectModelClassDescriptor
@@ -333,6 +508,66 @@ struct ObjectModelClassDescriptor
 	const ObjectModelTableEntry *omt;
 	const uint8_t *omd;
 	const ObjectModelClassDescriptor *parent;
+	const ObjectModelTableHashInfo *hashInfo;
+	const uint8_t *hashSlots;
+};
+
+// Class to generate a JSON object model report a piece at a time, so that a large report can be sent without holding all of it in output buffers.
+// It is used when the key is empty or is the name of a top-level object, which are the reports that get large. Other keys are reported in one piece.
+// A piece is one element of an array or one member of an object. Arrays and objects nested up to MaxLevels deep within a top-level entry are opened
+// and reported a piece at a time too, so that a large array element or sub-object doesn't have to fit in the buffers in one go.
+// The cursor holds only indices and it finds its place again from the root each time it generates a piece, so objects may be created or deleted
+// between pieces. Each piece is consistent in itself, but different pieces may reflect the state of the machine at slightly different times.
+class ObjectModelReportCursor
+{
+public:
+	void* operator new(size_t sz) noexcept { return FreelistManager::Allocate<ObjectModelReportCursor>(); }
+	void operator delete(void* p) noexcept { FreelistManager::Release<ObjectModelReportCursor>(p); }
+
+	// Create a cursor, returning null if the report can't be generated incrementally
+	static ObjectModelReportCursor *Create(const ObjectModel *root, const char *key, const char *flags, uint32_t seq) noexcept;
+
+	bool IsFinished() const noexcept { return stage == Stage::finished; }
+
+	// Append the next pieces of the report to the buffer until it holds at least the target length or the report is complete
+	void GetNextPieces(OutputBuffer *buf, size_t targetLength) THROWS(GCodeException);
+
+private:
+	static constexpr size_t MaxLevels = 4;				// how deeply nested the arrays and objects that we report a piece at a time can be
+
+	enum class Stage : uint8_t { header, sections, trailer, finished };
+	enum class LevelKind : uint8_t { array, object };
+
+	// An array or object that we have started to report but not finished
+	struct Level
+	{
+		size_t index;									// index of the next array element or object entry, or of the one we are inside
+		LevelKind kind;
+		bool added;										// true if we have reported any elements or members
+	};
+
+	ObjectModelReportCursor(const ObjectModel *p_root, const char *p_key, const char *p_flags, uint32_t p_seq) noexcept;
+
+	void StartSection(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *classDescriptor, const ObjectModelTableEntry *entry) THROWS(GCodeException);
+	void ContinueLevel(OutputBuffer *buf, ObjectExplorationContext& context, size_t level, const ObjectModel *owner, const ObjectModelClassDescriptor *ownerDescriptor,
+						const ExpressionValue& val) THROWS(GCodeException);
+	void StartItem(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModel *owner, const ObjectModelClassDescriptor *ownerDescriptor,
+						const ExpressionValue& val) THROWS(GCodeException);
+	void CloseLevels(OutputBuffer *buf, const ObjectExplorationContext& context, size_t level) noexcept;
+	void ItemDone() noexcept;
+	void NextSection() noexcept;
+
+	const ObjectModel *root;
+	const ObjectModelClassDescriptor *rootDescriptor;
+	String<StringLength50> key;
+	String<StringLength20> flags;
+	uint32_t seq;
+	size_t sectionIndex;								// index of the current top-level entry
+	size_t numLevels;									// the number of arrays and objects within the current top-level entry that we are part way through
+	Level levels[MaxLevels];							// the arrays and objects we are part way through, outermost first
+	Stage stage;
+	bool wholeModel;									// true if the key is empty
+	bool sectionAdded;									// true if we have reported any top-level entries
 };
 
 // Use this macro to inherit form ObjectModel
@@ -352,8 +587,17 @@ struct ObjectModelClassDescriptor
 #define OMT_SIZE_OK(_class)		(ARRAY_SIZE(_class::objectModelTable) == ArraySum(_class::objectModelTableDescriptor + 1, ARRAY_SIZE(_class::objectModelTableDescriptor) - 1))
 #define OMT_ORDERING_OK(_class)	(ObjectModelTableEntry::IsOrdered(_class::objectModelTableDescriptor, _class::objectModelTable))
 
+#define OMT_HASH_SLOTS(_class)	(ObjectModelHashSlots(_class::objectModelTable, _class::objectModelTableDescriptor))
+
+#define DEFINE_OBJECT_MODEL_TABLE_HASH(_class) \
+	static_assert(OMT_HASH_SLOTS(_class) != 0, "Failed to find a perfect hash for the object model table"); \
+	static constexpr ObjectModelTableHash<ARRAY_SIZE(_class::objectModelTableDescriptor) - 1, OMT_HASH_SLOTS(_class)> \
+		_class ## ObjectModelTableHash(_class::objectModelTable, _class::objectModelTableDescriptor);
+
 #define DEFINE_GET_OBJECT_MODEL_TABLE(_class) \
-	const ObjectModelClassDescriptor _class::objectModelClassDescriptor = { _class::objectModelTable, _class::objectModelTableDescriptor, nullptr }; \
+	DEFINE_OBJECT_MODEL_TABLE_HASH(_class) \
+	const ObjectModelClassDescriptor _class::objectModelClassDescriptor = \
+		{ _class::objectModelTable, _class::objectModelTableDescriptor, nullptr, _class ## ObjectModelTableHash.info, _class ## ObjectModelTableHash.slots }; \
 	const ObjectModelClassDescriptor *_class::GetObjectModelClassDescriptor() const noexcept \
 	{ \
 		static_assert(DESCRIPTOR_OK(_class), "Bad descriptor length"); \
@@ -363,7 +607,9 @@ struct ObjectModelClassDescriptor
 	}
 
 #define DEFINE_GET_OBJECT_MODEL_TABLE_WITH_PARENT(_class, _parent) \
-	const ObjectModelClassDescriptor _class::objectModelClassDescriptor = { _class::objectModelTable, _class::objectModelTableDescriptor, &_parent::objectModelClassDescriptor }; \
+	DEFINE_OBJECT_MODEL_TABLE_HASH(_class) \
+	const ObjectModelClassDescriptor _class::objectModelClassDescriptor = \
+		{ _class::objectModelTable, _class::objectModelTableDescriptor, &_parent::objectModelClassDescriptor, _class ## ObjectModelTableHash.info, _class ## ObjectModelTableHash.slots }; \
 	const ObjectModelClassDescriptor *_class::GetObjectModelClassDescriptor() const noexcept \
 	{ \
 		static_assert(DESCRIPTOR_OK(_class), "Bad descriptor length"); \
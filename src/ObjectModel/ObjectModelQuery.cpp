@@ -0,0 +1,216 @@
+/*
+ * ObjectModelQuery.cpp
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#include "ObjectModelQuery.h"
+
+#if SUPPORT_OBJECT_MODEL
+
+#include <General/SafeStrtod.h>
+
+// Return true if the node matches the name of a table entry
+bool ObjectModelQuery::Node::Matches(const char *entryName) const noexcept
+{
+	return (nameLength == 1 && name[0] == '*')
+		|| (strncmp(name, entryName, nameLength) == 0 && entryName[nameLength] == 0);
+}
+
+/*static*/ bool ObjectModelQuery::IsQuery(const char *filter) noexcept
+{
+	for (const char *p = filter; *p != 0; ++p)
+	{
+		if (*p == ',' || *p == '{' || *p == ':' || (*p == '[' && p[1] == '*'))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void ObjectModelQuery::Parse(const char *s) THROWS(GCodeException)
+{
+	queryString = pos = s;
+	numNodes = 1;
+	nodes[0].name = s;
+	nodes[0].nameLength = 0;
+	nodes[0].firstChild = nodes[0].nextSibling = NoNode;
+	nodes[0].subscript = SubscriptType::none;
+	nodes[0].whole = false;
+
+	ParseList(0);
+	if (*pos != 0)
+	{
+		throw ConstructParseException("unexpected character in query");
+	}
+}
+
+// Return the sibling node starting at firstNode that matches the name of a table entry, or NoNode. Parse ensures that there is at most one.
+uint8_t ObjectModelQuery::FindNode(uint8_t firstNode, const char *entryName) const noexcept
+{
+	for (uint8_t n = firstNode; n != NoNode; n = nodes[n].nextSibling)
+	{
+		if (nodes[n].Matches(entryName))
+		{
+			return n;
+		}
+	}
+	return NoNode;
+}
+
+// Parse a comma-separated list of paths, adding them to the children of the parent node
+void ObjectModelQuery::ParseList(uint8_t parent) THROWS(GCodeException)
+{
+	for (;;)
+	{
+		ParsePath(parent);
+		if (*pos != ',')
+		{
+			return;
+		}
+		++pos;
+	}
+}
+
+void ObjectModelQuery::ParsePath(uint8_t parent) THROWS(GCodeException)
+{
+	for (;;)
+	{
+		if (*pos == '{')
+		{
+			++pos;
+			ParseList(parent);
+			if (*pos != '}')
+			{
+				throw ConstructParseException("expected '}'");
+			}
+			++pos;
+			return;
+		}
+
+		const uint8_t node = ParseStep(parent);
+		if (*pos != '.')
+		{
+			nodes[node].whole = true;
+			return;
+		}
+		++pos;
+		parent = node;
+	}
+}
+
+// Parse a path element and its optional subscript. Return the existing child node of the parent that matches it, or a new one.
+uint8_t ObjectModelQuery::ParseStep(uint8_t parent) THROWS(GCodeException)
+{
+	const char * const name = pos;
+	while (*pos != 0 && strchr(".[]{},:", *pos) == nullptr)
+	{
+		++pos;
+	}
+	const size_t nameLength = pos - name;
+	if (nameLength == 0 || nameLength > UINT8_MAX)
+	{
+		throw ConstructParseException("expected object model key");
+	}
+
+	SubscriptType subscript = SubscriptType::none;
+	int16_t first = 0, last = NoBound;
+	if (*pos == '[')
+	{
+		++pos;
+		if (*pos == '*')
+		{
+			++pos;
+			subscript = SubscriptType::slice;
+		}
+		else if (*pos != ']')
+		{
+			if (*pos != ':')
+			{
+				first = ParseBound();
+			}
+			if (*pos == ':')
+			{
+				++pos;
+				subscript = SubscriptType::slice;
+				if (*pos != ']')
+				{
+					last = ParseBound();
+				}
+			}
+			else
+			{
+				subscript = SubscriptType::index;
+			}
+		}
+		else
+		{
+			subscript = SubscriptType::slice;
+		}
+		if (*pos != ']')
+		{
+			throw ConstructParseException("expected ']'");
+		}
+		++pos;
+	}
+
+	// Look for an existing node for this element so that common prefixes are merged. When reporting, each member of an object is matched against the
+	// first sibling node with that name only, so reject a member that is already selected with a different subscript, or a wildcard alongside other members.
+	const bool isWildcard = (nameLength == 1 && name[0] == '*');
+	uint8_t *link = &nodes[parent].firstChild;
+	while (*link != NoNode)
+	{
+		const Node& n = nodes[*link];
+		if (n.nameLength == nameLength && strncmp(n.name, name, nameLength) == 0)
+		{
+			if (n.subscript != subscript || n.first != first || n.last != last)
+			{
+				throw ConstructParseException("object model key selected with different subscripts");
+			}
+			return *link;
+		}
+		if (isWildcard || (n.nameLength == 1 && n.name[0] == '*'))
+		{
+			throw ConstructParseException("'*' cannot be combined with other keys in the same object");
+		}
+		link = &nodes[*link].nextSibling;
+	}
+
+	if (numNodes == MaxNodes)
+	{
+		throw ConstructParseException("query too complex");
+	}
+
+	Node& n = nodes[numNodes];
+	n.name = name;
+	n.nameLength = nameLength;
+	n.first = first;
+	n.last = last;
+	n.subscript = subscript;
+	n.firstChild = n.nextSibling = NoNode;
+	n.whole = false;
+	*link = numNodes;
+	return numNodes++;
+}
+
+int16_t ObjectModelQuery::ParseBound() THROWS(GCodeException)
+{
+	const char *endptr;
+	const int32_t val = StrToI32(pos, &endptr);
+	if (endptr == pos || val <= -NoBound || val >= NoBound)
+	{
+		throw ConstructParseException("bad subscript");
+	}
+	pos = endptr;
+	return (int16_t)val;
+}
+
+GCodeException ObjectModelQuery::ConstructParseException(const char *msg) const noexcept
+{
+	return GCodeException(-1, pos - queryString, msg);
+}
+
+#endif
+
+// End
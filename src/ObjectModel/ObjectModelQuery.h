@@ -0,0 +1,76 @@
+/*
+ * ObjectModelQuery.h
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#ifndef SRC_OBJECTMODEL_OBJECTMODELQUERY_H_
+#define SRC_OBJECTMODEL_OBJECTMODELQUERY_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_OBJECT_MODEL
+
+#include <GCodes/GCodeException.h>
+#include <General/FreelistManager.h>
+
+// A query that selects several parts of the object model, so that they can be reported in one walk of the model. For example:
+//  heat.heaters[*].{current,state},tools[0:3],move.axes[].userPosition
+// A query is a comma-separated list of paths. Each element of a path may be followed by a subscript, which is [] or [*] for all elements,
+// [n] for one element, or [m:n] for elements m to n-1 where either bound may be omitted and negative bounds count from the end.
+// The last element of a path may be a list of paths in braces. An element name of * matches every member of an object.
+// The report is an object with the same structure as the model, containing only the selected members. An element with a single
+// subscript is reported as that element, other subscripts give arrays. Paths are merged into a tree as we parse them, so common
+// prefixes are only visited once. Selecting the same member with different subscripts, or using * alongside other members of the same
+// object, is an error.
+class ObjectModelQuery
+{
+public:
+	void* operator new(size_t sz) noexcept { return FreelistManager::Allocate<ObjectModelQuery>(); }
+	void operator delete(void* p) noexcept { FreelistManager::Release<ObjectModelQuery>(p); }
+
+	enum class SubscriptType : uint8_t { none, index, slice };
+
+	struct Node
+	{
+		const char *name;							// points into the query string, not null-terminated
+		int16_t first, last;						// subscript bounds, last is exclusive
+		uint8_t nameLength;
+		uint8_t firstChild;							// index of the first child node, or NoNode
+		uint8_t nextSibling;						// index of the next sibling node, or NoNode
+		SubscriptType subscript;
+		bool whole;									// the whole value was requested, not just parts of it
+
+		bool Matches(const char *entryName) const noexcept;
+	};
+
+	static constexpr uint8_t NoNode = 0xFF;
+	static constexpr int16_t NoBound = INT16_MAX;	// an omitted upper bound in a slice
+
+	// Return true if a filter string uses the query syntax rather than being a single path
+	static bool IsQuery(const char *filter) noexcept;
+
+	void Parse(const char *s) THROWS(GCodeException);
+
+	uint8_t GetFirstNode() const noexcept { return nodes[0].firstChild; }
+	const Node& GetNode(uint8_t n) const noexcept { return nodes[n]; }
+	uint8_t FindNode(uint8_t firstNode, const char *entryName) const noexcept;
+
+private:
+	static constexpr size_t MaxNodes = 32;
+
+	void ParseList(uint8_t parent) THROWS(GCodeException);
+	void ParsePath(uint8_t parent) THROWS(GCodeException);
+	uint8_t ParseStep(uint8_t parent) THROWS(GCodeException);
+	int16_t ParseBound() THROWS(GCodeException);
+	GCodeException ConstructParseException(const char *msg) const noexcept;
+
+	const char *queryString;
+	const char *pos;								// the next character to parse
+	size_t numNodes;
+	Node nodes[MaxNodes];							// node 0 is the root of the tree
+};
+
+#endif
+
+#endif /* SRC_OBJECTMODEL_OBJECTMODELQUERY_H_ */
@@ -0,0 +1,189 @@
+/*
+ * Variable.cpp
+ *
+ *  Created on: 6 Oct 2020
+ *      Author: David
+ */
+
+#include "Variable.h"
+
+#if SUPPORT_OBJECT_MODEL
+
+Variable::Variable(const char *str, size_t len, uint16_t hash, const ExpressionValue& pVal, uint8_t pScope) noexcept
+	: next(nullptr), nameHash(hash), scope(pScope)
+{
+	name = new char[len + 1];
+	memcpy(name, str, len);
+	name[len] = 0;
+	Assign(pVal);
+}
+
+Variable::~Variable() noexcept
+{
+	ReleaseStorage();
+	delete[] name;
+}
+
+// Release any string storage that we own
+void Variable::ReleaseStorage() noexcept
+{
+	if (val.GetType() == TypeCode::CString)
+	{
+		delete[] const_cast<char*>(val.sVal);
+		val.Set(nullptr);
+	}
+}
+
+// Assign a new value. The new value may be a string held in the old value, so copy it before releasing the old storage.
+void Variable::Assign(const ExpressionValue& ev) noexcept
+{
+	if (ev.GetType() == TypeCode::CString)
+	{
+		const size_t len = strlen(ev.sVal);
+		char * const s = new char[len + 1];
+		memcpy(s, ev.sVal, len + 1);
+		ReleaseStorage();
+		val = ev;
+		val.sVal = s;
+	}
+	else
+	{
+		ReleaseStorage();
+		val = ev;
+	}
+}
+
+// Return true if we can store a value of the specified type.
+// Object references and arrays are excluded because the objects they refer to may be deleted while the variable still exists.
+/*static*/ bool Variable::CanStore(TypeCode t) noexcept
+{
+	switch (t)
+	{
+	case TypeCode::ObjectModel:
+	case TypeCode::Array:
+	case TypeCode::Special:
+#if SUPPORT_CAN_EXPANSION
+	case TypeCode::CanExpansionBoardDetails:
+#endif
+		return false;
+
+	default:
+		return true;
+	}
+}
+
+VariableSet::VariableSet() noexcept : numVariables(0)
+{
+	for (Variable*& b : buckets)
+	{
+		b = nullptr;
+	}
+}
+
+// Compute the hash of a variable name
+/*static*/ uint16_t VariableSet::Hash(const char *str, size_t length) noexcept
+{
+	uint32_t h = 2166136261u;							// FNV-1a
+	while (length != 0)
+	{
+		h = (h ^ (uint8_t)*str++) * 16777619u;
+		--length;
+	}
+	return (uint16_t)(h ^ (h >> 16));
+}
+
+const Variable *VariableSet::Lookup(const char *str, size_t length) const noexcept
+{
+	const uint16_t hash = Hash(str, length);
+	for (const Variable *v = buckets[hash & (NumBuckets - 1)]; v != nullptr; v = v->next)
+	{
+		if (v->nameHash == hash && strncmp(v->name, str, length) == 0 && v->name[length] == 0)
+		{
+			return v;
+		}
+	}
+	return nullptr;
+}
+
+Variable *VariableSet::Lookup(const char *str, size_t length) noexcept
+{
+	return const_cast<Variable*>(const_cast<const VariableSet*>(this)->Lookup(str, length));
+}
+
+// Create a new variable. The caller must already have checked that it doesn't exist.
+// New variables are added at the start of the bucket chain, so that variables in the innermost scope are found first.
+void VariableSet::Insert(const char *str, const ExpressionValue& val, uint8_t scope) noexcept
+{
+	const size_t length = strlen(str);
+	const uint16_t hash = Hash(str, length);
+	Variable * const v = new Variable(str, length, hash, val, scope);
+	Variable*& head = buckets[hash & (NumBuckets - 1)];
+	v->next = head;
+	head = v;
+	++numVariables;
+}
+
+// Delete all variables created at the specified block nesting level or deeper. Called when a block ends.
+void VariableSet::EndScope(uint8_t blockNesting) noexcept
+{
+	if (numVariables != 0)
+	{
+		for (Variable*& b : buckets)
+		{
+			Variable **pp = &b;
+			while (*pp != nullptr)
+			{
+				Variable * const v = *pp;
+				if (v->scope >= blockNesting)
+				{
+					*pp = v->next;
+					delete v;
+					--numVariables;
+				}
+				else
+				{
+					pp = &v->next;
+				}
+			}
+		}
+	}
+}
+
+// Take over the variables of another set, leaving it empty. Used when pushing and popping machine state within the same file.
+void VariableSet::TransferFrom(VariableSet& other) noexcept
+{
+	Clear();
+	for (size_t i = 0; i < NumBuckets; ++i)
+	{
+		buckets[i] = other.buckets[i];
+		other.buckets[i] = nullptr;
+	}
+	numVariables = other.numVariables;
+	other.numVariables = 0;
+}
+
+void VariableSet::Clear() noexcept
+{
+	EndScope(0);
+}
+
+// Check that a string is a legal variable name. It must start with a letter and contain only letters, digits and underscore.
+/*static*/ bool VariableSet::IsValidName(const char *str) noexcept
+{
+	if (!isalpha(*str))
+	{
+		return false;
+	}
+	while (*++str != 0)
+	{
+		if (!isalpha(*str) && !isdigit(*str) && *str != '_')
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+#endif
+
+// End
@@ -0,0 +1,86 @@
+/*
+ * Variable.h
+ *
+ *  Created on: 6 Oct 2020
+ *      Author: David
+ */
+
+#ifndef SRC_OBJECTMODEL_VARIABLE_H_
+#define SRC_OBJECTMODEL_VARIABLE_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_OBJECT_MODEL
+
+#include "ObjectModel.h"
+#include <General/FreelistManager.h>
+
+class VariableSet;
+
+// Class to represent a named variable created by the 'var' or 'global' meta command
+// Variable records are recycled through the freelist manager, so creating and destroying them in macros doesn't fragment the heap
+class Variable
+{
+public:
+	friend class VariableSet;
+
+	void* operator new(size_t sz) noexcept { return FreelistManager::Allocate<Variable>(); }
+	void operator delete(void* p) noexcept { FreelistManager::Release<Variable>(p); }
+
+	Variable(const char *str, size_t len, uint16_t hash, const ExpressionValue& pVal, uint8_t pScope) noexcept;
+	~Variable() noexcept;
+
+	const char *GetName() const noexcept { return name; }
+	ExpressionValue GetValue() const noexcept { return val; }
+	uint8_t GetScope() const noexcept { return scope; }
+
+	void Assign(const ExpressionValue& ev) noexcept;						// assign a new value, taking a copy of any string
+
+	static bool CanStore(TypeCode t) noexcept;								// return true if a variable can hold a value of this type
+
+private:
+	Variable(const Variable&) = delete;
+
+	void ReleaseStorage() noexcept;
+
+	Variable *next;
+	char *name;																// the name, allocated on the heap
+	ExpressionValue val;
+	uint16_t nameHash;
+	uint8_t scope;															// the block nesting level at which the variable was created
+};
+
+// Symbol table holding a set of variables. Lookup is by hashed name so that it stays fast in macros that declare many variables.
+class VariableSet
+{
+public:
+	VariableSet() noexcept;
+	~VariableSet() noexcept { Clear(); }
+
+	const Variable *Lookup(const char *str) const noexcept { return Lookup(str, strlen(str)); }
+	const Variable *Lookup(const char *str, size_t length) const noexcept;
+	Variable *Lookup(const char *str) noexcept { return Lookup(str, strlen(str)); }
+	Variable *Lookup(const char *str, size_t length) noexcept;
+
+	void Insert(const char *str, const ExpressionValue& val, uint8_t scope) noexcept;	// create a new variable, which must not already exist
+	void EndScope(uint8_t blockNesting) noexcept;							// delete variables created at this block nesting level or deeper
+	void TransferFrom(VariableSet& other) noexcept;							// take over the variables of another set, leaving it empty
+	void Clear() noexcept;
+
+	size_t GetNumVariables() const noexcept { return numVariables; }
+
+	static bool IsValidName(const char *str) noexcept;
+
+private:
+	VariableSet(const VariableSet&) = delete;
+
+	static constexpr size_t NumBuckets = 8;									// must be a power of 2
+	static uint16_t Hash(const char *str, size_t length) noexcept;
+
+	Variable *buckets[NumBuckets];
+	size_t numVariables;
+};
+
+#endif
+
+#endif /* SRC_OBJECTMODEL_VARIABLE_H_ */
@@ -10,9 +10,14 @@
 #include "RepRap.h"
 #include <cstdarg>
 
-/*static*/ OutputBuffer * volatile OutputBuffer::freeOutputBuffers = nullptr;		// Messages may also be sent by ISRs,
-/*static*/ volatile size_t OutputBuffer::usedOutputBuffers = 0;						// so make these volatile.
-/*static*/ volatile size_t OutputBuffer::maxUsedOutputBuffers = 0;
+/*static*/ OutputBuffer * volatile OutputBuffer::freeOutputBuffers[NumOutputBufferClasses] = { nullptr };	// Messages may also be sent by ISRs,
+/*static*/ volatile size_t OutputBuffer::usedOutputBuffers[NumOutputBufferClasses] = { 0 };				// so make these volatile.
+/*static*/ volatile size_t OutputBuffer::maxUsedOutputBuffers[NumOutputBufferClasses] = { 0 };
+
+// Buffer sizes and numbers of buffers for each size class, smallest first
+static constexpr size_t OutputBufferSizes[NumOutputBufferClasses] = { SMALL_OUTPUT_BUFFER_SIZE, OUTPUT_BUFFER_SIZE, LARGE_OUTPUT_BUFFER_SIZE };
+static constexpr size_t OutputBufferCounts[NumOutputBufferClasses] = { SMALL_OUTPUT_BUFFER_COUNT, OUTPUT_BUFFER_COUNT, LARGE_OUTPUT_BUFFER_COUNT };
+static_assert(LARGE_OUTPUT_BUFFER_SIZE <= UINT16_MAX);
 
 //*************************************************************************************************
 // OutputBuffer class implementation
@@ -172,34 +177,35 @@ size_t OutputBuffer::copy(const char *src, size_t len) noexcept
 	return cat(src, len);
 }
 
-size_t OutputBuffer::cat(const char c) noexcept
+// Add another buffer to the end of the chain, using the largest size available. Return false if we can't.
+bool OutputBuffer::Extend() noexcept
 {
-	// See if we can append a char
-	if (last->dataLength == OUTPUT_BUFFER_SIZE)
+	OutputBuffer *nextBuffer;
+	if (!Allocate(nextBuffer, true))
 	{
-		// No - allocate a new item and copy the data
-		OutputBuffer *nextBuffer;
-		if (!Allocate(nextBuffer))
-		{
-			// We cannot store any more data
-			hadOverflow = true;
-			return 0;
-		}
-		nextBuffer->references = references;
-		nextBuffer->copy(c);
+		// We cannot store any more data
+		hadOverflow = true;
+		return false;
+	}
+	nextBuffer->references = references;
 
-		// Link the new item to this list
-		last->next = nextBuffer;
-		for (OutputBuffer *item = this; item != nextBuffer; item = item->Next())
-		{
-			item->last = nextBuffer;
-		}
+	// Link the new item to this list
+	last->next = nextBuffer;
+	for (OutputBuffer *item = this; item != nextBuffer; item = item->Next())
+	{
+		item->last = nextBuffer;
 	}
-	else
+	return true;
+}
+
+size_t OutputBuffer::cat(const char c) noexcept
+{
+	// See if we can append a char, allocating a new item if necessary
+	if (last->dataLength == last->capacity && !Extend())
 	{
-		// Yes - we have enough space left
-		last->data[last->dataLength++] = c;
+		return 0;
 	}
+	last->data[last->dataLength++] = c;
 	return 1;
 }
 
@@ -218,25 +224,12 @@ size_t OutputBuffer::cat(const char *src, size_t len) noexcept
 	size_t copied = 0;
 	while (copied < len)
 	{
-		if (last->dataLength == OUTPUT_BUFFER_SIZE)
+		if (last->dataLength == last->capacity && !Extend())
 		{
-			// The last buffer is full
-			OutputBuffer *nextBuffer;
-			if (!Allocate(nextBuffer))
-			{
-				// We cannot store any more data, stop here
-				hadOverflow = true;
-				break;
-			}
-			nextBuffer->references = references;
-			last->next = nextBuffer;
-			last = nextBuffer->last;
-			for (OutputBuffer *item = Next(); item != nextBuffer; item = item->Next())
-			{
-				item->last = last;
-			}
+			// The last buffer is full and we cannot store any more data, stop here
+			break;
 		}
-		const size_t copyLength = min<size_t>(len - copied, OUTPUT_BUFFER_SIZE - last->dataLength);
+		const size_t copyLength = min<size_t>(len - copied, last->capacity - last->dataLength);
 		memcpy(last->data + last->dataLength, src + copied, copyLength);
 		last->dataLength += copyLength;
 		copied += copyLength;
@@ -258,6 +251,106 @@ size_t OutputBuffer::cat(StringRef &str) noexcept
 	return cat(str.c_str(), str.strlen());
 }
 
+// Append an unsigned integer in decimal without going through the printf engine
+size_t OutputBuffer::AppendUnsigned(uint32_t val) noexcept
+{
+	char digits[10];
+	char *p = digits + sizeof(digits);
+	do
+	{
+		*--p = '0' + (char)(val % 10);
+		val /= 10;
+	} while (val != 0);
+	return cat(p, digits + sizeof(digits) - p);
+}
+
+size_t OutputBuffer::AppendInt(int32_t val) noexcept
+{
+	if (val < 0)
+	{
+		return cat('-') + AppendUnsigned(0u - (uint32_t)val);
+	}
+	return AppendUnsigned((uint32_t)val);
+}
+
+// Append a float to a fixed number of decimal places. Zero means the maximum, as in GetFloatFormatString.
+// This is much faster than catf because it doesn't parse a format string or convert to double. It works on the mantissa and exponent directly
+// so the result is exact and rounding matches printf, i.e. to nearest with ties to even. NaNs, infinities and very large values go through catf.
+size_t OutputBuffer::AppendFloat(float val, unsigned int numDigitsAfterPoint) noexcept
+{
+	static constexpr uint32_t PowersOfTen[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+	static_assert(ARRAY_SIZE(PowersOfTen) == MaxFloatDigitsDisplayedAfterPoint + 1);
+
+	if (numDigitsAfterPoint == 0 || numDigitsAfterPoint > MaxFloatDigitsDisplayedAfterPoint)
+	{
+		numDigitsAfterPoint = MaxFloatDigitsDisplayedAfterPoint;
+	}
+
+	uint32_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	const uint32_t biasedExponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x007FFFFF;
+	int exponent;
+	if (biasedExponent == 0)
+	{
+		exponent = -149;										// zero or denormalised
+	}
+	else
+	{
+		mantissa |= 0x00800000;
+		exponent = (int)biasedExponent - 150;
+	}
+
+	if (biasedExponent == 0xFF || exponent > 15)
+	{
+		return catf(GetFloatFormatString(numDigitsAfterPoint), (double)val);
+	}
+
+	// The value multiplied by 10^digits is mantissa * 10^digits * 2^exponent, and mantissa * 10^digits needs at most 48 bits
+	const uint64_t scaled = (uint64_t)mantissa * PowersOfTen[numDigitsAfterPoint];
+	uint64_t rounded;
+	if (exponent >= 0)
+	{
+		rounded = scaled << exponent;
+	}
+	else if (exponent < -50)
+	{
+		rounded = 0;											// the value is less than a quarter of the last digit
+	}
+	else
+	{
+		const unsigned int shift = (unsigned int)-exponent;
+		rounded = scaled >> shift;
+		const uint64_t remainder = scaled & (((uint64_t)1 << shift) - 1);
+		const uint64_t half = (uint64_t)1 << (shift - 1);
+		if (remainder > half || (remainder == half && (rounded & 1u) != 0))
+		{
+			++rounded;
+		}
+	}
+
+	char chars[30];												// sign, up to 20 integer digits, point and up to 7 fraction digits
+	char *p = chars + sizeof(chars);
+	uint64_t intPart = rounded / PowersOfTen[numDigitsAfterPoint];
+	uint32_t fracPart = (uint32_t)(rounded % PowersOfTen[numDigitsAfterPoint]);
+	for (unsigned int i = 0; i < numDigitsAfterPoint; ++i)
+	{
+		*--p = '0' + (char)(fracPart % 10);
+		fracPart /= 10;
+	}
+	*--p = '.';
+	do
+	{
+		*--p = '0' + (char)(intPart % 10);
+		intPart /= 10;
+	} while (intPart != 0);
+	if ((bits & 0x80000000) != 0)
+	{
+		*--p = '-';												// printf prints negative zero as -0.0
+	}
+	return cat(p, chars + sizeof(chars) - p);
+}
+
 // Encode a character in JSON format, and append it to the buffer and return the number of bytes written
 size_t OutputBuffer::EncodeChar(char c) noexcept
 {
@@ -348,29 +441,48 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 // Initialise the output buffers manager
 /*static*/ void OutputBuffer::Init() noexcept
 {
-	freeOutputBuffers = nullptr;
-	for (size_t i = 0; i < OUTPUT_BUFFER_COUNT; i++)
+	for (uint8_t cls = 0; cls < NumOutputBufferClasses; ++cls)
 	{
-		freeOutputBuffers = new OutputBuffer(freeOutputBuffers);
+		char * const storage = new char[OutputBufferSizes[cls] * OutputBufferCounts[cls]];
+		freeOutputBuffers[cls] = nullptr;
+		for (size_t i = 0; i < OutputBufferCounts[cls]; i++)
+		{
+			freeOutputBuffers[cls] = new OutputBuffer(freeOutputBuffers[cls], storage + i * OutputBufferSizes[cls], OutputBufferSizes[cls], cls);
+		}
 	}
 }
 
 // Allocates an output buffer instance which can be used for (large) string outputs. This must be thread safe. Not safe to call from interrupts!
 /*static*/ bool OutputBuffer::Allocate(OutputBuffer *&buf) noexcept
+{
+	return Allocate(buf, false);
+}
+
+// Allocate the smallest or the largest output buffer available
+/*static*/ bool OutputBuffer::Allocate(OutputBuffer *&buf, bool largestFirst) noexcept
 {
 	{
 		TaskCriticalSectionLocker lock;
 
-		buf = freeOutputBuffers;
-		if (buf != nullptr)
+		buf = nullptr;
+		for (size_t i = 0; i < NumOutputBufferClasses; ++i)
 		{
-			freeOutputBuffers = buf->next;
-			usedOutputBuffers++;
-			if (usedOutputBuffers > maxUsedOutputBuffers)
+			const size_t cls = (largestFirst) ? NumOutputBufferClasses - 1 - i : i;
+			buf = freeOutputBuffers[cls];
+			if (buf != nullptr)
 			{
-				maxUsedOutputBuffers = usedOutputBuffers;
+				freeOutputBuffers[cls] = buf->next;
+				usedOutputBuffers[cls]++;
+				if (usedOutputBuffers[cls] > maxUsedOutputBuffers[cls])
+				{
+					maxUsedOutputBuffers[cls] = usedOutputBuffers[cls];
+				}
+				break;
 			}
+		}
 
+		if (buf != nullptr)
+		{
 			// Initialise the buffer before we release the lock in case another task uses it immediately
 			buf->next = nullptr;
 			buf->last = buf;
@@ -391,16 +503,37 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 // Get the number of bytes left for continuous writing
 /*static*/ size_t OutputBuffer::GetBytesLeft(const OutputBuffer *writingBuffer) noexcept
 {
-	const size_t freeBuffers = OUTPUT_BUFFER_COUNT - usedOutputBuffers;
-	const size_t bytesLeft = OUTPUT_BUFFER_SIZE - writingBuffer->last->DataLength();
+	constexpr size_t ReservedBytes = RESERVED_OUTPUT_BUFFERS * OUTPUT_BUFFER_SIZE;
+	const size_t freeBytes = GetFreeBytes();
+	const size_t bytesLeft = writingBuffer->last->capacity - writingBuffer->last->DataLength();
 
-	if (freeBuffers < RESERVED_OUTPUT_BUFFERS)
+	if (freeBytes < ReservedBytes)
 	{
 		// Keep some space left to encapsulate the responses (e.g. via an HTTP header)
 		return bytesLeft;
 	}
 
-	return bytesLeft + (freeBuffers - RESERVED_OUTPUT_BUFFERS) * OUTPUT_BUFFER_SIZE;
+	return bytesLeft + freeBytes - ReservedBytes;
+}
+
+/*static*/ unsigned int OutputBuffer::GetFreeBuffers() noexcept
+{
+	unsigned int freeBuffers = 0;
+	for (size_t cls = 0; cls < NumOutputBufferClasses; ++cls)
+	{
+		freeBuffers += OutputBufferCounts[cls] - usedOutputBuffers[cls];
+	}
+	return freeBuffers;
+}
+
+/*static*/ size_t OutputBuffer::GetFreeBytes() noexcept
+{
+	size_t freeBytes = 0;
+	for (size_t cls = 0; cls < NumOutputBufferClasses; ++cls)
+	{
+		freeBytes += (OutputBufferCounts[cls] - usedOutputBuffers[cls]) * OutputBufferSizes[cls];
+	}
+	return freeBytes;
 }
 
 // Truncate an output buffer to free up more memory. Returns the number of released bytes.
@@ -428,8 +561,8 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 		}
 
 		// Unlink and free the last entry
+		releasedBytes += lastItem->capacity;
 		ReleaseAll(previousItem->next);
-		releasedBytes += OUTPUT_BUFFER_SIZE;
 	} while (previousItem != buffer && releasedBytes < bytesNeeded);
 
 	// Update all the references to the last item
@@ -455,9 +588,9 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 	else
 	{
 		// Otherwise prepend it to the list of free output buffers again
-		buf->next = freeOutputBuffers;
-		freeOutputBuffers = buf;
-		usedOutputBuffers--;
+		buf->next = freeOutputBuffers[buf->sizeClass];
+		freeOutputBuffers[buf->sizeClass] = buf;
+		usedOutputBuffers[buf->sizeClass]--;
 	}
 	return nextBuffer;
 }
@@ -472,8 +605,10 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 
 /*static*/ void OutputBuffer::Diagnostics(MessageType mtype) noexcept
 {
-	reprap.GetPlatform().MessageF(mtype, "Used output buffers: %d of %d (%d max)\n",
-			usedOutputBuffers, OUTPUT_BUFFER_COUNT, maxUsedOutputBuffers);
+	reprap.GetPlatform().MessageF(mtype, "Used output buffers: %u of %u (%u max) small, %u of %u (%u max) standard, %u of %u (%u max) large\n",
+			usedOutputBuffers[0], OutputBufferCounts[0], maxUsedOutputBuffers[0],
+			usedOutputBuffers[1], OutputBufferCounts[1], maxUsedOutputBuffers[1],
+			usedOutputBuffers[2], OutputBufferCounts[2], maxUsedOutputBuffers[2]);
 }
 
 //*************************************************************************************************
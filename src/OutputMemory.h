@@ -24,13 +24,15 @@ const size_t OUTPUT_STACK_DEPTH = 4;	// Number of OutputBuffer chains that can b
 
 class OutputStack;
 
+constexpr size_t NumOutputBufferClasses = 3;				// small, standard and large output buffers
+
 // This class is used to hold data for sending (either for Serial or Network destinations)
 class OutputBuffer
 {
 public:
 	friend class OutputStack;
 
-	OutputBuffer(OutputBuffer *n) noexcept : next(n) { }
+	OutputBuffer(OutputBuffer *n, char *storage, size_t cap, uint8_t cls) noexcept : next(n), data(storage), capacity(cap), sizeClass(cls) { }
 	OutputBuffer(const OutputBuffer&) = delete;
 
 	void Append(OutputBuffer *other) noexcept;
@@ -42,6 +44,7 @@ public:
 	const char *Data() const noexcept { return data; }
 	const char *UnreadData() const noexcept { return data + bytesRead; }
 	size_t DataLength() const noexcept { return dataLength; }	// How many bytes have been written to this instance?
+	size_t Capacity() const noexcept { return capacity; }		// How many bytes can this instance hold?
 	size_t Length() const noexcept;								// How many bytes have been written to the whole chain?
 
 	char& operator[](size_t index) noexcept;
@@ -67,6 +70,11 @@ public:
 	size_t lcat(const char *src, size_t len) noexcept;
 	size_t cat(StringRef &str) noexcept;
 
+	// Fast number formatting for JSON responses. AppendFloat gives the same result as printf("%.<n>f") where n is chosen as for GetFloatFormatString.
+	size_t AppendUnsigned(uint32_t val) noexcept;
+	size_t AppendInt(int32_t val) noexcept;
+	size_t AppendFloat(float val, unsigned int numDigitsAfterPoint) noexcept;
+
 	size_t EncodeChar(char c) noexcept;
 	size_t EncodeReply(OutputBuffer *src) noexcept;
 
@@ -80,6 +88,7 @@ public:
 	static void Init() noexcept;
 
 	// Allocate an unused OutputBuffer instance. Returns true on success or false if no instance could be allocated.
+	// This returns the smallest buffer available. When more space is needed, the chain is extended using the largest buffers available.
 	static bool Allocate(OutputBuffer *&buf) noexcept;
 
 	// Get the number of bytes left for allocation. If writingBuffer is not NULL, this returns the number of free bytes for
@@ -97,26 +106,32 @@ public:
 
 	static void Diagnostics(MessageType mtype) noexcept;
 
-	static unsigned int GetFreeBuffers() noexcept { return OUTPUT_BUFFER_COUNT - usedOutputBuffers; }
+	static unsigned int GetFreeBuffers() noexcept;
+	static size_t GetFreeBytes() noexcept;
 
 private:
 	void Clear() noexcept;
+	bool Extend() noexcept;
+
+	static bool Allocate(OutputBuffer *&buf, bool largestFirst) noexcept;
 
 	OutputBuffer *next;
 	OutputBuffer *last;
 
 	uint32_t whenQueued;
 
-	char data[OUTPUT_BUFFER_SIZE];
+	char * const data;
+	const uint16_t capacity;
+	const uint8_t sizeClass;
 	size_t dataLength, bytesRead;
 
 	bool isReferenced;
 	bool hadOverflow;
 	volatile size_t references;
 
-	static OutputBuffer * volatile freeOutputBuffers;		// Messages may be sent by multiple tasks
-	static volatile size_t usedOutputBuffers;				// so make these volatile.
-	static volatile size_t maxUsedOutputBuffers;
+	static OutputBuffer * volatile freeOutputBuffers[NumOutputBufferClasses];	// Messages may be sent by multiple tasks
+	static volatile size_t usedOutputBuffers[NumOutputBufferClasses];			// so make these volatile.
+	static volatile size_t maxUsedOutputBuffers[NumOutputBufferClasses];
 };
 
 inline uint32_t OutputBuffer::GetAge() const noexcept
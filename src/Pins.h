@@ -164,6 +164,10 @@
 # define SUPPORT_TELNET			HAS_NETWORKING
 #endif
 
+#ifndef SUPPORT_MQTT
+# define SUPPORT_MQTT			HAS_LWIP_NETWORKING		// publish events and telemetry to an MQTT broker. Needs outgoing TCP connections.
+#endif
+
 #ifndef HAS_LINUX_INTERFACE
 # define HAS_LINUX_INTERFACE	0
 #endif
@@ -172,6 +176,34 @@
 # define HAS_MASS_STORAGE		1
 #endif
 
+#ifndef SUPPORT_MACRO_CACHE
+# define SUPPORT_MACRO_CACHE	HAS_MASS_STORAGE	// keep recently used macro files in RAM
+#endif
+
+#ifndef SUPPORT_STATUS_SNAPSHOT
+# define SUPPORT_STATUS_SNAPSHOT	1					// share recently rendered status responses between clients
+#endif
+
+#ifndef SUPPORT_TELEMETRY
+# define SUPPORT_TELEMETRY		SUPPORT_OBJECT_MODEL	// record the history of selected object model values
+#endif
+
+#ifndef SUPPORT_FILE_READAHEAD
+# define SUPPORT_FILE_READAHEAD	HAS_MASS_STORAGE	// read the file being printed ahead of execution on a separate task
+#endif
+
+#ifndef SUPPORT_FILE_WRITE_BEHIND
+# define SUPPORT_FILE_WRITE_BEHIND	HAS_MASS_STORAGE	// write uploaded files to the card on a separate task
+#endif
+
+#ifndef SUPPORT_DIRECTORY_INDEX
+# define SUPPORT_DIRECTORY_INDEX	HAS_MASS_STORAGE	// remember positions in the last directory listed, so that file lists can be paged quickly
+#endif
+
+#ifndef SUPPORT_FILE_INFO_CACHE
+# define SUPPORT_FILE_INFO_CACHE	HAS_MASS_STORAGE	// keep the information parsed from G-code files, and save it on the card
+#endif
+
 #if !HAS_MASS_STORAGE && !HAS_LINUX_INTERFACE
 # if SUPPORT_12864_LCD
 #  error "12864 LCD support requires mass storage or SBC interface"
@@ -2406,6 +2406,23 @@ GCodeResult Platform::DiagnosticTest(GCodeBuffer& gb, const StringRef& reply, Ou
 		}
 		break;
 
+#if SUPPORT_OBJECT_MODEL
+	case (unsigned int)DiagnosticTestType::TimeObjectModelLookup:
+		{
+			constexpr unsigned int iterations = 100;
+			uint32_t hashTicks, searchTicks;
+			size_t numNames, numTables;
+			const bool ok = reprap.TimeTableLookups(iterations, hashTicks, searchTicks, numNames, numTables);
+			const float nsPerTick = 1.0e9f/(float)StepTimer::GetTickRate();
+			reply.printf("Object model lookup of %u names in %u tables: perfect hash %.0fns, binary search %.0fns %s",
+							numNames, numTables,
+							(double)(nsPerTick * (float)hashTicks/(float)(iterations * numNames)),
+							(double)(nsPerTick * (float)searchTicks/(float)(iterations * numNames)),
+							(ok) ? "ok" : "ERROR");
+		}
+		break;
+#endif
+
 #ifdef DUET_NG
 	case (unsigned int)DiagnosticTestType::PrintExpanderStatus:
 		reply.printf("Expander status %04X\n", DuetExpansion::DiagnosticRead());
@@ -4138,6 +4155,15 @@ FileStore* Platform::OpenSysFile(const char *filename, OpenMode mode) const noex
 				: nullptr;
 }
 
+// Open a macro file for reading, using the macro cache if possible
+FileStore* Platform::OpenMacroFile(const char *filename) const noexcept
+{
+	String<MaxFilenameLength> location;
+	return (MakeSysFileName(location.GetRef(), filename))
+			? MassStorage::OpenMacroFile(location.c_str())
+				: nullptr;
+}
+
 bool Platform::DeleteSysFile(const char *filename) const noexcept
 {
 	String<MaxFilenameLength> location;
@@ -191,6 +191,7 @@ enum class DiagnosticTestType : unsigned int
 	PrintObjectSizes = 105,			// print the sizes of various objects
 	PrintObjectAddresses = 106,		// print the addresses and sizes of various objects
 	TimeCRC32 = 107,				// time how long it takes to calculate CRC32
+	TimeObjectModelLookup = 108,	// time how long it takes to look up object model names using the perfect hash and using a binary search
 
 #if __LPC17xx__ || STM32F4
 	PrintBoardConfiguration = 200,	// Prints out all pin/values loaded from SDCard to configure board
@@ -421,6 +422,7 @@ public:
 	GCodeResult SetSysDir(const char* dir, const StringRef& reply) noexcept;				// Set the system files path
 	bool SysFileExists(const char *filename) const noexcept;
 	FileStore* OpenSysFile(const char *filename, OpenMode mode) const noexcept;
+	FileStore* OpenMacroFile(const char *filename) const noexcept;
 	bool DeleteSysFile(const char *filename) const noexcept;
 	bool MakeSysFileName(const StringRef& result, const char *filename) const noexcept;
 	void AppendSysDir(const StringRef & path) const noexcept;
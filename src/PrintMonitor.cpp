@@ -25,6 +25,10 @@ Licence: GPL
 #include "Platform.h"
 #include "RepRap.h"
 
+#if SUPPORT_MQTT
+# include "Networking/MqttClient.h"
+#endif
+
 ReadWriteLock PrintMonitor::printMonitorLock;
 
 #if SUPPORT_OBJECT_MODEL
@@ -234,6 +238,9 @@ void PrintMonitor::Spin() noexcept
 						{
 							FirstLayerComplete();
 							currentLayer++;
+#if SUPPORT_MQTT
+							MqttClient::PublishEvent("layerComplete", "{\"layer\":%u}", currentLayer - 1);
+#endif
 
 							lastLayerZ = currentZ;
 							lastLayerChangeTime = GetPrintDuration();
@@ -246,6 +253,9 @@ void PrintMonitor::Spin() noexcept
 						ReadLocker locker(printMonitorLock);
 						LayerComplete();
 						currentLayer++;
+#if SUPPORT_MQTT
+						MqttClient::PublishEvent("layerComplete", "{\"layer\":%u}", currentLayer - 1);
+#endif
 
 						// If we know the layer height, compute what the current layer height should be. This is to handle slicers that use a different layer height for support.
 						lastLayerZ = (printingFileInfo.layerHeight > 0.0)
@@ -313,14 +323,40 @@ void PrintMonitor::StartedPrint() noexcept
 	isPrinting = true;
 	heatingUp = false;
 	printStartTime = millis64();
+#if SUPPORT_MQTT
+	PublishFileEvent("printStarted");
+#endif
 }
 
 void PrintMonitor::StoppedPrint() noexcept
 {
 	Reset();
 	isPrinting = heatingUp = printingFileParsed = false;
+#if SUPPORT_MQTT
+	PublishFileEvent("printStopped");
+#endif
+}
+
+#if SUPPORT_MQTT
+
+// Publish an event giving the name of the file being printed. If the path doesn't fit in an MQTT event, send just the file name, truncated if necessary.
+void PrintMonitor::PublishFileEvent(const char *event) const noexcept
+{
+	constexpr size_t WrapperLength = 11;									// length of {"file":""}
+	const char *fileName = filenameBeingPrinted.c_str();
+	if (filenameBeingPrinted.strlen() + WrapperLength > MqttClient::MaxPayloadLength)
+	{
+		const char * const slash = strrchr(fileName, '/');
+		if (slash != nullptr)
+		{
+			fileName = slash + 1;
+		}
+	}
+	MqttClient::PublishEvent(event, "{\"file\":\"%.*s\"}", (int)(MqttClient::MaxPayloadLength - WrapperLength), fileName);
 }
 
+#endif
+
 // Set the current layer number as given in a comment
 // The Z move to the new layer probably hasn't been done yet, so just store the layer number.
 void PrintMonitor::SetLayerNumber(uint32_t layerNumber) noexcept
@@ -87,6 +87,10 @@ private:
 	void LayerComplete() noexcept;
 	void Reset() noexcept;
 
+#if SUPPORT_MQTT
+	void PublishFileEvent(const char *event) const noexcept;
+#endif
+
 #if SUPPORT_OBJECT_MODEL
 	int32_t GetPrintOrSimulatedDuration() const noexcept;
 #endif
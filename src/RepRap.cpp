@@ -22,6 +22,9 @@
 #include <Hardware/SoftwareReset.h>
 #include <Hardware/ExceptionHandlers.h>
 #include "Version.h"
+#include "StatusSnapshot.h"
+#include "Telemetry.h"
+#include <Storage/CRC32.h>
 
 #ifdef DUET_NG
 # include "DueXn.h"
@@ -244,7 +247,7 @@ constexpr ObjectModelTableEntry RepRap::objectModelTable[] =
 	{ "scanner",				OBJECT_MODEL_FUNC(self->scanner),										ObjectModelEntryFlags::none },
 #endif
 	{ "sensors",				OBJECT_MODEL_FUNC(&self->platform->GetEndstops()),						ObjectModelEntryFlags::live },
-	{ "seqs",					OBJECT_MODEL_FUNC(self, 6),												ObjectModelEntryFlags::live },
+	{ "seqs",					OBJECT_MODEL_FUNC(self, SeqsTableNumber),								ObjectModelEntryFlags::live },
 	{ "spindles",				OBJECT_MODEL_FUNC_NOSELF(&spindlesArrayDescriptor),						ObjectModelEntryFlags::live },
 	{ "state",					OBJECT_MODEL_FUNC(self, 3),												ObjectModelEntryFlags::live },
 	{ "tools",					OBJECT_MODEL_FUNC_NOSELF(&toolsArrayDescriptor),						ObjectModelEntryFlags::live },
@@ -320,7 +323,7 @@ constexpr ObjectModelTableEntry RepRap::objectModelTable[] =
 	{ "logLevel",				OBJECT_MODEL_FUNC(self->platform->GetLogLevel()),						ObjectModelEntryFlags::none },
 	{ "machineMode",			OBJECT_MODEL_FUNC(self->gCodes->GetMachineModeString()),				ObjectModelEntryFlags::none },
 	{ "messageBox",				OBJECT_MODEL_FUNC_IF(self->mbox.active, self, 5),						ObjectModelEntryFlags::none },
-	{ "msUpTime",				OBJECT_MODEL_FUNC_NOSELF((int32_t)(context.GetStartMillis() % 1000u)),	ObjectModelEntryFlags::live },
+	{ "msUpTime",				OBJECT_MODEL_FUNC_NOSELF((int32_t)(context.GetStartMillis() % 1000u)),	ObjectModelEntryFlags::liveClock },
 	{ "nextTool",				OBJECT_MODEL_FUNC((int32_t)self->gCodes->GetNewToolNumber()),			ObjectModelEntryFlags::live },
 #if HAS_VOLTAGE_MONITOR
 	{ "powerFailScript",		OBJECT_MODEL_FUNC(self->gCodes->GetPowerFailScript()),					ObjectModelEntryFlags::none },
@@ -328,8 +331,8 @@ constexpr ObjectModelTableEntry RepRap::objectModelTable[] =
 	{ "previousTool",			OBJECT_MODEL_FUNC((int32_t)self->previousToolNumber),					ObjectModelEntryFlags::live },
 	{ "restorePoints",			OBJECT_MODEL_FUNC_NOSELF(&restorePointsArrayDescriptor),				ObjectModelEntryFlags::none },
 	{ "status",					OBJECT_MODEL_FUNC(self->GetStatusString()),								ObjectModelEntryFlags::live },
-	{ "time",					OBJECT_MODEL_FUNC(DateTime(self->platform->GetDateTime())),				ObjectModelEntryFlags::live },
-	{ "upTime",					OBJECT_MODEL_FUNC_NOSELF((int32_t)((context.GetStartMillis()/1000u) & 0x7FFFFFFF)),	ObjectModelEntryFlags::live },
+	{ "time",					OBJECT_MODEL_FUNC(DateTime(self->platform->GetDateTime())),				ObjectModelEntryFlags::liveClock },
+	{ "upTime",					OBJECT_MODEL_FUNC_NOSELF((int32_t)((context.GetStartMillis()/1000u) & 0x7FFFFFFF)),	ObjectModelEntryFlags::liveClock },
 
 	// 4. MachineModel.state.beep
 	{ "duration",				OBJECT_MODEL_FUNC((int32_t)self->beepDuration),							ObjectModelEntryFlags::none },
@@ -374,7 +377,7 @@ constexpr ObjectModelTableEntry RepRap::objectModelTable[] =
 constexpr uint8_t RepRap::objectModelTableDescriptor[] =
 {
 	7,																		// number of sub-tables
-	14 + SUPPORT_SCANNER + HAS_MASS_STORAGE,								// root
+	NumRootKeys,															// root
 #if HAS_MASS_STORAGE
 	8, 																		// directories
 #else
@@ -389,8 +392,114 @@ constexpr uint8_t RepRap::objectModelTableDescriptor[] =
 
 DEFINE_GET_OBJECT_MODEL_TABLE(RepRap)
 
+// Return true if a section of the object model has not changed since the sequence number in the context, so that it can be omitted from a delta report.
+// The sections are the root keys.
+bool RepRap::IsUnchangedSince(const ObjectModelTableEntry& entry, ObjectExplorationContext& context) const noexcept
+{
+	return &entry >= objectModelTable && &entry < objectModelTable + NumRootKeys	// only root keys are tracked
+		&& !SectionChangedSince(&entry - objectModelTable, context.GetChangedSince());
+}
+
+// Return true if a root section of the object model may have changed since the specified sequence number.
+// A section that can be changed by commands has an entry with the same name in the 'seqs' table. A section flagged as live also has a sequence number
+// for changes to its live values, which we keep here.
+bool RepRap::SectionChangedSince(size_t rootIndex, uint32_t seq) const noexcept
+{
+	const ObjectModelTableEntry& entry = objectModelTable[rootIndex];
+	const ObjectModelTableEntry * const seqEntry = FindObjectModelTableEntry(GetObjectModelClassDescriptor(), SeqsTableNumber, entry.name);
+	if (seqEntry != nullptr)
+	{
+		ObjectExplorationContext context(false, 0, 0);
+		if ((uint32_t)seqEntry->func(this, context).iVal > seq)
+		{
+			return true;
+		}
+	}
+	return GetLiveSeq(rootIndex) > seq;
+}
+
+// Return the sequence number of the latest change to the live values in a root section, or zero if the section has no live values.
+// Live values such as temperatures and positions are sampled rather than changed by calls to NextChangeSeq, so we find out whether they have changed
+// by comparing the CRC of a live-only report of the section with the one we got last time. We leave out values that follow the clock, because
+// otherwise every sample would differ. To limit the cost we sample each section at most once per LiveSeqSampleInterval.
+uint32_t RepRap::GetLiveSeq(size_t rootIndex) const noexcept
+{
+	const ObjectModelTableEntry& entry = objectModelTable[rootIndex];
+	if (((uint8_t)entry.flags & (uint8_t)ObjectModelEntryFlags::live) == 0)
+	{
+		return 0;
+	}
+
+	MutexLocker lock(liveSeqMutex);
+	const uint32_t now = millis();
+	if (liveSeqs[rootIndex] == 0 || now - whenLiveSampled[rootIndex] >= LiveSeqSampleInterval)
+	{
+		whenLiveSampled[rootIndex] = now;
+		bool sampled = false;
+		uint32_t crc = 0;
+		OutputBuffer *buf;
+		if (OutputBuffer::Allocate(buf))
+		{
+			ObjectExplorationContext context(false, "f", 99);
+			context.SetIgnoreClocks();
+			(void)entry.ReportAsJson(buf, context, GetObjectModelClassDescriptor(), this, "", true);
+			if (!buf->HadOverflow())
+			{
+				CRC32 crcCalc;
+				for (const OutputBuffer *b = buf; b != nullptr; b = b->Next())
+				{
+					crcCalc.Update(b->Data(), b->DataLength());
+				}
+				crc = crcCalc.Get();
+				sampled = true;
+			}
+			OutputBuffer::ReleaseAll(buf);
+		}
+
+		// If we couldn't get a complete report then we don't know whether anything changed, so assume it did
+		if (!sampled || crc != liveCrcs[rootIndex] || liveSeqs[rootIndex] == 0)
+		{
+			liveCrcs[rootIndex] = crc;
+			liveSeqs[rootIndex] = NextChangeSeq();
+		}
+	}
+	return liveSeqs[rootIndex];
+}
+
+// Return true if the part of the object model selected by a key may have changed since the specified sequence number.
+// Changes are tracked per root key, so for a deeper key we use the section it is in. An empty key selects the whole model.
+bool RepRap::KeyChangedSince(const char *key, uint32_t seq) const noexcept
+{
+	if (*key == '#')
+	{
+		++key;
+	}
+	if (*key == 0)
+	{
+		for (size_t i = 0; i < NumRootKeys; ++i)
+		{
+			if (SectionChangedSince(i, seq))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+	const ObjectModelTableEntry * const entry = FindObjectModelTableEntry(GetObjectModelClassDescriptor(), 0, key);
+	return entry == nullptr || SectionChangedSince(entry - objectModelTable, seq);
+}
+
 #endif
 
+// Return a new object model change sequence number. This may be called by any task, or from an ISR.
+uint32_t RepRap::NextChangeSeq() const noexcept
+{
+	const irqflags_t flags = cpu_irq_save();
+	const uint32_t rslt = ++changeSeq;
+	cpu_irq_restore(flags);
+	return rslt;
+}
+
 ReadWriteLock RepRap::toolListLock;
 
 // RepRap member functions.
@@ -398,7 +507,7 @@ ReadWriteLock RepRap::toolListLock;
 // Do nothing more in the constructor; put what you want in RepRap:Init()
 
 RepRap::RepRap() noexcept
-	: boardsSeq(0), directoriesSeq(0), fansSeq(0), heatSeq(0), inputsSeq(0), jobSeq(0), moveSeq(0),
+	: changeSeq(0), boardsSeq(0), directoriesSeq(0), fansSeq(0), heatSeq(0), inputsSeq(0), jobSeq(0), moveSeq(0),
 	  networkSeq(0), scannerSeq(0), sensorsSeq(0), spindlesSeq(0), stateSeq(0), toolsSeq(0), volumesSeq(0),
 	  toolList(nullptr), currentTool(nullptr), lastWarningMillis(0),
 	  activeExtruders(0), activeToolHeaters(0), numToolsToReport(0),
@@ -480,6 +589,19 @@ void RepRap::Init() noexcept
 #endif
 
 	messageBoxMutex.Create("MessageBox");
+#if SUPPORT_OBJECT_MODEL
+	liveSeqMutex.Create("LiveSeq");
+	for (uint32_t& seq : liveSeqs)
+	{
+		seq = 0;										// no live values sampled yet
+	}
+#endif
+#if SUPPORT_STATUS_SNAPSHOT
+	StatusSnapshot::Init();
+#endif
+#if SUPPORT_TELEMETRY
+	Telemetry::Init();
+#endif
 
 	platform->Init();
 	network->Init();
@@ -738,6 +860,14 @@ void RepRap::Spin() noexcept
 	spinningModule = moduleFilamentSensors;
 	FilamentMonitor::Spin();
 
+#if SUPPORT_STATUS_SNAPSHOT
+	StatusSnapshot::Spin();
+#endif
+
+#if SUPPORT_TELEMETRY
+	Telemetry::Spin();
+#endif
+
 #if SUPPORT_12864_LCD
 	ticksInSpinState = 0;
 	spinningModule = moduleDisplay;
@@ -855,6 +985,9 @@ void RepRap::Diagnostics(MessageType mtype) noexcept
 
 	// Show the used and free buffer counts. Do this early in case we are running out of them and the diagnostics get truncated.
 	OutputBuffer::Diagnostics(mtype);
+#if SUPPORT_STATUS_SNAPSHOT
+	StatusSnapshot::Diagnostics(mtype);
+#endif
 
 	// Now print diagnostics for other modules
 	Tasks::Diagnostics(mtype);
@@ -1419,27 +1552,47 @@ OutputBuffer *RepRap::GetStatusResponse(uint8_t type, ResponseSource source) con
 		const int8_t bedHeater = (MaxBedHeaters > 0) ? heat->GetBedHeater(0) : -1;
 		if (bedHeater != -1)
 		{
-			response->catf("\"bed\":{\"current\":%.1f,\"active\":%.1f,\"standby\":%.1f,\"state\":%u,\"heater\":%d},",
-				(double)heat->GetHeaterTemperature(bedHeater), (double)heat->GetActiveTemperature(bedHeater), (double)heat->GetStandbyTemperature(bedHeater),
-					heat->GetStatus(bedHeater).ToBaseType(), bedHeater);
+			response->cat("\"bed\":{\"current\":");
+			response->AppendFloat(heat->GetHeaterTemperature(bedHeater), 1);
+			response->cat(",\"active\":");
+			response->AppendFloat(heat->GetActiveTemperature(bedHeater), 1);
+			response->cat(",\"standby\":");
+			response->AppendFloat(heat->GetStandbyTemperature(bedHeater), 1);
+			response->cat(",\"state\":");
+			response->AppendUnsigned(heat->GetStatus(bedHeater).ToBaseType());
+			response->cat(",\"heater\":");
+			response->AppendInt(bedHeater);
+			response->cat("},");
 		}
 
 		/* Chamber */
 		const int8_t chamberHeater = (MaxChamberHeaters > 0) ? heat->GetChamberHeater(0) : -1;
 		if (chamberHeater != -1)
 		{
-			response->catf("\"chamber\":{\"current\":%.1f,\"active\":%.1f,\"state\":%u,\"heater\":%d},",
-				(double)heat->GetHeaterTemperature(chamberHeater), (double)heat->GetActiveTemperature(chamberHeater),
-					heat->GetStatus(chamberHeater).ToBaseType(), chamberHeater);
+			response->cat("\"chamber\":{\"current\":");
+			response->AppendFloat(heat->GetHeaterTemperature(chamberHeater), 1);
+			response->cat(",\"active\":");
+			response->AppendFloat(heat->GetActiveTemperature(chamberHeater), 1);
+			response->cat(",\"state\":");
+			response->AppendUnsigned(heat->GetStatus(chamberHeater).ToBaseType());
+			response->cat(",\"heater\":");
+			response->AppendInt(chamberHeater);
+			response->cat("},");
 		}
 
 		/* Cabinet */
 		const int8_t cabinetHeater = (MaxChamberHeaters > 1) ? heat->GetChamberHeater(1) : -1;
 		if (cabinetHeater != -1)
 		{
-			response->catf("\"cabinet\":{\"current\":%.1f,\"active\":%.1f,\"state\":%u,\"heater\":%d},",
-				(double)heat->GetHeaterTemperature(cabinetHeater), (double)heat->GetActiveTemperature(cabinetHeater),
-					heat->GetStatus(cabinetHeater).ToBaseType(), cabinetHeater);
+			response->cat("\"cabinet\":{\"current\":");
+			response->AppendFloat(heat->GetHeaterTemperature(cabinetHeater), 1);
+			response->cat(",\"active\":");
+			response->AppendFloat(heat->GetActiveTemperature(cabinetHeater), 1);
+			response->cat(",\"state\":");
+			response->AppendUnsigned(heat->GetStatus(cabinetHeater).ToBaseType());
+			response->cat(",\"heater\":");
+			response->AppendInt(cabinetHeater);
+			response->cat("},");
 		}
 
 		/* Heaters */
@@ -1507,7 +1660,9 @@ OutputBuffer *RepRap::GetStatusResponse(uint8_t type, ResponseSource source) con
 				first = false;
 				float temp;
 				(void)sensor->GetLatestTemperature(temp);
-				response->catf("{\"name\":\"%.s\",\"temp\":%.1f}", nm, HideNan(temp));
+				response->catf("{\"name\":\"%.s\",\"temp\":", nm);
+				response->AppendFloat((std::isnan(temp) || std::isinf(temp)) ? 9999.9f : temp, 1);
+				response->cat('}');
 			}
 			nextSensorNumber = sensor->GetSensorNumber() + 1;
 		}
@@ -2054,36 +2209,30 @@ OutputBuffer *RepRap::GetFilesResponse(const char *dir, unsigned int startAt, bo
 	{
 		err = 0;
 		FileInfo fileInfo;
-		unsigned int filesFound = 0;
-		bool gotFile = MassStorage::FindFirst(dir, fileInfo);
+		unsigned int filesFound = startAt;
+		bool gotFile = MassStorage::FindFirst(dir, fileInfo, startAt);		// this skips Mac resource files and Linux hidden files
 
 		size_t bytesLeft = OutputBuffer::GetBytesLeft(response);	// don't write more bytes than we can
 
 		while (gotFile)
 		{
-			if (fileInfo.fileName[0] != '.')						// ignore Mac resource files and Linux hidden files
+			// Make sure we can end this response properly
+			if (bytesLeft < fileInfo.fileName.strlen() * 2 + 20)
 			{
-				if (filesFound >= startAt)
-				{
-					// Make sure we can end this response properly
-					if (bytesLeft < fileInfo.fileName.strlen() * 2 + 20)
-					{
-						// No more space available - stop here
-						MassStorage::AbandonFindNext();
-						nextFile = filesFound;
-						break;
-					}
-
-					// Write separator and filename
-					if (filesFound != startAt)
-					{
-						bytesLeft -= response->cat(',');
-					}
+				// No more space available - stop here
+				MassStorage::AbandonFindNext();
+				nextFile = filesFound;
+				break;
+			}
 
-					bytesLeft -= response->catf((flagsDirs && fileInfo.isDirectory) ? "\"*%.s\"" : "\"%.s\"", fileInfo.fileName.c_str());
-				}
-				++filesFound;
+			// Write separator and filename
+			if (filesFound != startAt)
+			{
+				bytesLeft -= response->cat(',');
 			}
+
+			bytesLeft -= response->catf((flagsDirs && fileInfo.isDirectory) ? "\"*%.s\"" : "\"%.s\"", fileInfo.fileName.c_str());
+			++filesFound;
 			gotFile = MassStorage::FindNext(fileInfo);
 		}
 	}
@@ -2130,49 +2279,43 @@ OutputBuffer *RepRap::GetFilelistResponse(const char *dir, unsigned int startAt)
 	{
 		err = 0;
 		FileInfo fileInfo;
-		unsigned int filesFound = 0;
-		bool gotFile = MassStorage::FindFirst(dir, fileInfo);
+		unsigned int filesFound = startAt;
+		bool gotFile = MassStorage::FindFirst(dir, fileInfo, startAt);		// this skips Mac resource files and Linux hidden files
 		size_t bytesLeft = OutputBuffer::GetBytesLeft(response);	// don't write more bytes than we can
 
 		while (gotFile)
 		{
-			if (fileInfo.fileName[0] != '.')			// ignore Mac resource files and Linux hidden files
+			// Make sure we can end this response properly
+			if (bytesLeft < fileInfo.fileName.strlen() * 2 + 50)
 			{
-				if (filesFound >= startAt)
-				{
-					// Make sure we can end this response properly
-					if (bytesLeft < fileInfo.fileName.strlen() * 2 + 50)
-					{
-						// No more space available - stop here
-						MassStorage::AbandonFindNext();
-						nextFile = filesFound;
-						break;
-					}
+				// No more space available - stop here
+				MassStorage::AbandonFindNext();
+				nextFile = filesFound;
+				break;
+			}
 
-					// Write delimiter
-					if (filesFound != startAt)
-					{
-						bytesLeft -= response->cat(',');
-					}
+			// Write delimiter
+			if (filesFound != startAt)
+			{
+				bytesLeft -= response->cat(',');
+			}
 
-					// Write another file entry
-					bytesLeft -= response->catf("{\"type\":\"%c\",\"name\":\"%.s\",\"size\":%" PRIu32,
-												fileInfo.isDirectory ? 'd' : 'f', fileInfo.fileName.c_str(), fileInfo.size);
-					tm timeInfo;
-					gmtime_r(&fileInfo.lastModified, &timeInfo);
-					if (timeInfo.tm_year <= /*19*/80)
-					{
-						// Don't send the last modified date if it is invalid
-						bytesLeft -= response->cat('}');
-					}
-					else
-					{
-						bytesLeft -= response->catf(",\"date\":\"%04u-%02u-%02uT%02u:%02u:%02u\"}",
-								timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday, timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec);
-					}
-				}
-				++filesFound;
+			// Write another file entry
+			bytesLeft -= response->catf("{\"type\":\"%c\",\"name\":\"%.s\",\"size\":%" PRIu32,
+										fileInfo.isDirectory ? 'd' : 'f', fileInfo.fileName.c_str(), fileInfo.size);
+			tm timeInfo;
+			gmtime_r(&fileInfo.lastModified, &timeInfo);
+			if (timeInfo.tm_year <= /*19*/80)
+			{
+				// Don't send the last modified date if it is invalid
+				bytesLeft -= response->cat('}');
+			}
+			else
+			{
+				bytesLeft -= response->catf(",\"date\":\"%04u-%02u-%02uT%02u:%02u:%02u\"}",
+						timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday, timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec);
 			}
+			++filesFound;
 			gotFile = MassStorage::FindNext(fileInfo);
 		}
 	}
@@ -2296,7 +2439,15 @@ void RepRap::AppendFloatArray(OutputBuffer *buf, const char *name, size_t numVal
 		{
 			buf->cat(',');
 		}
-		buf->catf(GetFloatFormatString(numDecimalDigits), HideNan(func(i)));
+		const float f = func(i);
+		if (std::isnan(f) || std::isinf(f))
+		{
+			buf->catf(GetFloatFormatString(numDecimalDigits), HideNan(f));
+		}
+		else
+		{
+			buf->AppendFloat(f, numDecimalDigits);
+		}
 	}
 	buf->cat(']');
 }
@@ -2314,7 +2465,7 @@ void RepRap::AppendIntArray(OutputBuffer *buf, const char *name, size_t numValue
 		{
 			buf->cat(',');
 		}
-		buf->catf("%d", func(i));
+		buf->AppendInt(func(i));
 	}
 	buf->cat(']');
 }
@@ -2341,6 +2492,7 @@ void RepRap::AppendStringArray(OutputBuffer *buf, const char *name, size_t numVa
 
 // Return a query into the object model, or return nullptr if no buffer available
 // We append a newline to help PanelDue resync after receiving corrupt or incomplete data. DWC ignores it.
+// A 'b' in the flags selects CBOR, which callers must only allow when the response goes to a binary-clean channel. M409 rejects it.
 OutputBuffer *RepRap::GetModelResponse(const char *key, const char *flags) const THROWS(GCodeException)
 {
 	OutputBuffer *outBuf;
@@ -2349,7 +2501,9 @@ OutputBuffer *RepRap::GetModelResponse(const char *key, const char *flags) const
 		if (key == nullptr) { key = ""; }
 		if (flags == nullptr) { flags = ""; }
 
-		outBuf->printf("{\"key\":\"%.s\",\"flags\":\"%.s\"", key, flags);
+		// If this is a delta report then we tell the client the sequence number to use next time. Read it before generating the report so that we don't miss any changes.
+		const bool binary = (strchr(flags, 'b') != nullptr);
+		ReportHeader(outBuf, key, flags, GetChangeSeq(), binary);
 
 		const bool wantArrayLength = (*key == '#');
 		if (wantArrayLength)
@@ -2359,9 +2513,8 @@ OutputBuffer *RepRap::GetModelResponse(const char *key, const char *flags) const
 
 		try
 		{
-			outBuf->cat(",\"result\":");
 			reprap.ReportAsJson(outBuf, key, flags, wantArrayLength);
-			outBuf->cat("}\n");
+			ReportTrailer(outBuf, binary);
 			if (outBuf->HadOverflow())
 			{
 				OutputBuffer::ReleaseAll(outBuf);
@@ -2377,6 +2530,12 @@ OutputBuffer *RepRap::GetModelResponse(const char *key, const char *flags) const
 	return outBuf;
 }
 
+// Start a model report that will be generated a piece at a time. Returns null if the key and flags need the report to be generated in one go using GetModelResponse.
+ObjectModelReportCursor *RepRap::StartModelReport(const char *key, const char *flags) const noexcept
+{
+	return ObjectModelReportCursor::Create(this, key, flags, GetChangeSeq());
+}
+
 #endif
 
 // Send a beep. We send it to both PanelDue and the web interface.
@@ -152,6 +152,7 @@ public:
 
 #if SUPPORT_OBJECT_MODEL
 	OutputBuffer *GetModelResponse(const char *key, const char *flags) const THROWS(GCodeException);
+	ObjectModelReportCursor *StartModelReport(const char *key, const char *flags) const noexcept;
 #endif
 
 	void Beep(unsigned int freq, unsigned int ms) noexcept;
@@ -180,20 +181,26 @@ public:
 
 	void KickHeatTaskWatchdog() noexcept { heatTaskIdleTicks = 0; }
 
-	void BoardsUpdated() noexcept { ++boardsSeq; }
-	void DirectoriesUpdated() noexcept { ++directoriesSeq; }
-	void FansUpdated() noexcept { ++fansSeq; }
-	void HeatUpdated() noexcept { ++heatSeq; }
-	void InputsUpdated() noexcept { ++inputsSeq; }
-	void JobUpdated() noexcept { ++jobSeq; }
-	void MoveUpdated() noexcept { ++moveSeq; }
-	void NetworkUpdated() noexcept { ++networkSeq; }
-	void ScannerUpdated() noexcept { ++scannerSeq; }
-	void SensorsUpdated() noexcept { ++sensorsSeq; }
-	void SpindlesUpdated() noexcept { ++spindlesSeq; }
-	void StateUpdated() noexcept { ++stateSeq; }
-	void ToolsUpdated() noexcept { ++toolsSeq; }
-	void VolumesUpdated() noexcept { ++volumesSeq; }
+	// Each of these records the sequence number of the latest change to a section of the object model.
+	// The sequence numbers come from a single counter, so a client can ask for just the sections that changed after a sequence number it received earlier.
+	void BoardsUpdated() noexcept { boardsSeq = NextChangeSeq(); }
+	void DirectoriesUpdated() noexcept { directoriesSeq = NextChangeSeq(); }
+	void FansUpdated() noexcept { fansSeq = NextChangeSeq(); }
+	void HeatUpdated() noexcept { heatSeq = NextChangeSeq(); }
+	void InputsUpdated() noexcept { inputsSeq = NextChangeSeq(); }
+	void JobUpdated() noexcept { jobSeq = NextChangeSeq(); }
+	void MoveUpdated() noexcept { moveSeq = NextChangeSeq(); }
+	void NetworkUpdated() noexcept { networkSeq = NextChangeSeq(); }
+	void ScannerUpdated() noexcept { scannerSeq = NextChangeSeq(); }
+	void SensorsUpdated() noexcept { sensorsSeq = NextChangeSeq(); }
+	void SpindlesUpdated() noexcept { spindlesSeq = NextChangeSeq(); }
+	void StateUpdated() noexcept { stateSeq = NextChangeSeq(); }
+	void ToolsUpdated() noexcept { toolsSeq = NextChangeSeq(); }
+	void VolumesUpdated() noexcept { volumesSeq = NextChangeSeq(); }
+	uint32_t GetChangeSeq() const noexcept { return changeSeq; }
+#if SUPPORT_OBJECT_MODEL
+	bool KeyChangedSince(const char *key, uint32_t seq) const noexcept;
+#endif
 
 protected:
 	DECLARE_OBJECT_MODEL
@@ -254,8 +261,26 @@ private:
 
  	mutable Mutex messageBoxMutex;				// mutable so that we can lock and release it in const functions
 
-	uint16_t boardsSeq, directoriesSeq, fansSeq, heatSeq, inputsSeq, jobSeq, moveSeq;
-	uint16_t networkSeq, scannerSeq, sensorsSeq, spindlesSeq, stateSeq, toolsSeq, volumesSeq;
+#if SUPPORT_OBJECT_MODEL
+	static constexpr unsigned int SeqsTableNumber = 6;			// the object model table holding the 'seqs' entries
+	static constexpr size_t NumRootKeys = 14 + SUPPORT_SCANNER + HAS_MASS_STORAGE;	// the number of entries in the root table
+
+	bool IsUnchangedSince(const ObjectModelTableEntry& entry, ObjectExplorationContext& context) const noexcept override;
+	bool SectionChangedSince(size_t rootIndex, uint32_t seq) const noexcept;
+	uint32_t GetLiveSeq(size_t rootIndex) const noexcept;
+#endif
+
+	uint32_t NextChangeSeq() const noexcept;
+
+	mutable volatile uint32_t changeSeq;		// the sequence number of the latest change to any section of the object model, mutable so that we can record changes to live values in const functions
+	uint32_t boardsSeq, directoriesSeq, fansSeq, heatSeq, inputsSeq, jobSeq, moveSeq;
+	uint32_t networkSeq, scannerSeq, sensorsSeq, spindlesSeq, stateSeq, toolsSeq, volumesSeq;
+#if SUPPORT_OBJECT_MODEL
+	mutable Mutex liveSeqMutex;					// protects the following arrays
+	mutable uint32_t liveSeqs[NumRootKeys];		// the sequence number of the latest change we found to the live values in each root section
+	mutable uint32_t liveCrcs[NumRootKeys];		// the CRC of the live values in each root section when we last sampled them
+	mutable uint32_t whenLiveSampled[NumRootKeys];	// when we last sampled the live values in each root section
+#endif
 
 	Tool* toolList;								// the tool list is sorted in order of increasing tool number
 	Tool* currentTool;
@@ -0,0 +1,205 @@
+/*
+ * StatusSnapshot.cpp
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#include "StatusSnapshot.h"
+
+#if SUPPORT_STATUS_SNAPSHOT
+
+#include "Platform.h"
+#include <RTOSIface/RTOSIface.h>
+
+static Mutex snapshotMutex;
+
+StatusSnapshot::Entry StatusSnapshot::entries[NumEntries];
+unsigned int StatusSnapshot::numHits = 0;
+unsigned int StatusSnapshot::numMisses = 0;
+
+void StatusSnapshot::Init() noexcept
+{
+	snapshotMutex.Create("StatusSnapshot");
+	for (Entry& e : entries)
+	{
+		e.buf = nullptr;
+		e.kind = Kind::free;
+	}
+}
+
+bool StatusSnapshot::Entry::Matches(Kind k, uint8_t t, int32_t p, const char *ky, const char *fl) const noexcept
+{
+	return kind == k && type == t && param == p && (ky == nullptr || (key.Equals(ky) && flags.Equals(fl)));
+}
+
+// Release any snapshots that have expired. Called from RepRap::Spin.
+void StatusSnapshot::Spin() noexcept
+{
+	MutexLocker lock(snapshotMutex);
+	Expire(millis());
+}
+
+// Release entries that have expired or that were rendered before the latest change to the object model. The mutex must be owned.
+/*static*/ void StatusSnapshot::Expire(uint32_t now) noexcept
+{
+	const uint32_t seq = reprap.GetChangeSeq();
+	for (Entry& e : entries)
+	{
+		if (e.kind != Kind::free && (now - e.whenRendered >= StatusSnapshotInterval || e.changeSeq != seq))
+		{
+			OutputBuffer::ReleaseAll(e.buf);
+			e.kind = Kind::free;
+		}
+	}
+}
+
+// Make a private copy of a buffer chain, or return null if we run out of buffers
+/*static*/ OutputBuffer *StatusSnapshot::Copy(const OutputBuffer *buf) noexcept
+{
+	OutputBuffer *rslt;
+	if (!OutputBuffer::Allocate(rslt))
+	{
+		return nullptr;
+	}
+
+	for (const OutputBuffer *b = buf; b != nullptr; b = b->Next())
+	{
+		rslt->cat(b->Data(), b->DataLength());
+	}
+	if (rslt->HadOverflow())
+	{
+		OutputBuffer::ReleaseAll(rslt);
+	}
+	return rslt;
+}
+
+// Look for a current snapshot of the requested response and return a copy of it if we find one
+/*static*/ OutputBuffer *StatusSnapshot::Find(Kind kind, uint8_t type, int32_t param, const char *key, const char *flags) noexcept
+{
+	MutexLocker lock(snapshotMutex);
+	Expire(millis());
+	for (const Entry& e : entries)
+	{
+		if (e.Matches(kind, type, param, key, flags))
+		{
+			OutputBuffer * const rslt = Copy(e.buf);
+			if (rslt != nullptr)
+			{
+				++numHits;
+				return rslt;
+			}
+			break;
+		}
+	}
+	++numMisses;
+	return nullptr;
+}
+
+// Keep a newly rendered response so that other requesters can have copies of it. The caller keeps ownership of buf.
+// 'seq' is the object model change sequence number read before the response was rendered. If it has changed since then, the response may be
+// out of date already, so we don't keep it.
+/*static*/ void StatusSnapshot::Store(OutputBuffer *buf, uint32_t seq, Kind kind, uint8_t type, int32_t param, const char *key, const char *flags) noexcept
+{
+	if (buf == nullptr || seq != reprap.GetChangeSeq() || (key != nullptr && (strlen(key) > StringLength50 || strlen(flags) > StringLength20)))
+	{
+		return;
+	}
+
+	MutexLocker lock(snapshotMutex);
+	const uint32_t now = millis();
+	Expire(now);
+
+	// Don't tie up output buffers that are needed more urgently
+	if (OutputBuffer::GetFreeBytes() < buf->Length() + MinFreeBytesToStore)
+	{
+		return;
+	}
+
+	// Replace an existing entry for the same response if there is one, else use a free entry, else replace the oldest one
+	Entry *slot = nullptr;
+	for (Entry& e : entries)
+	{
+		if (e.Matches(kind, type, param, key, flags))
+		{
+			slot = &e;
+			break;
+		}
+		if (slot == nullptr || (slot->kind != Kind::free && (e.kind == Kind::free || now - e.whenRendered > now - slot->whenRendered)))
+		{
+			slot = &e;
+		}
+	}
+
+	OutputBuffer * const copy = Copy(buf);
+	if (copy != nullptr)
+	{
+		if (slot->kind != Kind::free)
+		{
+			OutputBuffer::ReleaseAll(slot->buf);
+		}
+		slot->buf = copy;
+		slot->whenRendered = now;
+		slot->changeSeq = seq;
+		slot->kind = kind;
+		slot->type = type;
+		slot->param = param;
+		if (key != nullptr)
+		{
+			slot->key.copy(key);
+			slot->flags.copy(flags);
+		}
+	}
+}
+
+OutputBuffer *StatusSnapshot::GetStatusResponse(uint8_t type, ResponseSource source) noexcept
+{
+	OutputBuffer *buf = Find(Kind::status, type, (int32_t)source, nullptr, nullptr);
+	if (buf == nullptr)
+	{
+		const uint32_t changeSeq = reprap.GetChangeSeq();
+		buf = reprap.GetStatusResponse(type, source);
+		Store(buf, changeSeq, Kind::status, type, (int32_t)source, nullptr, nullptr);
+	}
+	return buf;
+}
+
+OutputBuffer *StatusSnapshot::GetLegacyStatusResponse(uint8_t type, int seq) noexcept
+{
+	OutputBuffer *buf = Find(Kind::legacyStatus, type, seq, nullptr, nullptr);
+	if (buf == nullptr)
+	{
+		const uint32_t changeSeq = reprap.GetChangeSeq();
+		buf = reprap.GetLegacyStatusResponse(type, seq);
+		Store(buf, changeSeq, Kind::legacyStatus, type, seq, nullptr, nullptr);
+	}
+	return buf;
+}
+
+#if SUPPORT_OBJECT_MODEL
+
+OutputBuffer *StatusSnapshot::GetModelResponse(const char *key, const char *flags) THROWS(GCodeException)
+{
+	if (key == nullptr) { key = ""; }
+	if (flags == nullptr) { flags = ""; }
+
+	OutputBuffer *buf = Find(Kind::model, 0, 0, key, flags);
+	if (buf == nullptr)
+	{
+		const uint32_t changeSeq = reprap.GetChangeSeq();
+		buf = reprap.GetModelResponse(key, flags);
+		Store(buf, changeSeq, Kind::model, 0, 0, key, flags);
+	}
+	return buf;
+}
+
+#endif
+
+void StatusSnapshot::Diagnostics(MessageType mtype) noexcept
+{
+	reprap.GetPlatform().MessageF(mtype, "Status snapshots: hits %u, misses %u\n", numHits, numMisses);
+	numHits = numMisses = 0;
+}
+
+#endif
+
+// End
@@ -0,0 +1,82 @@
+/*
+ * StatusSnapshot.h
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#ifndef SRC_STATUSSNAPSHOT_H_
+#define SRC_STATUSSNAPSHOT_H_
+
+#include "RepRapFirmware.h"
+#include "RepRap.h"
+
+#if SUPPORT_STATUS_SNAPSHOT
+
+// Cache of recently rendered status and object model responses, so that when several clients (HTTP, Telnet, USB, PanelDue, SBC) poll for the
+// same report within StatusSnapshotInterval we render it once and give each requester a copy. Copying a chain of output buffers is much cheaper
+// than rendering it. Each requester gets its own copy rather than a shared reference because the read position is held in the buffers and
+// several network responders may be sending at the same time, and because some callers append to the response.
+// Entries are released as soon as they expire so that they don't tie up output buffers, or as soon as the object model change sequence number moves
+// on so that a client never sees a report that is older than a change it has already been told about. Commands such as M409 sent from a G-code
+// source must not use snapshots, because they may follow commands that changed the model.
+class StatusSnapshot
+{
+public:
+	static void Init() noexcept;
+	static void Spin() noexcept;
+
+	static OutputBuffer *GetStatusResponse(uint8_t type, ResponseSource source) noexcept;
+	static OutputBuffer *GetLegacyStatusResponse(uint8_t type, int seq) noexcept;
+#if SUPPORT_OBJECT_MODEL
+	static OutputBuffer *GetModelResponse(const char *key, const char *flags) THROWS(GCodeException);
+#endif
+
+	static void Diagnostics(MessageType mtype) noexcept;
+
+private:
+	StatusSnapshot() = delete;
+
+	enum class Kind : uint8_t { free, status, legacyStatus, model };
+
+	struct Entry
+	{
+		OutputBuffer *buf;
+		uint32_t whenRendered;
+		uint32_t changeSeq;								// the object model change sequence number when we started rendering the response
+		int32_t param;									// the response source or sequence number
+		Kind kind;
+		uint8_t type;
+		String<StringLength50> key;
+		String<StringLength20> flags;
+
+		bool Matches(Kind k, uint8_t t, int32_t p, const char *ky, const char *fl) const noexcept;
+	};
+
+	static constexpr size_t NumEntries = 3;
+	static constexpr size_t MinFreeBytesToStore = 8 * OUTPUT_BUFFER_SIZE;	// don't keep a snapshot if it would leave less free output buffer space than this
+
+	static OutputBuffer *Find(Kind kind, uint8_t type, int32_t param, const char *key, const char *flags) noexcept;
+	static void Store(OutputBuffer *buf, uint32_t seq, Kind kind, uint8_t type, int32_t param, const char *key, const char *flags) noexcept;
+	static OutputBuffer *Copy(const OutputBuffer *buf) noexcept;
+	static void Expire(uint32_t now) noexcept;
+
+	static Entry entries[NumEntries];
+	static unsigned int numHits, numMisses;
+};
+
+#else
+
+// Without snapshots every request renders its own response
+class StatusSnapshot
+{
+public:
+	static OutputBuffer *GetStatusResponse(uint8_t type, ResponseSource source) noexcept { return reprap.GetStatusResponse(type, source); }
+	static OutputBuffer *GetLegacyStatusResponse(uint8_t type, int seq) noexcept { return reprap.GetLegacyStatusResponse(type, seq); }
+#if SUPPORT_OBJECT_MODEL
+	static OutputBuffer *GetModelResponse(const char *key, const char *flags) THROWS(GCodeException) { return reprap.GetModelResponse(key, flags); }
+#endif
+};
+
+#endif
+
+#endif /* SRC_STATUSSNAPSHOT_H_ */
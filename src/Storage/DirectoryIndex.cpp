@@ -0,0 +1,155 @@
+/*
+ * DirectoryIndex.cpp
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#include "DirectoryIndex.h"
+#include "MassStorage.h"
+
+#if SUPPORT_DIRECTORY_INDEX
+
+#include <Platform.h>
+#include <RepRap.h>
+#include <RTOSIface/RTOSIface.h>
+
+static Mutex indexMutex;
+
+String<MaxFilenameLength> DirectoryIndex::indexedDirectory;
+DIR DirectoryIndex::checkpoints[DirectoryIndexCheckpoints];
+DIR DirectoryIndex::cursor;
+size_t DirectoryIndex::numCheckpoints = 0;
+unsigned int DirectoryIndex::interval = DirectoryIndexInterval;
+unsigned int DirectoryIndex::cursorIndex = 0;
+bool DirectoryIndex::valid = false;
+bool DirectoryIndex::haveCursor = false;
+unsigned int DirectoryIndex::numSeeks = 0;
+unsigned int DirectoryIndex::entriesSkipped = 0;
+
+void DirectoryIndex::Init() noexcept
+{
+	indexMutex.Create("DirIndex");
+}
+
+// Return true if a change to the path with this key could change the listing of the indexed directory, i.e. the path is in it or above it.
+// The mutex must be owned.
+/*static*/ bool DirectoryIndex::Affects(const char *key) noexcept
+{
+	const size_t keyLength = strlen(key);
+	const char * const indexed = indexedDirectory.c_str();
+	const size_t indexedLength = indexedDirectory.strlen();
+	if (keyLength <= indexedLength)
+	{
+		return StringStartsWithIgnoreCase(indexed, key)
+			&& (keyLength == indexedLength || indexed[keyLength] == '/' || indexed[keyLength] == '\\');
+	}
+	return StringStartsWithIgnoreCase(key, indexed) && (key[indexedLength] == '/' || key[indexedLength] == '\\');
+}
+
+// Get the best starting point for reading the listed entry 'startAt'. 'directory' must not have a trailing '/'.
+unsigned int DirectoryIndex::Seek(const char *directory, unsigned int startAt, DIR& dir) noexcept
+{
+	const char * const key = MassStorage::CacheKey(directory);
+	MutexLocker lock(indexMutex);
+	++numSeeks;
+	if (!valid || !StringEqualsIgnoreCase(indexedDirectory.c_str(), key))
+	{
+		// Start indexing this directory instead
+		indexedDirectory.copy(key);
+		valid = true;
+		numCheckpoints = 0;
+		interval = DirectoryIndexInterval;
+		haveCursor = false;
+		entriesSkipped += startAt;
+		return 0;
+	}
+
+	unsigned int index = 0;
+	if (numCheckpoints != 0)
+	{
+		const size_t n = min<size_t>(startAt/interval, numCheckpoints - 1);
+		dir = checkpoints[n];
+		index = n * interval;
+	}
+	if (haveCursor && cursorIndex <= startAt && cursorIndex >= index)
+	{
+		dir = cursor;
+		index = cursorIndex;
+	}
+	entriesSkipped += startAt - index;
+	return index;
+}
+
+// Record the position of a listed entry if it is the next checkpoint. Entries are recorded in order as the directory is read.
+void DirectoryIndex::Record(unsigned int index, const DIR& dir) noexcept
+{
+	MutexLocker lock(indexMutex);
+	if (!valid || index % interval != 0 || index/interval != numCheckpoints)
+	{
+		return;
+	}
+
+	if (numCheckpoints == DirectoryIndexCheckpoints)
+	{
+		// We have run out of room, so keep every other checkpoint and double the interval between them
+		for (size_t i = 1; i < DirectoryIndexCheckpoints/2; ++i)
+		{
+			checkpoints[i] = checkpoints[2 * i];
+		}
+		numCheckpoints = DirectoryIndexCheckpoints/2;
+		interval *= 2;
+		if (index % interval != 0)
+		{
+			return;
+		}
+	}
+	checkpoints[numCheckpoints++] = dir;
+}
+
+void DirectoryIndex::SetCursor(unsigned int index, const DIR& dir) noexcept
+{
+	MutexLocker lock(indexMutex);
+	if (valid)
+	{
+		cursor = dir;
+		cursorIndex = index;
+		haveCursor = true;
+	}
+}
+
+// Invalidate the index if a file or directory has been created, changed, deleted or renamed in or above the indexed directory
+void DirectoryIndex::Invalidate(const char *path) noexcept
+{
+	String<MaxFilenameLength> key;
+	key.copy(MassStorage::CacheKey(path));
+	size_t keyLength = key.strlen();
+	while (keyLength != 0 && (key[keyLength - 1] == '/' || key[keyLength - 1] == '\\'))
+	{
+		--keyLength;
+	}
+	key.Truncate(keyLength);
+
+	MutexLocker lock(indexMutex);
+	if (valid && Affects(key.c_str()))
+	{
+		valid = false;
+	}
+}
+
+// Forget the index. Called when a card is unmounted.
+void DirectoryIndex::Clear() noexcept
+{
+	MutexLocker lock(indexMutex);
+	valid = false;
+}
+
+void DirectoryIndex::Diagnostics(MessageType mtype) noexcept
+{
+	reprap.GetPlatform().MessageF(mtype, "Directory index: %u checkpoints every %u entries, %u seeks, %u entries skipped\n",
+									(valid) ? numCheckpoints : 0, interval, numSeeks, entriesSkipped);
+	numSeeks = entriesSkipped = 0;
+}
+
+#endif
+
+// End
@@ -0,0 +1,56 @@
+/*
+ * DirectoryIndex.h
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#ifndef SRC_STORAGE_DIRECTORYINDEX_H_
+#define SRC_STORAGE_DIRECTORYINDEX_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_DIRECTORY_INDEX
+
+#include <Libraries/Fatfs/ff.h>
+
+// Index of the directory that was listed most recently, so that fetching a page of a long file list doesn't need the directory to be read from the start.
+// A FatFS directory object holds nothing but the position of the next entry to read, so we keep copies of it: one for every Nth entry of the listing,
+// and a cursor at the entry where the last page ended, which is where the next page usually starts. When there are more entries than we have room
+// for, N is doubled and every other copy is discarded, so the memory used is fixed. The listing counts only the entries that are reported, i.e. not
+// names that start with '.'. Like the macro cache, the index is invalidated when the firmware changes anything in or above the indexed directory,
+// and cleared when a card is unmounted. FatFS rejects the copies if the volume has been remounted since.
+class DirectoryIndex
+{
+public:
+	static void Init() noexcept;
+
+	// Get the best starting point for reading listed entry 'startAt' of a directory. If we have one, copy it to 'dir' and return the index of the entry
+	// it is positioned at, else return 0 and leave 'dir' unchanged. If the directory is not the one we have indexed, we start indexing it instead.
+	static unsigned int Seek(const char *directory, unsigned int startAt, DIR& dir) noexcept;
+
+	static void Record(unsigned int index, const DIR& dir) noexcept;		// record that 'dir' is positioned at listed entry 'index'
+	static void SetCursor(unsigned int index, const DIR& dir) noexcept;		// record where the current page of the listing ended
+	static void Invalidate(const char *path) noexcept;						// invalidate the index if it refers to this path or to a directory in it
+	static void Clear() noexcept;
+
+	static void Diagnostics(MessageType mtype) noexcept;
+
+private:
+	DirectoryIndex() = delete;
+
+	static bool Affects(const char *key) noexcept;
+
+	static String<MaxFilenameLength> indexedDirectory;					// without the volume number if it is 0, or a trailing '/'
+	static DIR checkpoints[DirectoryIndexCheckpoints];					// checkpoint n is positioned at listed entry n * interval
+	static DIR cursor;
+	static size_t numCheckpoints;
+	static unsigned int interval;
+	static unsigned int cursorIndex;
+	static bool valid;													// false if we have no index
+	static bool haveCursor;
+	static unsigned int numSeeks, entriesSkipped;
+};
+
+#endif
+
+#endif /* SRC_STORAGE_DIRECTORYINDEX_H_ */
@@ -93,6 +93,11 @@ public:
 		return f->Flush();
 	}
 
+	bool Truncate() noexcept
+	{
+		return f->Truncate();
+	}
+
 	FilePosition GetPosition() const noexcept
 	{
 		return f->Position();
@@ -108,6 +113,20 @@ public:
 		return f->Length();
 	}
 
+#if SUPPORT_FILE_READAHEAD
+	void StartReadahead() noexcept
+	{
+		f->StartReadahead();
+	}
+#endif
+
+#if SUPPORT_FILE_WRITE_BEHIND
+	void StartWriteBehind() noexcept
+	{
+		f->StartWriteBehind();
+	}
+#endif
+
 	// Move operator
 	void MoveFrom(FileData& other) noexcept
 	{
@@ -0,0 +1,479 @@
+/*
+ * FileInfoCache.cpp
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#include "FileInfoCache.h"
+
+#if SUPPORT_FILE_INFO_CACHE
+
+#include "FileStore.h"
+#include "MassStorage.h"
+#include "CRC32.h"
+#include <Platform.h>
+#include <RepRap.h>
+#include <PrintMonitor.h>
+#include <RTOSIface/RTOSIface.h>
+
+static Mutex cacheMutex;
+static Mutex ioMutex;														// owned while reading or writing an entry on the card, and before the cache mutex
+
+FileInfoCache::Entry FileInfoCache::entries[FileInfoCacheEntries];
+String<MaxFilenameLength> FileInfoCache::ioPath;
+GCodeFileInfo FileInfoCache::ioInfo;
+String<MaxFilenameLength> FileInfoCache::queue[FileInfoParseQueueLength];
+size_t FileInfoCache::queueHead = 0;
+size_t FileInfoCache::queueCount = 0;
+uint32_t FileInfoCache::useCount = 0;
+uint32_t FileInfoCache::whenChanged = 0;
+bool FileInfoCache::changed = false;
+bool FileInfoCache::pruneNeeded = true;
+unsigned int FileInfoCache::numHits = 0;
+unsigned int FileInfoCache::numCardHits = 0;
+unsigned int FileInfoCache::numMisses = 0;
+
+void FileInfoCache::Init() noexcept
+{
+	cacheMutex.Create("FileInfoCache");
+	ioMutex.Create("FileInfoCacheIO");
+	for (Entry& e : entries)
+	{
+		e.lastUsed = 0;
+		e.dirty = false;
+		e.touched = false;
+	}
+}
+
+// Make the name of the file that holds the entry for a key, relative to the system directory. Keys are compared ignoring case, so we hash them in lower case.
+/*static*/ void FileInfoCache::MakeRecordName(const StringRef& name, const char *key) noexcept
+{
+	CRC32 crc;
+	while (*key != 0)
+	{
+		crc.Update((char)tolower(*key++));
+	}
+	name.printf(FILE_INFO_CACHE_DIR "/%08" PRIx32, crc.Get());
+}
+
+// Read the entry for a key from the card into ioPath and ioInfo, returning true if we found one. It may be for a different key with the same hash.
+// The I/O mutex must be owned and the cache mutex must not be.
+/*static*/ bool FileInfoCache::ReadRecord(const char *key) noexcept
+{
+	String<MaxFilenameLength> name;
+	MakeRecordName(name.GetRef(), key);
+	FileStore * const f = reprap.GetPlatform().OpenSysFile(name.c_str(), OpenMode::read);
+	if (f == nullptr)
+	{
+		return false;
+	}
+
+	RecordHeader header;
+	const bool ok = f->Read(reinterpret_cast<char*>(&header), sizeof(header)) == (int)sizeof(header)
+					&& header.magic == RecordMagic && header.pathSize == sizeof(ioPath) && header.infoSize == sizeof(ioInfo)
+					&& f->Read(reinterpret_cast<char*>(&ioPath), sizeof(ioPath)) == (int)sizeof(ioPath)
+					&& f->Read(reinterpret_cast<char*>(&ioInfo), sizeof(ioInfo)) == (int)sizeof(ioInfo);
+	f->Close();
+	return ok;
+}
+
+// Write the entry in ioPath and ioInfo to the card, replacing any entry with the same hash. The I/O mutex must be owned and the cache mutex must not be.
+/*static*/ void FileInfoCache::WriteRecord() noexcept
+{
+	String<MaxFilenameLength> name;
+	MakeRecordName(name.GetRef(), ioPath.c_str());
+	FileStore * const f = reprap.GetPlatform().OpenSysFile(name.c_str(), OpenMode::write);
+	if (f == nullptr)
+	{
+		return;
+	}
+
+	RecordHeader header;
+	header.magic = RecordMagic;
+	header.pathSize = sizeof(ioPath);
+	header.infoSize = sizeof(ioInfo);
+	bool ok = f->Write(reinterpret_cast<const char*>(&header), sizeof(header))
+				&& f->Write(reinterpret_cast<const char*>(&ioPath), sizeof(ioPath))
+				&& f->Write(reinterpret_cast<const char*>(&ioInfo), sizeof(ioInfo));
+	ok = f->Close() && ok;
+	if (!ok)
+	{
+		reprap.GetPlatform().MessageF(WarningMessage, "Failed to save the file info for %s\n", ioPath.c_str());
+	}
+}
+
+// Delete the record for a key if there is one and it is for that key and not a different one with the same hash. Return true if we deleted it,
+// in which case ioPath and ioInfo hold what it contained. The I/O mutex must be owned and the cache mutex must not be.
+/*static*/ bool FileInfoCache::DeleteRecord(const char *key) noexcept
+{
+	if (!ReadRecord(key) || !StringEqualsIgnoreCase(ioPath.c_str(), key))
+	{
+		return false;
+	}
+	String<MaxFilenameLength> name;
+	MakeRecordName(name.GetRef(), key);
+	return reprap.GetPlatform().DeleteSysFile(name.c_str());
+}
+
+// Write the dirty entries to the card, and set the last modified time of the records of the touched ones so that the least recently used records are deleted first.
+// The I/O mutex must be owned and the cache mutex must not be.
+/*static*/ void FileInfoCache::SaveEntries() noexcept
+{
+	Platform& platform = reprap.GetPlatform();
+	for (;;)
+	{
+		bool dirty;
+		{
+			MutexLocker lock(cacheMutex);
+			Entry *changedEntry = nullptr;
+			for (Entry& e : entries)
+			{
+				if (e.lastUsed != 0 && (e.dirty || e.touched))
+				{
+					changedEntry = &e;
+					break;
+				}
+			}
+			if (changedEntry == nullptr)
+			{
+				changed = false;
+				return;
+			}
+			ioPath.copy(changedEntry->path.c_str());
+			ioInfo = changedEntry->info;
+			dirty = changedEntry->dirty;
+			changedEntry->dirty = changedEntry->touched = false;
+		}
+
+		if (dirty)
+		{
+			WriteRecord();
+			pruneNeeded = true;
+		}
+		else if (platform.IsDateTimeSet())
+		{
+			String<MaxFilenameLength> name, location;
+			MakeRecordName(name.GetRef(), ioPath.c_str());
+			if (platform.MakeSysFileName(location.GetRef(), name.c_str()) && MassStorage::FileExists(location.c_str()))
+			{
+				MassStorage::SetLastModifiedTime(location.c_str(), platform.GetDateTime());
+			}
+		}
+	}
+}
+
+// Delete the least recently used records if there are more than we want to keep. Each call reads the record directory once and deletes up to
+// FileInfoCachePruneBatch records, so it may take several calls. The I/O mutex must be owned and the cache mutex must not be.
+/*static*/ void FileInfoCache::PruneRecords() noexcept
+{
+	struct Candidate
+	{
+		time_t lastModified;
+		String<StringLength20> name;
+	};
+
+	Candidate oldest[FileInfoCachePruneBatch];								// the oldest records we have found, oldest first
+	size_t numOldest = 0, numRecords = 0;
+	String<MaxFilenameLength> dir;
+	FileInfo fileInfo;
+	if (reprap.GetPlatform().MakeSysFileName(dir.GetRef(), FILE_INFO_CACHE_DIR) && MassStorage::FindFirst(dir.c_str(), fileInfo))
+	{
+		do
+		{
+			if (fileInfo.isDirectory || fileInfo.fileName.strlen() >= StringLength20)
+			{
+				continue;													// not one of our records
+			}
+			++numRecords;
+			size_t i;
+			if (numOldest < FileInfoCachePruneBatch)
+			{
+				i = numOldest++;
+			}
+			else if (fileInfo.lastModified < oldest[FileInfoCachePruneBatch - 1].lastModified)
+			{
+				i = FileInfoCachePruneBatch - 1;
+			}
+			else
+			{
+				continue;
+			}
+			while (i != 0 && oldest[i - 1].lastModified > fileInfo.lastModified)
+			{
+				oldest[i] = oldest[i - 1];
+				--i;
+			}
+			oldest[i].lastModified = fileInfo.lastModified;
+			oldest[i].name.copy(fileInfo.fileName.c_str());
+		} while (MassStorage::FindNext(fileInfo));
+	}
+
+	const size_t numToDelete = (numRecords > FileInfoCacheMaxRecords) ? min<size_t>(numRecords - FileInfoCacheMaxRecords, numOldest) : 0;
+	for (size_t i = 0; i < numToDelete; ++i)
+	{
+		String<MaxFilenameLength> name;
+		name.printf(FILE_INFO_CACHE_DIR "/%s", oldest[i].name.c_str());
+		reprap.GetPlatform().DeleteSysFile(name.c_str());
+	}
+	pruneNeeded = (numRecords - numToDelete > FileInfoCacheMaxRecords);
+}
+
+// Write new entries to the card if there are any and there haven't been more for a while, else delete old records if there are too many.
+// Don't do either while printing, so that we don't hold up the file being printed.
+void FileInfoCache::Spin() noexcept
+{
+	if (reprap.GetPrintMonitor().IsPrinting())
+	{
+		return;
+	}
+
+	if (changed)
+	{
+		if (millis() - whenChanged >= FileInfoCacheSaveDelay)
+		{
+			MutexLocker ioLock(ioMutex);
+			SaveEntries();
+		}
+	}
+	else if (pruneNeeded)
+	{
+		MutexLocker ioLock(ioMutex);
+		PruneRecords();
+	}
+}
+
+// Return the entry in RAM for a key, or nullptr if there isn't one. The cache mutex must be owned.
+/*static*/ FileInfoCache::Entry *FileInfoCache::FindEntry(const char *key) noexcept
+{
+	for (Entry& e : entries)
+	{
+		if (e.lastUsed != 0 && StringEqualsIgnoreCase(e.path.c_str(), key))
+		{
+			return &e;
+		}
+	}
+	return nullptr;
+}
+
+// Put an entry in RAM, replacing any entry for the same key or else the least recently used one. If we replace a different entry that hasn't been
+// written to the card yet, copy it to ioPath and ioInfo and return true so that the caller writes it after releasing the cache mutex.
+// Both mutexes must be owned.
+/*static*/ bool FileInfoCache::Insert(const char *key, const GCodeFileInfo& info, bool dirty) noexcept
+{
+	Entry *slot = &entries[0];
+	bool sameKey = false;
+	for (Entry& e : entries)
+	{
+		if (e.lastUsed != 0 && StringEqualsIgnoreCase(e.path.c_str(), key))
+		{
+			slot = &e;
+			sameKey = true;
+			break;
+		}
+		if (e.lastUsed < slot->lastUsed)
+		{
+			slot = &e;
+		}
+	}
+
+	const bool mustWrite = !sameKey && slot->lastUsed != 0 && slot->dirty;
+	if (mustWrite)
+	{
+		ioPath.copy(slot->path.c_str());
+		ioInfo = slot->info;
+	}
+
+	slot->path.copy(key);
+	slot->info = info;
+	slot->lastUsed = ++useCount;
+	slot->dirty = dirty || (sameKey && slot->dirty);
+	slot->touched = !slot->dirty;
+	changed = true;
+	whenChanged = millis();
+	return mustWrite;
+}
+
+// Look up the information for a file, first in RAM and then on the card. Return true and copy it to 'info' if we have it and it is for the same size
+// and last modified time.
+bool FileInfoCache::Find(const char *filePath, FilePosition fileSize, time_t lastModified, GCodeFileInfo& info) noexcept
+{
+	const char * const key = MassStorage::CacheKey(filePath);
+	{
+		MutexLocker lock(cacheMutex);
+		Entry * const e = FindEntry(key);
+		if (e != nullptr)
+		{
+			if (e->info.fileSize != fileSize || e->info.lastModifiedTime != lastModified)
+			{
+				++numMisses;										// the file has changed, so the entry on the card is out of date too
+				return false;
+			}
+			e->lastUsed = ++useCount;
+			if (!e->dirty && !e->touched)
+			{
+				e->touched = true;
+				changed = true;
+				whenChanged = millis();
+			}
+			info = e->info;
+			++numHits;
+			return true;
+		}
+	}
+
+	MutexLocker ioLock(ioMutex);
+	if (ReadRecord(key) && ioInfo.fileSize == fileSize && ioInfo.lastModifiedTime == lastModified && StringEqualsIgnoreCase(ioPath.c_str(), key))
+	{
+		info = ioInfo;
+		++numCardHits;
+		bool mustWrite;
+		{
+			MutexLocker lock(cacheMutex);
+			mustWrite = Insert(key, info, false);
+		}
+		if (mustWrite)
+		{
+			WriteRecord();
+		}
+		return true;
+	}
+	++numMisses;
+	return false;
+}
+
+// Store the complete information for a file. It is written to the card later.
+void FileInfoCache::Store(const char *filePath, const GCodeFileInfo& info) noexcept
+{
+	const char * const key = MassStorage::CacheKey(filePath);
+	MutexLocker ioLock(ioMutex);
+	bool mustWrite;
+	{
+		MutexLocker lock(cacheMutex);
+		mustWrite = Insert(key, info, true);
+	}
+	if (mustWrite)
+	{
+		WriteRecord();
+	}
+}
+
+// Forget everything in RAM, including files waiting to be parsed. Called when a card is unmounted, so we can't write new entries to it first.
+void FileInfoCache::Clear() noexcept
+{
+	MutexLocker lock(cacheMutex);
+	for (Entry& e : entries)
+	{
+		e.lastUsed = 0;
+		e.dirty = false;
+		e.touched = false;
+	}
+	useCount = 0;
+	queueCount = 0;
+	changed = false;
+}
+
+// Forget a file that has been deleted, and delete its record
+void FileInfoCache::Forget(const char *filePath) noexcept
+{
+	const char * const key = MassStorage::CacheKey(filePath);
+	MutexLocker ioLock(ioMutex);
+	{
+		MutexLocker lock(cacheMutex);
+		Entry * const e = FindEntry(key);
+		if (e != nullptr)
+		{
+			e->lastUsed = 0;
+			e->dirty = e->touched = false;
+		}
+	}
+	(void)DeleteRecord(key);
+}
+
+// Move the entry and record for a file that has been renamed. Renaming a file doesn't change its size or last modified time, so the information is still valid.
+void FileInfoCache::Rename(const char *oldPath, const char *newPath) noexcept
+{
+	if (!MassStorage::IsGCodeFileName(newPath))
+	{
+		Forget(oldPath);
+		return;
+	}
+
+	const char * const oldKey = MassStorage::CacheKey(oldPath);
+	const char * const newKey = MassStorage::CacheKey(newPath);
+	MutexLocker ioLock(ioMutex);
+	bool inRam = false;
+	{
+		MutexLocker lock(cacheMutex);
+		Entry * const e = FindEntry(oldKey);
+		if (e != nullptr)
+		{
+			e->path.copy(newKey);											// it gets written under the new name later
+			e->dirty = true;
+			e->touched = false;
+			changed = true;
+			whenChanged = millis();
+			inRam = true;
+		}
+	}
+
+	// Delete the old record before writing the new one, because they have the same name if only the case of the path changed
+	if (DeleteRecord(oldKey) && !inRam)
+	{
+		ioPath.copy(newKey);
+		WriteRecord();
+		pruneNeeded = true;
+	}
+}
+
+// Add a file to the queue of files to parse in the background, unless it is already there. If the queue is full then the oldest request is dropped.
+void FileInfoCache::QueueParse(const char *filePath) noexcept
+{
+	MutexLocker lock(cacheMutex);
+	for (size_t i = 0; i < queueCount; ++i)
+	{
+		if (StringEqualsIgnoreCase(queue[(queueHead + i) % FileInfoParseQueueLength].c_str(), filePath))
+		{
+			return;
+		}
+	}
+
+	if (queueCount == FileInfoParseQueueLength)
+	{
+		queueHead = (queueHead + 1) % FileInfoParseQueueLength;
+		--queueCount;
+	}
+	queue[(queueHead + queueCount) % FileInfoParseQueueLength].copy(filePath);
+	++queueCount;
+}
+
+bool FileInfoCache::GetQueuedFile(const StringRef& filePath) noexcept
+{
+	MutexLocker lock(cacheMutex);
+	if (queueCount == 0)
+	{
+		return false;
+	}
+	filePath.copy(queue[queueHead].c_str());
+	queueHead = (queueHead + 1) % FileInfoParseQueueLength;
+	--queueCount;
+	return true;
+}
+
+void FileInfoCache::Diagnostics(MessageType mtype) noexcept
+{
+	size_t numEntries = 0;
+	for (const Entry& e : entries)
+	{
+		if (e.lastUsed != 0)
+		{
+			++numEntries;
+		}
+	}
+	reprap.GetPlatform().MessageF(mtype, "File info cache: %u of %u entries in RAM, %u hits in RAM, %u on card, %u misses, %u files queued\n",
+									numEntries, FileInfoCacheEntries, numHits, numCardHits, numMisses, queueCount);
+	numHits = numCardHits = numMisses = 0;
+}
+
+#endif
+
+// End
@@ -0,0 +1,87 @@
+/*
+ * FileInfoCache.h
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#ifndef SRC_STORAGE_FILEINFOCACHE_H_
+#define SRC_STORAGE_FILEINFOCACHE_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_FILE_INFO_CACHE
+
+#include <GCodes/GCodeFileInfo.h>
+
+// Cache of the information parsed from G-code files, so that the file browser doesn't make the firmware parse the same files every time it is opened.
+// Entries are keyed by path, file size and last modified time, so an entry for a file that has been changed in any way that matters is never used,
+// even if the card was changed on a PC. Every entry is kept on the card as a small file in a subdirectory of the system directory, named from a
+// hash of the path, so the number of files we can remember is not limited by RAM. The most recently used entries are also held in RAM, and new
+// entries are written to the card a few seconds after the last one was added unless we are printing, or straight away if one has to make room in RAM.
+// Records are deleted or moved when their files are deleted or renamed, and when there are more than FileInfoCacheMaxRecords the least recently used
+// ones are deleted while we are idle. Records orphaned in other ways, e.g. by renaming a directory, are removed in the same way eventually.
+// It also holds a short queue of files to parse in the background, such as files that have just been uploaded.
+// We never access the card while owning the cache mutex, because the card is unmounted while owning the file system mutexes and that calls Clear.
+class FileInfoCache
+{
+public:
+	static void Init() noexcept;
+	static void Spin() noexcept;											// write new entries to the card and delete old ones
+
+	static bool Find(const char *filePath, FilePosition fileSize, time_t lastModified, GCodeFileInfo& info) noexcept;
+	static void Store(const char *filePath, const GCodeFileInfo& info) noexcept;	// store information that is complete
+	static void Clear() noexcept;											// called when a card is unmounted
+	static void Forget(const char *filePath) noexcept;						// called when a file has been deleted
+	static void Rename(const char *oldPath, const char *newPath) noexcept;	// called when a file has been renamed
+
+	static void QueueParse(const char *filePath) noexcept;					// ask for a file to be parsed in the background
+	static bool GetQueuedFile(const StringRef& filePath) noexcept;			// get and remove the next file to parse in the background
+
+	static void Diagnostics(MessageType mtype) noexcept;
+
+private:
+	FileInfoCache() = delete;
+
+	struct Entry
+	{
+		String<MaxFilenameLength> path;										// without the volume number if it is 0
+		GCodeFileInfo info;
+		uint32_t lastUsed;													// the value of useCount when the entry was last used, 0 if the entry is free
+		bool dirty;															// true if the entry hasn't been written to the card yet
+		bool touched;														// true if the entry has been used since its record was last written or touched
+	};
+
+	// Header of each file we save an entry in. The path and information are saved as they are in memory, so if anything changes their size then the file is ignored.
+	struct RecordHeader
+	{
+		uint32_t magic;
+		uint32_t pathSize;
+		uint32_t infoSize;
+	};
+
+	static constexpr uint32_t RecordMagic = 0x43494652;						// "RFIC" (RepRapFirmware file info cache) in little-endian order
+
+	static void MakeRecordName(const StringRef& name, const char *key) noexcept;
+	static Entry *FindEntry(const char *key) noexcept;
+	static bool Insert(const char *key, const GCodeFileInfo& info, bool dirty) noexcept;
+	static bool ReadRecord(const char *key) noexcept;
+	static void WriteRecord() noexcept;
+	static bool DeleteRecord(const char *key) noexcept;
+	static void SaveEntries() noexcept;
+	static void PruneRecords() noexcept;
+
+	static Entry entries[FileInfoCacheEntries];
+	static String<MaxFilenameLength> ioPath;								// the entry being read from or written to the card, protected by the I/O mutex
+	static GCodeFileInfo ioInfo;
+	static String<MaxFilenameLength> queue[FileInfoParseQueueLength];
+	static size_t queueHead, queueCount;
+	static uint32_t useCount;
+	static uint32_t whenChanged;
+	static bool changed;													// true if any entry is dirty or touched
+	static bool pruneNeeded;												// true if there may be more records on the card than we want to keep
+	static unsigned int numHits, numCardHits, numMisses;
+};
+
+#endif
+
+#endif /* SRC_STORAGE_FILEINFOCACHE_H_ */
@@ -11,11 +11,94 @@
 #include "Platform.h"
 #include "PrintMonitor.h"
 #include "GCodes/GCodes.h"
+#include "FileInfoCache.h"
 
 #if HAS_MASS_STORAGE
 
+// Keywords in the comments that slicers write, which ScanKeywords finds in a single pass over each buffer. The finders for each item of
+// file information try their keywords in the order listed, so if a keyword is a leading or embedded substring of another, the longer one must come first.
+static constexpr const char *Keywords[] =
+{
+	// Layer height
+	"layer_height",								// slic3r
+	"Layer height",								// Cura
+	"layerHeight",								// S3D
+	"layer_thickness_mm",						// Kisslicer
+	"layerThickness",							// Matter Control
+
+	// Slicer
+	"generated by ",							// slic3r and S3D
+	";Sliced by ",								// ideaMaker
+	"; KISSlicer",								// KISSlicer
+	";Sliced at: ",								// Cura (old)
+	";Generated with ",							// Cura (new)
+
+	// Filament used
+	"ilament used",								// slic3r and Cura, followed by filament used and "mm"
+	";Material#",								// Ideamaker, e.g. ";Material#1 Used: 868.0"
+	"ilament length",							// S3D
+	";    Ext ",								// recent KISSlicer versions
+	"; Estimated Build Volume: ",				// old KISSlicer
+
+	// Print time
+	" estimated printing time (normal mode)",	// slic3r PE later versions	"; estimated printing time (normal mode) = 1h 5m 24s"
+	" estimated printing time",					// slic3r PE older versions	"; estimated printing time = 1h 5m 24s"
+	";TIME",									// Cura						";TIME:38846"
+	" Build time",								// S3D						";   Build time: 0 hours 42 minutes"
+	" Build Time",								// KISSlicer				"; Estimated Build Time:   332.83 minutes"
+												// also KISSSlicer 2 alpha	"; Calculated-during-export Build Time: 130.62 minutes"
+	// Simulated time
+	FileInfoParser::SimulatedTimeString
+};
+
+static_assert(ARRAY_SIZE(Keywords) == NumFileInfoKeywords && ARRAY_SIZE(Keywords) <= 32);
+
+constexpr size_t FirstLayerHeightKeyword = 0, NumLayerHeightKeywords = 5;
+constexpr size_t FirstSlicerKeyword = 5, NumSlicerKeywords = 5;
+constexpr size_t FilamentUsedKeyword = 10, IdeamakerMaterialKeyword = 11, FilamentLengthKeyword = 12, KisslicerExtKeyword = 13, BuildVolumeKeyword = 14;
+constexpr size_t FirstPrintTimeKeyword = 15, NumPrintTimeKeywords = 5;
+constexpr size_t SimulatedTimeKeyword = 20;
+
+constexpr uint32_t KeywordBits(size_t first, size_t num) noexcept { return ((1u << num) - 1) << first; }
+
+constexpr uint32_t LayerHeightKeywords = KeywordBits(FirstLayerHeightKeyword, NumLayerHeightKeywords);
+constexpr uint32_t SlicerKeywords = KeywordBits(FirstSlicerKeyword, NumSlicerKeywords);
+constexpr uint32_t FilamentKeywords = KeywordBits(FilamentUsedKeyword, 5);
+constexpr uint32_t PrintTimeKeywords = KeywordBits(FirstPrintTimeKeyword, NumPrintTimeKeywords);
+constexpr uint32_t SimulatedTimeKeywords = KeywordBits(SimulatedTimeKeyword, 1);
+
+// Tables of the keywords that start with each pair of characters, so that ScanKeywords rarely needs to compare strings. They are built by the compiler.
+struct KeywordFilter
+{
+	uint32_t firstChar[256];
+	uint32_t secondChar[256];
+	uint8_t lengths[ARRAY_SIZE(Keywords)];
+};
+
+static constexpr KeywordFilter MakeKeywordFilter() noexcept
+{
+	KeywordFilter f{};
+	for (size_t i = 0; i < ARRAY_SIZE(Keywords); ++i)
+	{
+		f.firstChar[(uint8_t)Keywords[i][0]] |= 1u << i;
+		f.secondChar[(uint8_t)Keywords[i][1]] |= 1u << i;
+		size_t len = 0;
+		while (Keywords[i][len] != 0)
+		{
+			++len;
+		}
+		f.lengths[i] = len;
+	}
+	return f;
+}
+
+static constexpr KeywordFilter keywordFilter = MakeKeywordFilter();
+
 FileInfoParser::FileInfoParser() noexcept
 	: parseState(notParsing), fileBeingParsed(nullptr), accumulatedParseTime(0), accumulatedReadTime(0), accumulatedSeekTime(0), fileOverlapLength(0)
+#if SUPPORT_FILE_INFO_CACHE
+	  , parsingInBackground(false)
+#endif
 {
 	parsedFileInfo.Init();
 	parserMutex.Create("FileInfoParser");
@@ -30,6 +113,58 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 		return GCodeResult::notFinished;
 	}
 
+#if SUPPORT_FILE_INFO_CACHE
+	if (parsingInBackground)
+	{
+		if (parseState != notParsing && !StringEqualsIgnoreCase(filePath, filenameBeingParsed.c_str()))
+		{
+			// Someone is waiting for this file, so put the background parse back in the queue to finish later
+			FileInfoCache::QueueParse(filenameBeingParsed.c_str());
+			fileBeingParsed->Close();
+			parseState = notParsing;
+		}
+		parsingInBackground = false;
+	}
+#endif
+
+	return ContinueParsing(filePath, info, quitEarly, MAX_FILEINFO_PROCESS_TIME);
+}
+
+#if SUPPORT_FILE_INFO_CACHE
+
+// Do some work on the next file queued for parsing, unless the parser is busy with a request from a client
+void FileInfoParser::Spin() noexcept
+{
+	MutexLocker lock(parserMutex, 0);
+	if (!lock || (parseState != notParsing && !parsingInBackground))
+	{
+		return;
+	}
+
+	if (parseState == notParsing)
+	{
+		if (!FileInfoCache::GetQueuedFile(filenameBeingParsed.GetRef()))
+		{
+			return;
+		}
+		parsingInBackground = true;
+	}
+
+	// Copy the file name because ContinueParsing may overwrite filenameBeingParsed
+	String<MaxFilenameLength> filePath;
+	filePath.copy(filenameBeingParsed.c_str());
+	GCodeFileInfo info;
+	if (ContinueParsing(filePath.c_str(), info, false, MaxBackgroundParseTime) != GCodeResult::notFinished)
+	{
+		parsingInBackground = false;
+	}
+}
+
+#endif
+
+// Start or continue parsing a file. The mutex must be owned.
+GCodeResult FileInfoParser::ContinueParsing(const char *filePath, GCodeFileInfo& info, bool quitEarly, uint32_t maxProcessTime) noexcept
+{
 	if (parseState != notParsing && !StringEqualsIgnoreCase(filePath, filenameBeingParsed.c_str()))
 	{
 		// We are already parsing a different file
@@ -71,6 +206,15 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 		parsedFileInfo.lastModifiedTime = MassStorage::GetLastModifiedTime(filePath);
 		parsedFileInfo.isValid = true;
 
+#if SUPPORT_FILE_INFO_CACHE
+		// See if we have parsed this file before
+		if (FileInfoCache::Find(filePath, parsedFileInfo.fileSize, parsedFileInfo.lastModifiedTime, info))
+		{
+			fileBeingParsed->Close();
+			return GCodeResult::ok;
+		}
+#endif
+
 		// Record some debug values here
 		if (reprap.Debug(modulePrintMonitor))
 		{
@@ -130,6 +274,13 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 				accumulatedReadTime += now - startTime;
 				startTime = now;
 
+				// Find the slicer comments for the information we still need, in a single pass
+				ScanKeywords(buf, sizeToScan,
+								  ((parsedFileInfo.numFilaments == 0) ? FilamentKeywords : 0)
+								| ((parsedFileInfo.layerHeight == 0.0) ? LayerHeightKeywords : 0)
+								| ((parsedFileInfo.generatedBy.IsEmpty()) ? SlicerKeywords : 0)
+								| ((parsedFileInfo.printTime == 0) ? PrintTimeKeywords : 0));
+
 				// Search for filament usage (Cura puts it at the beginning of a G-code file)
 				if (parsedFileInfo.numFilaments == 0)
 				{
@@ -258,6 +409,13 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 
 				bool footerInfoComplete = true;
 
+				// Find the slicer comments for the information we still need, in a single pass
+				ScanKeywords(buf, sizeToScan,
+								  ((parsedFileInfo.numFilaments == 0) ? FilamentKeywords : 0)
+								| ((parsedFileInfo.layerHeight == 0.0) ? LayerHeightKeywords : 0)
+								| ((parsedFileInfo.printTime == 0) ? PrintTimeKeywords : 0)
+								| ((parsedFileInfo.simulatedTime == 0) ? SimulatedTimeKeywords : 0));
+
 				// Search for filament used
 				if (parsedFileInfo.numFilaments == 0)
 				{
@@ -319,6 +477,9 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 					parseState = notParsing;
 					fileBeingParsed->Close();
 					parsedFileInfo.incomplete = false;
+#if SUPPORT_FILE_INFO_CACHE
+					FileInfoCache::Store(filenameBeingParsed.c_str(), parsedFileInfo);
+#endif
 					info = parsedFileInfo;
 					return GCodeResult::ok;
 				}
@@ -338,7 +499,7 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 			return GCodeResult::ok;
 		}
 		lastFileParseTime = millis();
-	} while (!reprap.GetPrintMonitor().IsPrinting() && lastFileParseTime - loopStartTime < MAX_FILEINFO_PROCESS_TIME);
+	} while (!reprap.GetPrintMonitor().IsPrinting() && lastFileParseTime - loopStartTime < maxProcessTime);
 
 	if (quitEarly)
 	{
@@ -350,6 +511,32 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 	return GCodeResult::notFinished;
 }
 
+// Find the first occurrence in the buffer of each of the wanted keywords, in a single pass. The buffer is null-terminated.
+// This replaces a strstr call per keyword, each of which read the whole buffer. Each character pair is looked up in tables that say which keywords
+// start with those characters, so we only need to compare strings where a keyword is likely to be.
+void FileInfoParser::ScanKeywords(const char *bufp, size_t len, uint32_t wanted) noexcept
+{
+	for (const char *& pos : keywordPositions)
+	{
+		pos = nullptr;
+	}
+
+	for (size_t i = 0; wanted != 0 && i + 1 < len; ++i)
+	{
+		uint32_t candidates = keywordFilter.firstChar[(uint8_t)bufp[i]] & keywordFilter.secondChar[(uint8_t)bufp[i + 1]] & wanted;
+		while (candidates != 0)
+		{
+			const unsigned int k = LowestSetBit(candidates);
+			candidates &= ~(1u << k);
+			if (i + keywordFilter.lengths[k] <= len && memcmp(bufp + i, Keywords[k], keywordFilter.lengths[k]) == 0)
+			{
+				keywordPositions[k] = bufp + i;
+				wanted &= ~(1u << k);							// we only need the first occurrence
+			}
+		}
+	}
+}
+
 // Scan the buffer for a G1 Zxxx command. The buffer is null-terminated.
 bool FileInfoParser::FindFirstLayerHeight(const char* bufp, size_t len) noexcept
 {
@@ -528,108 +715,78 @@ bool FileInfoParser::FindHeight(const char* bufp, size_t len) noexcept
 	return foundHeight;
 }
 
-// Scan the buffer for the layer height. The buffer is null-terminated.
+// Scan the buffer for the layer height. The buffer is null-terminated. ScanKeywords must have been called.
 bool FileInfoParser::FindLayerHeight(const char *bufp, size_t len) noexcept
 {
-	static const char* const layerHeightStrings[] =
-	{
-		"layer_height",			// slic3r
-		"Layer height",			// Cura
-		"layerHeight",			// S3D
-		"layer_thickness_mm",	// Kisslicer
-		"layerThickness"		// Matter Control
-	};
-
-	if (*bufp != 0)
+	for (size_t k = FirstLayerHeightKeyword; k < FirstLayerHeightKeyword + NumLayerHeightKeywords; ++k)	// search for each string in turn
 	{
-		++bufp;														// make sure we can look back 1 character after we find a match
-		for (const char * lhStr : layerHeightStrings)				// search for each string in turn
+		const char *pos = keywordPositions[k];
+		if (pos == bufp)
 		{
-			const char *pos = bufp;
-			for(;;)													// loop until success or strstr returns null
+			pos = strstr(pos + 1, Keywords[k]);						// make sure we can look back 1 character after we find a match
+		}
+		while (pos != nullptr)										// loop until success or strstr returns null
+		{
+			const char c = pos[-1];									// fetch the previous character
+			pos += keywordFilter.lengths[k];						// skip the string we matched
+			if (c == ' ' || c == ';' || c == '\t')					// check we are not in the middle of a word
 			{
-				pos = strstr(pos, lhStr);
-				if (pos == nullptr)
+				while (strchr(" \t=:,", *pos) != nullptr)			// skip the possible separators
 				{
-					break;											// didn't find this string in the buffer, so try the next string
+					++pos;
 				}
-
-				const char c = pos[-1];								// fetch the previous character
-				pos += strlen(lhStr);				// skip the string we matched
-				if (c == ' ' || c == ';' || c == '\t')				// check we are not in the middle of a word
+				const char *tailPtr;
+				const float val = SafeStrtof(pos, &tailPtr);
+				if (tailPtr != pos && !std::isnan(val) && !std::isinf(val))	// if we found and converted a number
 				{
-					while (strchr(" \t=:,", *pos) != nullptr)		// skip the possible separators
-					{
-						++pos;
-					}
-					const char *tailPtr;
-					const float val = SafeStrtof(pos, &tailPtr);
-					if (tailPtr != pos && !std::isnan(val) && !std::isinf(val))	// if we found and converted a number
-					{
-						parsedFileInfo.layerHeight = val;
-						return true;
-					}
+					parsedFileInfo.layerHeight = val;
+					return true;
 				}
 			}
+			pos = strstr(pos, Keywords[k]);
 		}
 	}
 
 	return false;
 }
 
+// Scan the buffer for the slicer name and version. ScanKeywords must have been called.
 bool FileInfoParser::FindSlicerInfo(const char* bufp, size_t len) noexcept
 {
-	static const char * const GeneratedByStrings[] =
-	{
-		"generated by ",	// slic3r and S3D
-		";Sliced by ",		// ideaMaker
-		"; KISSlicer",		// KISSlicer
-		";Sliced at: ",		// Cura (old)
-		";Generated with "	// Cura (new)
-	};
-
-	size_t index = 0;
-	const char* pos;
-	do
+	for (size_t index = 0; index < NumSlicerKeywords; ++index)
 	{
-		pos = strstr(bufp, GeneratedByStrings[index]);
+		const char *pos = keywordPositions[FirstSlicerKeyword + index];
 		if (pos != nullptr)
 		{
-			break;
-		}
-		++index;
-	} while (index < ARRAY_SIZE(GeneratedByStrings));
-
-	if (pos != nullptr)
-	{
-		const char* introString = "";
-		switch (index)
-		{
-		default:
-			pos += strlen(GeneratedByStrings[index]);
-			break;
-
-		case 2:		// KISSlicer
-			pos += 2;
-			break;
-
-		case 3:		// Cura (old)
-			introString = "Cura at ";
-			pos += strlen(GeneratedByStrings[index]);
-			break;
-		}
+			const char* introString = "";
+			switch (index)
+			{
+			default:
+				pos += keywordFilter.lengths[FirstSlicerKeyword + index];
+				break;
+
+			case 2:		// KISSlicer
+				pos += 2;
+				break;
+
+			case 3:		// Cura (old)
+				introString = "Cura at ";
+				pos += keywordFilter.lengths[FirstSlicerKeyword + index];
+				break;
+			}
 
-		parsedFileInfo.generatedBy.copy(introString);
-		while (*pos >= ' ')
-		{
-			parsedFileInfo.generatedBy.cat(*pos++);
+			parsedFileInfo.generatedBy.copy(introString);
+			while (*pos >= ' ')
+			{
+				parsedFileInfo.generatedBy.cat(*pos++);
+			}
+			return true;
 		}
-		return true;
 	}
 	return false;
 }
 
-// Scan the buffer for the filament used. The buffer is null-terminated.
+// Scan the buffer for the filament used. The buffer is null-terminated. ScanKeywords must have been called.
 // Returns the number of filaments found.
 unsigned int FileInfoParser::FindFilamentUsed(const char* bufp, size_t len) noexcept
 {
@@ -637,11 +794,10 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* bufp, size_t len) noex
 	const size_t maxFilaments = reprap.GetGCodes().GetNumExtruders();
 
 	// Look for filament usage as generated by Slic3r and Cura
-	const char* const filamentUsedStr1 = "ilament used";			// comment string used by slic3r and Cura, followed by filament used and "mm"
-	const char* p = bufp;
-	while (filamentsFound < maxFilaments &&	(p = strstr(p, filamentUsedStr1)) != nullptr)
+	const char* p = keywordPositions[FilamentUsedKeyword];
+	while (filamentsFound < maxFilaments && p != nullptr)
 	{
-		p += strlen(filamentUsedStr1);
+		p += keywordFilter.lengths[FilamentUsedKeyword];
 		while(strchr(" [m]:=\t", *p) != nullptr)					// Prusa slicer now uses "; filament used [mm] = 4235.9"
 		{
 			++p;	// this allows for " = " from default slic3r comment and ": " from default Cura comment
@@ -673,14 +829,14 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* bufp, size_t len) noex
 				++p;
 			}
 		}
+		p = strstr(p, Keywords[FilamentUsedKeyword]);
 	}
 
 	// Look for filament usage string generated by Ideamaker
-	const char* const filamentUsedStr2 = ";Material#";			// comment string used by Ideamaker, e.g. ";Material#1 Used: 868.0"
-	p = bufp;
-	while (filamentsFound < maxFilaments &&	(p = strstr(p, filamentUsedStr2)) != nullptr)
+	p = keywordPositions[IdeamakerMaterialKeyword];
+	while (filamentsFound < maxFilaments && p != nullptr)
 	{
-		p += strlen(filamentUsedStr2);
+		p += keywordFilter.lengths[IdeamakerMaterialKeyword];
 		const char *q;
 		uint32_t num = StrToU32(p, &q);
 		if (q != p && num < maxFilaments)
@@ -700,16 +856,16 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* bufp, size_t len) noex
 				}
 			}
 		}
+		p = strstr(p, Keywords[IdeamakerMaterialKeyword]);
 	}
 
 	// Look for filament usage as generated by S3D
 	if (filamentsFound == 0)
 	{
-		const char *filamentLengthStr = "ilament length";	// comment string used by S3D
-		p = bufp;
-		while (filamentsFound < maxFilaments &&	(p = strstr(p, filamentLengthStr)) != nullptr)
+		p = keywordPositions[FilamentLengthKeyword];
+		while (filamentsFound < maxFilaments && p != nullptr)
 		{
-			p += strlen(filamentLengthStr);
+			p += keywordFilter.lengths[FilamentLengthKeyword];
 			while(strchr(" :=\t", *p) != nullptr)
 			{
 				++p;
@@ -723,17 +879,17 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* bufp, size_t len) noex
 					++filamentsFound;
 				}
 			}
+			p = strstr(p, Keywords[FilamentLengthKeyword]);
 		}
 	}
 
 	// Look for filament usage as generated by recent KISSlicer versions
 	if (filamentsFound == 0)
 	{
-		const char *filamentLengthStr = ";    Ext ";
-		p = bufp;
-		while (filamentsFound < maxFilaments && (p = strstr(p, filamentLengthStr)) != nullptr)
+		p = keywordPositions[KisslicerExtKeyword];
+		while (filamentsFound < maxFilaments && p != nullptr)
 		{
-			p += strlen(filamentLengthStr);
+			p += keywordFilter.lengths[KisslicerExtKeyword];
 			if (*p == '#')
 			{
 				++p;				// later KISSlicer versions add a # here
@@ -756,17 +912,17 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* bufp, size_t len) noex
 					++filamentsFound;
 				}
 			}
+			p = strstr(p, Keywords[KisslicerExtKeyword]);
 		}
 	}
 
 	// Special case: Old KISSlicer only generates the filament volume, so we need to calculate the length from it
 	if (filamentsFound == 0 && reprap.GetPlatform().GetFilamentWidth() > 0.0)
 	{
-		const char *filamentVolumeStr = "; Estimated Build Volume: ";
-		p = strstr(bufp, filamentVolumeStr);
+		p = keywordPositions[BuildVolumeKeyword];
 		if (p != nullptr)
 		{
-			const float filamentCMM = SafeStrtof(p + strlen(filamentVolumeStr), nullptr) * 1000.0;
+			const float filamentCMM = SafeStrtof(p + keywordFilter.lengths[BuildVolumeKeyword], nullptr) * 1000.0;
 			if (!std::isnan(filamentCMM) && !std::isinf(filamentCMM))
 			{
 				parsedFileInfo.filamentNeeded[filamentsFound++] = filamentCMM / (Pi * fsquare(reprap.GetPlatform().GetFilamentWidth() / 2.0));
@@ -777,26 +933,15 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* bufp, size_t len) noex
 	return filamentsFound;
 }
 
-// Scan the buffer for the estimated print time
+// Scan the buffer for the estimated print time. ScanKeywords must have been called.
 bool FileInfoParser::FindPrintTime(const char* bufp, size_t len) noexcept
 {
-	static const char* const PrintTimeStrings[] =
-	{
-		// Note: if a string in this table is a leading or embedded substring of another, the longer one must come first
-		" estimated printing time (normal mode)",	// slic3r PE later versions	"; estimated printing time (normal mode) = 1h 5m 24s"
-		" estimated printing time",					// slic3r PE older versions	"; estimated printing time = 1h 5m 24s"
-		";TIME",									// Cura						";TIME:38846"
-		" Build time",								// S3D						";   Build time: 0 hours 42 minutes"
-		" Build Time"								// KISSlicer				"; Estimated Build Time:   332.83 minutes"
-													// also KISSSlicer 2 alpha	"; Calculated-during-export Build Time: 130.62 minutes"
-	};
-
-	for (const char * ptStr : PrintTimeStrings)
+	for (size_t k = FirstPrintTimeKeyword; k < FirstPrintTimeKeyword + NumPrintTimeKeywords; ++k)
 	{
-		const char* pos = strstr(bufp, ptStr);
+		const char* pos = keywordPositions[k];
 		if (pos != nullptr)
 		{
-			pos += strlen(ptStr);
+			pos += keywordFilter.lengths[k];
 			while (strchr(" \t=:", *pos))
 			{
 				++pos;
@@ -856,13 +1001,13 @@ bool FileInfoParser::FindPrintTime(const char* bufp, size_t len) noexcept
 	return false;
 }
 
-// Scan the buffer for the simulated print time
+// Scan the buffer for the simulated print time. ScanKeywords must have been called.
 bool FileInfoParser::FindSimulatedTime(const char* bufp, size_t len) noexcept
 {
-	const char* pos = strstr(bufp, SimulatedTimeString);
+	const char* pos = keywordPositions[SimulatedTimeKeyword];
 	if (pos != nullptr)
 	{
-		pos += strlen(SimulatedTimeString);
+		pos += keywordFilter.lengths[SimulatedTimeKeyword];
 		while (strchr(" \t=:", *pos))
 		{
 			++pos;
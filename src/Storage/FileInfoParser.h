@@ -29,7 +29,10 @@ const size_t GcodeFooterPrintTimeSearchSize = 4096;	// How much of the end of th
 
 const size_t GCODE_OVERLAP_SIZE = 100;				// Size of the overlapping buffer for searching (must be a multiple of 4)
 
+const size_t NumFileInfoKeywords = 21;				// Number of slicer comment keywords we search for
+
 const uint32_t MAX_FILEINFO_PROCESS_TIME = 200;		// Maximum time to spend polling for file info in each call
+const uint32_t MaxBackgroundParseTime = 20;			// Maximum time to spend parsing a file in the background in each call
 const uint32_t MaxFileParseInterval = 4000;			// Maximum interval between repeat requests to parse a file
 
 enum FileParseState
@@ -48,11 +51,17 @@ public:
 	// The following method needs to be called repeatedly until it doesn't return GCodeResult::notFinished - this may take a few runs
 	GCodeResult GetFileInfo(const char *filePath, GCodeFileInfo& info, bool quitEarly) noexcept;
 
+#if SUPPORT_FILE_INFO_CACHE
+	void Spin() noexcept;							// parse files queued in the file info cache, a little at a time
+#endif
+
 	static constexpr const char* SimulatedTimeString = "\n; Simulated print time";	// used by FileInfoParser and MassStorage
 
 private:
+	GCodeResult ContinueParsing(const char *filePath, GCodeFileInfo& info, bool quitEarly, uint32_t maxProcessTime) noexcept;
 
 	// G-Code parser methods
+	void ScanKeywords(const char *bufp, size_t len, uint32_t wanted) noexcept;
 	bool FindHeight(const char* bufp, size_t len) noexcept;
 	bool FindFirstLayerHeight(const char* bufp, size_t len) noexcept;
 	bool FindLayerHeight(const char* bufp, size_t len) noexcept;
@@ -72,6 +81,10 @@ private:
 	uint32_t lastFileParseTime;
 	uint32_t accumulatedParseTime, accumulatedReadTime, accumulatedSeekTime;
 	size_t fileOverlapLength;
+	const char *keywordPositions[NumFileInfoKeywords];			// where ScanKeywords found each keyword first in the buffer, or nullptr
+#if SUPPORT_FILE_INFO_CACHE
+	bool parsingInBackground;						// true if nobody is waiting for the file we are parsing
+#endif
 
 	// We used to allocate the following buffer on the stack; but now that this is called by more than one task
 	// it is more economical to allocate it permanently because that lets us use smaller stacks.
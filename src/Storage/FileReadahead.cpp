@@ -0,0 +1,270 @@
+/*
+ * FileReadahead.cpp
+ *
+ *  Created on: 8 Oct 2020
+ *      Author: David
+ */
+
+#include "FileReadahead.h"
+
+#if SUPPORT_FILE_READAHEAD
+
+#include <Platform.h>
+#include <RepRap.h>
+#include <TaskPriorities.h>
+#include <RTOSIface/RTOSIface.h>
+
+constexpr uint32_t ReadaheadTaskStackWords = 400;					// must be large enough for a call to f_read and for FileStore::DirectRead to report an error
+
+static_assert(FileReadaheadBufferSize >= 2 * FileReadaheadChunkSize);
+
+static Task<ReadaheadTaskStackWords> *readaheadTask = nullptr;
+static Mutex fileMutex;												// protects the underlying file and 'pending', taken before the buffer mutex
+static Mutex readaheadMutex;										// protects the buffer variables
+
+FileStore * volatile FileReadahead::file = nullptr;
+char *FileReadahead::buffer = nullptr;
+FilePosition FileReadahead::filePos = 0;
+size_t FileReadahead::readIndex = 0;
+size_t FileReadahead::count = 0;
+size_t FileReadahead::history = 0;
+size_t FileReadahead::pending = 0;
+bool FileReadahead::endOfFile = false;
+bool FileReadahead::readError = false;
+unsigned int FileReadahead::numStalls = 0;
+
+extern "C" [[noreturn]] void ReadaheadTaskStart(void * pvParameters) noexcept
+{
+	FileReadahead::TaskLoop();
+}
+
+// Start reading a file ahead. This is called when we start printing a file from local storage.
+void FileReadahead::Attach(FileStore *f) noexcept
+{
+	if (readaheadTask == nullptr)
+	{
+		buffer = new char[FileReadaheadBufferSize];
+		fileMutex.Create("ReadaheadFile");
+		readaheadMutex.Create("Readahead");
+		readaheadTask = new Task<ReadaheadTaskStackWords>;
+		readaheadTask->Create(ReadaheadTaskStart, "READAHEAD", nullptr, TaskPriority::FileReadaheadPriority);
+	}
+
+	Detach(file);
+	{
+		MutexLocker fileLock(fileMutex);
+		MutexLocker lock(readaheadMutex);
+		readIndex = count = history = 0;
+		endOfFile = readError = false;
+		filePos = f->DirectPosition();
+		file = f;
+	}
+	WakeTask();
+}
+
+// Stop reading a file ahead. Leave the file positioned at the next byte that has not been consumed.
+void FileReadahead::Detach(const FileStore *f) noexcept
+{
+	if (f != nullptr && f == file)
+	{
+		MutexLocker fileLock(fileMutex);
+		MutexLocker lock(readaheadMutex);
+		if (count != 0)
+		{
+			(void)file->DirectSeek(filePos - count);
+		}
+		file = nullptr;
+		readIndex = count = history = 0;
+	}
+}
+
+// Copy data from the buffer. The buffer mutex must be owned and count must be nonzero.
+/*static*/ int FileReadahead::CopyFromBuffer(char *buf, size_t nBytes) noexcept
+{
+	// Copy as much data as we have, in up to two pieces because the buffer wraps round
+	const size_t bytesToCopy = min<size_t>(nBytes, count);
+	const size_t firstPart = min<size_t>(bytesToCopy, FileReadaheadBufferSize - readIndex);
+	memcpy(buf, buffer + readIndex, firstPart);
+	if (firstPart < bytesToCopy)
+	{
+		memcpy(buf + firstPart, buffer, bytesToCopy - firstPart);
+	}
+	readIndex = (readIndex + bytesToCopy) % FileReadaheadBufferSize;
+	count -= bytesToCopy;
+	history = min<size_t>(history + bytesToCopy, FileReadaheadBufferSize - count - pending);	// don't count space the readahead task is reading into
+	return (int)bytesToCopy;
+}
+
+// Read from the attached file. Called by FileStore::Read.
+int FileReadahead::Read(char *buf, size_t nBytes) noexcept
+{
+	int rslt = 0;
+	bool bufferEmpty = false;
+	{
+		MutexLocker lock(readaheadMutex);
+		if (count != 0)
+		{
+			rslt = CopyFromBuffer(buf, nBytes);
+		}
+		else if (readError)
+		{
+			return -1;
+		}
+		else if (endOfFile)
+		{
+			return 0;
+		}
+		else
+		{
+			bufferEmpty = true;
+		}
+	}
+
+	if (bufferEmpty)
+	{
+		// The buffer was empty, so wait for the file. The readahead task may have finished a read by the time we get it.
+		MutexLocker fileLock(fileMutex);
+		MutexLocker lock(readaheadMutex);
+		if (count != 0)
+		{
+			rslt = CopyFromBuffer(buf, nBytes);
+		}
+		else if (readError)
+		{
+			return -1;
+		}
+		else if (endOfFile)
+		{
+			return 0;
+		}
+		else
+		{
+			// The readahead task hasn't kept up, so read the data directly
+			++numStalls;
+			history = 0;											// the data we read won't be in the buffer
+			rslt = file->DirectRead(buf, nBytes);
+			if (rslt > 0)
+			{
+				filePos += (size_t)rslt;
+			}
+		}
+	}
+	WakeTask();
+	return rslt;
+}
+
+// Seek in the attached file. Called by FileStore::Seek.
+bool FileReadahead::Seek(FilePosition pos) noexcept
+{
+	{
+		MutexLocker lock(readaheadMutex);
+		const FilePosition currentPos = filePos - count;
+		if (pos <= currentPos && currentPos - pos <= history)
+		{
+			// Seeking back into data that has already been consumed and is still in the buffer
+			const size_t delta = currentPos - pos;
+			readIndex = (readIndex + FileReadaheadBufferSize - delta) % FileReadaheadBufferSize;
+			count += delta;
+			history -= delta;
+			return true;
+		}
+
+		if (pos > currentPos && pos - currentPos <= count)
+		{
+			// Seeking forwards within the data we have already read
+			const size_t delta = pos - currentPos;
+			readIndex = (readIndex + delta) % FileReadaheadBufferSize;
+			count -= delta;
+			history = min<size_t>(history + delta, FileReadaheadBufferSize - count - pending);
+			return true;
+		}
+	}
+
+	bool ok;
+	{
+		MutexLocker fileLock(fileMutex);
+		MutexLocker lock(readaheadMutex);
+		readIndex = count = history = 0;
+		endOfFile = readError = false;
+		ok = file->DirectSeek(pos);
+		filePos = file->DirectPosition();
+	}
+	WakeTask();
+	return ok;
+}
+
+// Return the position of the next byte to be consumed. Called by FileStore::Position.
+FilePosition FileReadahead::Position() noexcept
+{
+	MutexLocker lock(readaheadMutex);
+	return filePos - count;
+}
+
+void FileReadahead::WakeTask() noexcept
+{
+	if (FileReadaheadBufferSize - count >= FileReadaheadChunkSize)
+	{
+		readaheadTask->Give();
+	}
+}
+
+// Main loop of the readahead task. It sleeps until woken, then fills the buffer one chunk at a time.
+// We hold the file mutex for the whole of each read so that nothing else moves the file, but we release the buffer mutex while reading from
+// the card so that the consumer can take the data we already have. While we read, 'pending' stops the consumer counting the space we are
+// reading into as history that it can seek back into.
+void FileReadahead::TaskLoop() noexcept
+{
+	for (;;)
+	{
+		(void)TaskBase::Take();
+		for (;;)
+		{
+			MutexLocker fileLock(fileMutex);
+			size_t writeIndex;
+			{
+				MutexLocker lock(readaheadMutex);
+				if (file == nullptr || endOfFile || readError || FileReadaheadBufferSize - count < FileReadaheadChunkSize)
+				{
+					break;
+				}
+
+				// Read into the free space in the buffer up to the point where it wraps round. The consumer may take data meanwhile,
+				// but that doesn't move the end of the data, so writeIndex stays valid.
+				writeIndex = (readIndex + count) % FileReadaheadBufferSize;
+				pending = min<size_t>(FileReadaheadChunkSize, min<size_t>(FileReadaheadBufferSize - count, FileReadaheadBufferSize - writeIndex));
+				history = min<size_t>(history, FileReadaheadBufferSize - count - pending);		// we are about to overwrite some of the consumed data
+			}
+
+			const int bytesRead = file->DirectRead(buffer + writeIndex, pending);
+
+			MutexLocker lock(readaheadMutex);
+			pending = 0;
+			if (bytesRead < 0)
+			{
+				readError = true;
+			}
+			else if (bytesRead == 0)
+			{
+				endOfFile = true;
+			}
+			else
+			{
+				count += (size_t)bytesRead;
+				filePos += (size_t)bytesRead;
+			}
+		}
+	}
+}
+
+void FileReadahead::Diagnostics(MessageType mtype) noexcept
+{
+	if (readaheadTask != nullptr)
+	{
+		reprap.GetPlatform().MessageF(mtype, "File readahead %s, buffered %u, stalls %u\n", (file != nullptr) ? "active" : "idle", count, numStalls);
+		numStalls = 0;
+	}
+}
+
+#endif
+
+// End
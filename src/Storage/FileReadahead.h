@@ -0,0 +1,59 @@
+/*
+ * FileReadahead.h
+ *
+ *  Created on: 8 Oct 2020
+ *      Author: David
+ */
+
+#ifndef SRC_STORAGE_FILEREADAHEAD_H_
+#define SRC_STORAGE_FILEREADAHEAD_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_FILE_READAHEAD
+
+#include "FileStore.h"
+
+// Class to read the file being printed ahead of the G-code interpreter on a separate task, so that SD card latency overlaps with
+// command execution and motion planning instead of stalling them. Only one file at a time is read ahead.
+// While a file is attached, FileStore::Read, Seek and Position are routed through here, so the position seen by the rest of the
+// firmware is the position of the next byte to be consumed and pause/resume and the G-code file input buffer work as before.
+// Seeks back into data that has already been consumed, for example when a macro interrupts the file, are satisfied from the buffer.
+// The readahead task doesn't hold the buffer mutex while it reads from the card, so the consumer can take data that is already in the buffer
+// meanwhile. Anything that accesses the file itself holds the file mutex, which is always taken before the buffer mutex.
+class FileReadahead
+{
+public:
+	static void Attach(FileStore *f) noexcept;								// start reading this file ahead
+	static void Detach(const FileStore *f) noexcept;						// stop reading this file ahead if it is the one attached
+	static bool IsAttached(const FileStore *f) noexcept { return f == file; }
+
+	static int Read(char *buf, size_t nBytes) noexcept;
+	static bool Seek(FilePosition pos) noexcept;
+	static FilePosition Position() noexcept;
+
+	static void Diagnostics(MessageType mtype) noexcept;
+
+	[[noreturn]] static void TaskLoop() noexcept;
+
+private:
+	FileReadahead() = delete;
+
+	static void WakeTask() noexcept;
+	static int CopyFromBuffer(char *buf, size_t nBytes) noexcept;
+
+	static FileStore * volatile file;										// the file being read ahead, or null
+	static char *buffer;													// ring buffer, allocated when first needed
+	static FilePosition filePos;											// the file position of the byte after the last one read ahead
+	static size_t readIndex;												// index of the next byte to be consumed
+	static size_t count;													// number of bytes read ahead and not yet consumed
+	static size_t history;													// number of consumed bytes before readIndex that are still in the buffer
+	static size_t pending;													// number of bytes after the data that the readahead task is reading into
+	static bool endOfFile;
+	static bool readError;
+	static unsigned int numStalls;											// number of times the consumer found the buffer empty
+};
+
+#endif
+
+#endif /* SRC_STORAGE_FILEREADAHEAD_H_ */
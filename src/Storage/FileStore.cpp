@@ -15,6 +15,17 @@
 # include "Movement/StepTimer.h"
 #endif
 
+#if SUPPORT_FILE_READAHEAD
+# include "FileReadahead.h"
+#endif
+#if SUPPORT_FILE_WRITE_BEHIND
+# include "FileWriteBehind.h"
+#endif
+
+#if SUPPORT_MACRO_CACHE
+# include "MacroCache.h"
+#endif
+
 #if HAS_LINUX_INTERFACE
 # include "Linux/LinuxInterface.h"
 #endif
@@ -48,6 +59,9 @@ void FileStore::Init() noexcept
 	openCount = 0;
 	closeRequested = false;
 #endif
+#if SUPPORT_MACRO_CACHE
+	cacheEntry = nullptr;
+#endif
 }
 
 // Open a local file (for example on an SD card).
@@ -125,7 +139,7 @@ bool FileStore::Open(const char* filePath, OpenMode mode, uint32_t preAllocSize)
 		calcCrc = (mode == OpenMode::writeWithCrc);
 		usageMode = (writing) ? FileUseMode::readWrite : FileUseMode::readOnly;
 		openCount = 1;
-# if __LPC17xx__
+# if __LPC17xx__ || SUPPORT_FILE_WRITE_BEHIND
 		if (preAllocSize != 0 && (mode == OpenMode::write || mode == OpenMode::writeWithCrc))
 		{
 			const FRESULT expandReturn = f_expand(&file, preAllocSize, 1);		// try to pre-allocate contiguous space - it doesn't matter if it fails
@@ -143,6 +157,42 @@ bool FileStore::Open(const char* filePath, OpenMode mode, uint32_t preAllocSize)
 # endif
 }
 
+#if SUPPORT_MACRO_CACHE
+
+// Open a file for reading. If it is in the macro cache then read it from there, else open it on the card. The caller may then load it into the cache.
+// The file system mutex must be owned.
+bool FileStore::OpenCached(const char* filePath) noexcept
+{
+	MacroCacheEntry * const e = MacroCache::Find(filePath);
+	if (e == nullptr)
+	{
+		cacheEntry = nullptr;
+		return Open(filePath, OpenMode::read, 0);
+	}
+
+	file.obj.fs = nullptr;										// there is no file on the card to close
+	UseCacheEntry(e);
+	return true;
+}
+
+// Stop reading the file from the card and read the macro cache entry instead. The file system mutex must be owned.
+void FileStore::UseCacheEntry(MacroCacheEntry *e) noexcept
+{
+	if (file.obj.fs != nullptr)
+	{
+		(void)f_close(&file);
+	}
+	file.obj.fs = nullptr;										// so that this file doesn't get invalidated if the card is unmounted
+	writeBuffer = nullptr;
+	calcCrc = false;
+	cacheEntry = e;
+	cacheOffset = 0;
+	usageMode = FileUseMode::readOnly;
+	openCount = 1;
+}
+
+#endif
+
 // This may be called from an ISR, in which case we need to defer the close
 bool FileStore::Close() noexcept
 {
@@ -233,7 +283,24 @@ bool FileStore::Seek(FilePosition pos) noexcept
 		}
 #endif
 #if HAS_MASS_STORAGE
-		return f_lseek(&file, pos) == FR_OK;
+# if SUPPORT_MACRO_CACHE
+		if (cacheEntry != nullptr)
+		{
+			if (pos > cacheEntry->GetLength())
+			{
+				return false;
+			}
+			cacheOffset = pos;
+			return true;
+		}
+# endif
+# if SUPPORT_FILE_READAHEAD
+		if (FileReadahead::IsAttached(this))
+		{
+			return FileReadahead::Seek(pos);
+		}
+# endif
+		return DirectSeek(pos);
 #else
 		return false;
 #endif
@@ -253,7 +320,23 @@ FilePosition FileStore::Position() const noexcept
 	}
 #endif
 #if HAS_MASS_STORAGE
-	return (usageMode == FileUseMode::readOnly || usageMode == FileUseMode::readWrite) ? file.fptr : 0;
+	if (usageMode != FileUseMode::readOnly && usageMode != FileUseMode::readWrite)
+	{
+		return 0;
+	}
+# if SUPPORT_MACRO_CACHE
+	if (cacheEntry != nullptr)
+	{
+		return cacheOffset;
+	}
+# endif
+# if SUPPORT_FILE_READAHEAD
+	if (FileReadahead::IsAttached(this))
+	{
+		return FileReadahead::Position();
+	}
+# endif
+	return DirectPosition();
 #else
 	return 0;
 #endif
@@ -275,6 +358,12 @@ FilePosition FileStore::Length() const noexcept
 		}
 #endif
 #if HAS_MASS_STORAGE
+# if SUPPORT_MACRO_CACHE
+		if (cacheEntry != nullptr)
+		{
+			return cacheEntry->GetLength();
+		}
+# endif
 		return f_size(&file);
 #else
 		return 0;
@@ -282,6 +371,12 @@ FilePosition FileStore::Length() const noexcept
 
 	case FileUseMode::readWrite:
 #if HAS_MASS_STORAGE
+# if SUPPORT_FILE_WRITE_BEHIND
+		if (FileWriteBehind::IsAttached(this))
+		{
+			return FileWriteBehind::Length();
+		}
+# endif
 		return (writeBuffer != nullptr) ? f_size(&file) + writeBuffer->BytesStored() : f_size(&file);
 #else
 		return 0;
@@ -324,16 +419,22 @@ int FileStore::Read(char* extBuf, size_t nBytes) noexcept
 		}
 #endif
 #if HAS_MASS_STORAGE
+# if SUPPORT_MACRO_CACHE
+		if (cacheEntry != nullptr)
 		{
-			UINT bytes_read;
-			FRESULT readStatus = f_read(&file, extBuf, nBytes, &bytes_read);
-			if (readStatus != FR_OK)
-			{
-				reprap.GetPlatform().MessageF(ErrorMessage, "Cannot read file, error code %d\n", (int)readStatus);
-				return -1;
-			}
-			return (int)bytes_read;
+			const size_t bytesToCopy = min<size_t>(nBytes, cacheEntry->GetLength() - cacheOffset);
+			memcpy(extBuf, cacheEntry->GetData() + cacheOffset, bytesToCopy);
+			cacheOffset += bytesToCopy;
+			return (int)bytesToCopy;
+		}
+# endif
+# if SUPPORT_FILE_READAHEAD
+		if (FileReadahead::IsAttached(this))
+		{
+			return FileReadahead::Read(extBuf, nBytes);
 		}
+# endif
+		return DirectRead(extBuf, nBytes);
 #else
 		return -1;
 #endif
@@ -381,11 +482,60 @@ int FileStore::ReadLine(char* buf, size_t nBytes) noexcept
 
 #if HAS_MASS_STORAGE			// the remaining functions are only supported on local storage
 
+// Read from the card, bypassing any readahead
+int FileStore::DirectRead(char* extBuf, size_t nBytes) noexcept
+{
+	UINT bytes_read;
+	FRESULT readStatus = f_read(&file, extBuf, nBytes, &bytes_read);
+	if (readStatus != FR_OK)
+	{
+		reprap.GetPlatform().MessageF(ErrorMessage, "Cannot read file, error code %d\n", (int)readStatus);
+		return -1;
+	}
+	return (int)bytes_read;
+}
+
+# if SUPPORT_FILE_READAHEAD
+
+// Start reading this file ahead. The file must be open for reading and we must not be using the SBC interface.
+void FileStore::StartReadahead() noexcept
+{
+	if (usageMode == FileUseMode::readOnly
+#  if SUPPORT_MACRO_CACHE
+		&& cacheEntry == nullptr
+#  endif
+	   )
+	{
+		FileReadahead::Attach(this);
+	}
+}
+
+# endif
+
+# if SUPPORT_FILE_WRITE_BEHIND
+
+// Start writing this file behind. The file must be open for writing with a write buffer.
+void FileStore::StartWriteBehind() noexcept
+{
+	if (usageMode == FileUseMode::readWrite)
+	{
+		(void)FileWriteBehind::Attach(this);
+	}
+}
+
+# endif
+
 // Invalidate the file if it uses the specified FATFS object
 bool FileStore::Invalidate(const FATFS *fs, bool doClose) noexcept
 {
 	if (file.obj.fs == fs)
 	{
+# if SUPPORT_FILE_READAHEAD
+		FileReadahead::Detach(this);
+# endif
+# if SUPPORT_FILE_WRITE_BEHIND
+		(void)FileWriteBehind::Detach(this, !doClose);
+# endif
 		if (doClose)
 		{
 			(void)ForceClose();
@@ -436,10 +586,28 @@ void FileStore::Duplicate() noexcept
 
 bool FileStore::ForceClose() noexcept
 {
+# if SUPPORT_MACRO_CACHE
+	if (cacheEntry != nullptr)
+	{
+		MacroCache::Release(cacheEntry);
+		cacheEntry = nullptr;
+		usageMode = FileUseMode::free;
+		closeRequested = false;
+		openCount = 0;
+		return true;
+	}
+# endif
+# if SUPPORT_FILE_READAHEAD
+	FileReadahead::Detach(this);
+# endif
+# if SUPPORT_FILE_WRITE_BEHIND
+	bool ok = FileWriteBehind::Detach(this, false);
+# else
 	bool ok = true;
+# endif
 	if (usageMode == FileUseMode::readWrite)
 	{
-		ok = Flush();
+		ok = Flush() && ok;
 	}
 
 	if (writeBuffer != nullptr)
@@ -487,6 +655,12 @@ bool FileStore::Write(const char *s, size_t len) noexcept
 	case FileUseMode::readOnly:
 	case FileUseMode::readWrite:
 		{
+# if SUPPORT_FILE_WRITE_BEHIND
+			if (FileWriteBehind::IsAttached(this))
+			{
+				return FileWriteBehind::Write(s, len);
+			}
+# endif
 			size_t totalBytesWritten = 0;
 			FRESULT writeStatus = FR_OK;
 			if (writeBuffer == nullptr)
@@ -542,6 +716,12 @@ bool FileStore::Flush() noexcept
 		return true;
 
 	case FileUseMode::readWrite:
+# if SUPPORT_FILE_WRITE_BEHIND
+		if (FileWriteBehind::IsAttached(this) && !FileWriteBehind::Flush())
+		{
+			return false;
+		}
+# endif
 		if (writeBuffer != nullptr)
 		{
 			const size_t bytesToWrite = writeBuffer->BytesStored();
@@ -11,6 +11,7 @@
 
 class Platform;
 class FileWriteBuffer;
+class MacroCacheEntry;
 
 #if HAS_MASS_STORAGE || HAS_LINUX_INTERFACE
 
@@ -37,6 +38,11 @@ public:
 	~FileStore() noexcept;
 
     bool Open(const char* filePath, OpenMode mode, uint32_t preAllocSize) noexcept;
+#if SUPPORT_MACRO_CACHE
+	bool OpenCached(const char* filePath) noexcept;				// Open a file for reading, serving it from the macro cache if it is there
+	bool IsCached() const noexcept { return cacheEntry != nullptr; }
+	void UseCacheEntry(MacroCacheEntry *e) noexcept;			// Close the file and read from a macro cache entry instead
+#endif
 	bool Read(char& b) noexcept;								// Read 1 byte
 	bool Read(uint8_t& b) noexcept
 		{ return Read((char&)b); }								// Read 1 byte
@@ -75,6 +81,12 @@ public:
 	bool IsSameFile(const FIL& otherFile) const noexcept;		// Return true if the passed file is the same as ours
 	bool IsCloseRequested() const noexcept { return closeRequested; }
 #endif
+#if SUPPORT_FILE_READAHEAD
+	void StartReadahead() noexcept;								// Start reading this file ahead on the readahead task
+#endif
+#if SUPPORT_FILE_WRITE_BEHIND
+	void StartWriteBehind() noexcept;							// Start writing this file on the write-behind task
+#endif
 #if HAS_MASS_STORAGE || HAS_LINUX_INTERFACE
 	bool IsFree() const noexcept { return usageMode == FileUseMode::free; }
 #endif
@@ -85,11 +97,21 @@ public:
 
 #endif
 private:
+#if SUPPORT_FILE_READAHEAD
+	friend class FileReadahead;
+#endif
+#if SUPPORT_FILE_WRITE_BEHIND
+	friend class FileWriteBehind;
+#endif
+
 #if HAS_MASS_STORAGE || HAS_LINUX_INTERFACE
 	void Init() noexcept;
 #endif
 #if HAS_MASS_STORAGE
 	FRESULT Store(const char *s, size_t len, size_t *bytesWritten) noexcept; // Write data to the non-volatile storage
+	int DirectRead(char* extBuf, size_t nBytes) noexcept;		// Read from the card, bypassing any readahead
+	bool DirectSeek(FilePosition pos) noexcept { return f_lseek(&file, pos) == FR_OK; }
+	FilePosition DirectPosition() const noexcept { return file.fptr; }
 
     FIL file;
 	FileWriteBuffer *writeBuffer;
@@ -97,6 +119,10 @@ private:
 	volatile bool closeRequested;
 	bool calcCrc;
 #endif
+#if SUPPORT_MACRO_CACHE
+	MacroCacheEntry *cacheEntry;								// if this is not null then we are reading from the macro cache instead of the file
+	FilePosition cacheOffset;
+#endif
 #if HAS_MASS_STORAGE || HAS_LINUX_INTERFACE
 	FileUseMode usageMode;
 #endif
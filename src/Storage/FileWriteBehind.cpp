@@ -0,0 +1,237 @@
+/*
+ * FileWriteBehind.cpp
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#include "FileWriteBehind.h"
+
+#if SUPPORT_FILE_WRITE_BEHIND
+
+#include "FileWriteBuffer.h"
+#include "MassStorage.h"
+#include <Platform.h>
+#include <RepRap.h>
+#include <TaskPriorities.h>
+#include <RTOSIface/RTOSIface.h>
+
+constexpr uint32_t WriteBehindTaskStackWords = 400;					// must be large enough for a call to f_write and for WriteBuffer to report an error
+
+static_assert(FileWriteBufLen % 512 == 0);							// so that whole buffers are written as whole sectors
+
+static Task<WriteBehindTaskStackWords> *writeBehindTask = nullptr;
+static Mutex attachMutex;											// protects the file pointer and the buffer being filled, owned before writeBehindMutex
+static Mutex writeBehindMutex;										// protects the pending and spare buffers and the underlying file
+
+FileStore * volatile FileWriteBehind::file = nullptr;
+FileWriteBuffer *FileWriteBehind::filling = nullptr;
+FileWriteBuffer *FileWriteBehind::pending = nullptr;
+FileWriteBuffer *FileWriteBehind::spare = nullptr;
+bool FileWriteBehind::writeError = false;
+unsigned int FileWriteBehind::numStalls = 0;
+
+extern "C" [[noreturn]] void WriteBehindTaskStart(void * pvParameters) noexcept
+{
+	FileWriteBehind::TaskLoop();
+}
+
+// Start writing a file behind. This is called when we start receiving an upload. The file must have a write buffer, which we take over.
+bool FileWriteBehind::Attach(FileStore *f) noexcept
+{
+	if (file != nullptr || f->writeBuffer == nullptr)
+	{
+		return false;
+	}
+
+	FileWriteBuffer * const second = MassStorage::AllocateWriteBuffer();
+	if (second == nullptr)
+	{
+		return false;
+	}
+
+	if (writeBehindTask == nullptr)
+	{
+		attachMutex.Create("WriteBehindAttach");
+		writeBehindMutex.Create("WriteBehind");
+		writeBehindTask = new Task<WriteBehindTaskStackWords>;
+		writeBehindTask->Create(WriteBehindTaskStart, "WRITEBEHIND", nullptr, TaskPriority::FileWriteBehindPriority);
+	}
+
+	MutexLocker attachLock(attachMutex);
+	MutexLocker lock(writeBehindMutex);
+	filling = f->writeBuffer;
+	f->writeBuffer = nullptr;
+	spare = second;
+	pending = nullptr;
+	writeError = false;
+	file = f;
+	return true;
+}
+
+// Stop writing a file behind and return the buffers to the pool. Unless we are discarding the data, write out anything still buffered first.
+// Return false if any data could not be written. This may be called by another task while the network task is writing the file, e.g. when a card is unmounted.
+bool FileWriteBehind::Detach(const FileStore *f, bool discard) noexcept
+{
+	if (f == nullptr || writeBehindTask == nullptr)
+	{
+		return true;
+	}
+
+	MutexLocker attachLock(attachMutex);
+	if (f != file)
+	{
+		return true;
+	}
+
+	const bool ok = (discard) || FlushBuffers();
+	MutexLocker lock(writeBehindMutex);
+	if (pending != nullptr)
+	{
+		spare = pending;											// we are discarding the data
+		pending = nullptr;
+	}
+	filling->DataTaken();
+	spare->DataTaken();
+	MassStorage::ReleaseWriteBuffer(filling);
+	MassStorage::ReleaseWriteBuffer(spare);
+	filling = spare = nullptr;
+	file = nullptr;
+	return ok;
+}
+
+// Store data to be written to the attached file. Called by FileStore::Write.
+bool FileWriteBehind::Write(const char *s, size_t len) noexcept
+{
+	MutexLocker attachLock(attachMutex);
+	if (file == nullptr)
+	{
+		return false;												// the file was detached by another task
+	}
+
+	while (len != 0)
+	{
+		const size_t bytesStored = filling->Store(s, len);
+		s += bytesStored;
+		len -= bytesStored;
+		if (filling->BytesLeft() == 0 && !HandOver())
+		{
+			return false;
+		}
+	}
+	return !writeError;
+}
+
+// Pass the full buffer to the write-behind task and start filling the other one.
+// If the task hasn't finished with the other buffer yet then we wait for it, and if it hasn't started on it then we write it ourselves.
+// The attach mutex must be owned.
+bool FileWriteBehind::HandOver() noexcept
+{
+	if (pending != nullptr)
+	{
+		++numStalls;
+	}
+
+	{
+		MutexLocker lock(writeBehindMutex);
+		if (pending != nullptr)
+		{
+			WriteBuffer(pending);
+		}
+		if (writeError)
+		{
+			filling->DataTaken();
+			return false;
+		}
+		pending = filling;
+		filling = spare;
+		spare = nullptr;
+	}
+	writeBehindTask->Give();
+	return true;
+}
+
+// Write all buffered data to the card. Called by FileStore::Flush.
+bool FileWriteBehind::Flush() noexcept
+{
+	MutexLocker attachLock(attachMutex);
+	return file != nullptr && FlushBuffers();
+}
+
+// Write all buffered data to the card. The attach mutex must be owned.
+bool FileWriteBehind::FlushBuffers() noexcept
+{
+	MutexLocker lock(writeBehindMutex);
+	if (pending != nullptr)
+	{
+		WriteBuffer(pending);
+	}
+	if (filling->BytesStored() != 0)
+	{
+		WriteBuffer(filling);
+	}
+	return !writeError;
+}
+
+// Return the length of the file including the data stored but not yet written to the card. We must own the mutex while reading the file size too,
+// otherwise the write-behind task could move data from a buffer to the file in between and we would count it twice.
+FilePosition FileWriteBehind::Length() noexcept
+{
+	MutexLocker attachLock(attachMutex);
+	if (file == nullptr)
+	{
+		return 0;
+	}
+	MutexLocker lock(writeBehindMutex);
+	const FilePosition written = f_size(&file->file);
+	return (pending != nullptr) ? written + filling->BytesStored() + pending->BytesStored() : written + filling->BytesStored();
+}
+
+// Write a buffer to the card. If it was the pending buffer then it becomes the spare one. The mutex must be owned.
+void FileWriteBehind::WriteBuffer(FileWriteBuffer *buf) noexcept
+{
+	const size_t bytesToWrite = buf->BytesStored();
+	if (!writeError && bytesToWrite != 0)
+	{
+		size_t bytesWritten;
+		const FRESULT writeStatus = file->Store(buf->Data(), bytesToWrite, &bytesWritten);
+		if (writeStatus != FR_OK || bytesWritten != bytesToWrite)
+		{
+			writeError = true;
+			reprap.GetPlatform().MessageF(ErrorMessage, "Failed to write to file, error code %d. Card may be full.\n", (int)writeStatus);
+		}
+	}
+	buf->DataTaken();
+
+	if (buf == pending)
+	{
+		spare = pending;
+		pending = nullptr;
+	}
+}
+
+// Main loop of the write-behind task. It sleeps until woken, then writes the pending buffer if there is one.
+void FileWriteBehind::TaskLoop() noexcept
+{
+	for (;;)
+	{
+		(void)TaskBase::Take();
+		MutexLocker lock(writeBehindMutex);
+		if (file != nullptr && pending != nullptr)
+		{
+			WriteBuffer(pending);
+		}
+	}
+}
+
+void FileWriteBehind::Diagnostics(MessageType mtype) noexcept
+{
+	if (writeBehindTask != nullptr)
+	{
+		reprap.GetPlatform().MessageF(mtype, "File write-behind %s, stalls %u\n", (file != nullptr) ? "active" : "idle", numStalls);
+		numStalls = 0;
+	}
+}
+
+#endif
+
+// End
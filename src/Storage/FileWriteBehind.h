@@ -0,0 +1,57 @@
+/*
+ * FileWriteBehind.h
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#ifndef SRC_STORAGE_FILEWRITEBEHIND_H_
+#define SRC_STORAGE_FILEWRITEBEHIND_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_FILE_WRITE_BEHIND
+
+#include "FileStore.h"
+
+class FileWriteBuffer;
+
+// Class to write a file being uploaded to the SD card on a separate task, so that network reception overlaps with card writes instead of
+// waiting for them. It uses two buffers from the file write buffer pool: while the network task fills one, the write-behind task writes the
+// other to the card. The buffers are whole numbers of sectors and the file is written from the start, so FatFS writes each buffer directly
+// to the card using multi-sector writes. Only one file at a time is written behind; if the second buffer can't be allocated we don't attach
+// and the file is written synchronously as before.
+// While a file is attached, FileStore::Write, Flush and Length are routed through here. They own the attach mutex while they use the buffer being
+// filled, so that another task can detach the file safely; the card is written while owning the other mutex, so that the network task isn't held up.
+class FileWriteBehind
+{
+public:
+	static bool Attach(FileStore *f) noexcept;								// start writing this file behind, returning true if successful
+	static bool Detach(const FileStore *f, bool discard) noexcept;			// stop writing this file behind if it is the one attached
+	static bool IsAttached(const FileStore *f) noexcept { return f == file; }
+
+	static bool Write(const char *s, size_t len) noexcept;
+	static bool Flush() noexcept;											// write all buffered data to the card
+	static FilePosition Length() noexcept;									// the length of the file including data not yet written
+
+	static void Diagnostics(MessageType mtype) noexcept;
+
+	[[noreturn]] static void TaskLoop() noexcept;
+
+private:
+	FileWriteBehind() = delete;
+
+	static bool HandOver() noexcept;
+	static bool FlushBuffers() noexcept;
+	static void WriteBuffer(FileWriteBuffer *buf) noexcept;
+
+	static FileStore * volatile file;										// the file being written behind, or null
+	static FileWriteBuffer *filling;										// the buffer being filled by the network task
+	static FileWriteBuffer *pending;										// a full buffer waiting to be written, or null
+	static FileWriteBuffer *spare;											// the empty buffer if there is nothing pending, else null
+	static bool writeError;
+	static unsigned int numStalls;											// number of times the writer hadn't finished when the next buffer was full
+};
+
+#endif
+
+#endif /* SRC_STORAGE_FILEWRITEBEHIND_H_ */
@@ -0,0 +1,224 @@
+/*
+ * MacroCache.cpp
+ *
+ *  Created on: 9 Oct 2020
+ *      Author: David
+ */
+
+#include "MacroCache.h"
+
+#if SUPPORT_MACRO_CACHE
+
+#include "FileStore.h"
+#include "MassStorage.h"
+#include <Platform.h>
+#include <RepRap.h>
+#include <RTOSIface/RTOSIface.h>
+
+static Mutex cacheMutex;
+
+MacroCacheEntry *MacroCache::entries = nullptr;
+size_t MacroCache::totalStorage = 0;
+unsigned int MacroCache::numHits = 0;
+unsigned int MacroCache::numMisses = 0;
+volatile unsigned int MacroCache::numInvalidations = 0;
+
+void MacroCache::Init() noexcept
+{
+	cacheMutex.Create("MacroCache");
+}
+
+// Remove an entry from the list and delete it if nobody is using it. The cache mutex must be owned.
+/*static*/ void MacroCache::Unlink(MacroCacheEntry *e, MacroCacheEntry *prev) noexcept
+{
+	if (prev == nullptr)
+	{
+		entries = e->next;
+	}
+	else
+	{
+		prev->next = e->next;
+	}
+
+	if (e->refCount == 0)
+	{
+		totalStorage -= e->StorageNeeded();
+		delete[] reinterpret_cast<char*>(e);
+	}
+	else
+	{
+		e->stale = true;								// delete it when the last reference is released
+	}
+}
+
+// Look up a file. If we find it, move it to the front of the list and add a reference to it.
+MacroCacheEntry *MacroCache::Find(const char *filePath) noexcept
+{
+	const char * const key = MassStorage::CacheKey(filePath);
+	MutexLocker lock(cacheMutex);
+	MacroCacheEntry *prev = nullptr;
+	for (MacroCacheEntry *e = entries; e != nullptr; e = e->next)
+	{
+		if (StringEqualsIgnoreCase(e->GetPath(), key))
+		{
+			if (prev != nullptr)
+			{
+				prev->next = e->next;
+				e->next = entries;
+				entries = e;
+			}
+			++e->refCount;
+			++numHits;
+			return e;
+		}
+		prev = e;
+	}
+	++numMisses;
+	return nullptr;
+}
+
+// Delete least recently used entries that are not in use until there is room for another entry of the specified size. The cache mutex must be owned.
+/*static*/ bool MacroCache::MakeSpace(size_t bytesNeeded) noexcept
+{
+	while (totalStorage + bytesNeeded > MacroCacheSize)
+	{
+		MacroCacheEntry *victim = nullptr, *victimPrev = nullptr;
+		MacroCacheEntry *prev = nullptr;
+		for (MacroCacheEntry *e = entries; e != nullptr; e = e->next)
+		{
+			if (e->refCount == 0)
+			{
+				victim = e;
+				victimPrev = prev;
+			}
+			prev = e;
+		}
+
+		if (victim == nullptr)
+		{
+			return false;
+		}
+		Unlink(victim, victimPrev);
+	}
+	return true;
+}
+
+// Try to cache a file that has just been opened for reading. If successful, add a reference to the new entry and return it.
+// If we return null then the file is still positioned at the start, so the caller can read it directly.
+// We don't own the cache mutex while reading the file, so that the cache can be used meanwhile. If anything is invalidated while we are reading,
+// the file we are reading may have changed, so we don't add it to the cache.
+MacroCacheEntry *MacroCache::Load(const char *filePath, FileStore& f) noexcept
+{
+	const char * const key = MassStorage::CacheKey(filePath);
+	const FilePosition length = f.Length();
+	const size_t storageNeeded = sizeof(MacroCacheEntry) + length + strlen(key) + 1;
+	if (length > MaxCachedMacroFileSize || storageNeeded > MacroCacheSize)
+	{
+		return nullptr;
+	}
+
+	const unsigned int startingInvalidations = numInvalidations;
+	MacroCacheEntry * const e = reinterpret_cast<MacroCacheEntry*>(new char[storageNeeded]);
+	e->length = length;
+	e->refCount = 1;
+	e->stale = false;
+
+	FilePosition bytesRead = 0;
+	while (bytesRead < length)
+	{
+		const int n = f.Read(e->Data() + bytesRead, length - bytesRead);
+		if (n <= 0)
+		{
+			break;
+		}
+		bytesRead += (FilePosition)n;
+	}
+	strcpy(e->Data() + length, key);
+
+	{
+		MutexLocker lock(cacheMutex);
+		if (bytesRead == length && numInvalidations == startingInvalidations && MakeSpace(storageNeeded))
+		{
+			e->next = entries;
+			entries = e;
+			totalStorage += storageNeeded;
+			return e;
+		}
+	}
+
+	delete[] reinterpret_cast<char*>(e);
+	(void)f.Seek(0);
+	return nullptr;
+}
+
+// Release a reference to an entry
+void MacroCache::Release(MacroCacheEntry *e) noexcept
+{
+	MutexLocker lock(cacheMutex);
+	if (--e->refCount == 0 && e->stale)
+	{
+		totalStorage -= e->StorageNeeded();
+		delete[] reinterpret_cast<char*>(e);
+	}
+}
+
+// Invalidate the entry for a file that has been changed, or the entries for all files in a directory that has been changed
+void MacroCache::Invalidate(const char *path) noexcept
+{
+	const char * const key = MassStorage::CacheKey(path);
+	size_t keyLength = strlen(key);
+	while (keyLength != 0 && (key[keyLength - 1] == '/' || key[keyLength - 1] == '\\'))
+	{
+		--keyLength;
+	}
+
+	MutexLocker lock(cacheMutex);
+	++numInvalidations;
+	MacroCacheEntry *prev = nullptr;
+	MacroCacheEntry *e = entries;
+	while (e != nullptr)
+	{
+		MacroCacheEntry * const next = e->next;
+		const char * const entryPath = e->GetPath();
+		if (   StringStartsWithIgnoreCase(entryPath, key)
+			&& (entryPath[keyLength] == 0 || entryPath[keyLength] == '/' || entryPath[keyLength] == '\\')
+		   )
+		{
+			Unlink(e, prev);
+		}
+		else
+		{
+			prev = e;
+		}
+		e = next;
+	}
+}
+
+// Remove all entries. Called when a card is mounted or unmounted.
+void MacroCache::Clear() noexcept
+{
+	MutexLocker lock(cacheMutex);
+	++numInvalidations;
+	while (entries != nullptr)
+	{
+		Unlink(entries, nullptr);
+	}
+}
+
+void MacroCache::Diagnostics(MessageType mtype) noexcept
+{
+	unsigned int numEntries = 0;
+	{
+		MutexLocker lock(cacheMutex);
+		for (const MacroCacheEntry *e = entries; e != nullptr; e = e->next)
+		{
+			++numEntries;
+		}
+	}
+	reprap.GetPlatform().MessageF(mtype, "Macro cache: %u files, %u bytes, hits %u, misses %u\n", numEntries, totalStorage, numHits, numMisses);
+	numHits = numMisses = 0;
+}
+
+#endif
+
+// End
@@ -0,0 +1,67 @@
+/*
+ * MacroCache.h
+ *
+ *  Created on: 9 Oct 2020
+ *      Author: David
+ */
+
+#ifndef SRC_STORAGE_MACROCACHE_H_
+#define SRC_STORAGE_MACROCACHE_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_MACRO_CACHE
+
+class FileStore;
+
+// A macro file held in RAM. The data and the path are stored after the header in the same allocation.
+class MacroCacheEntry
+{
+public:
+	friend class MacroCache;
+
+	const char *GetData() const noexcept { return reinterpret_cast<const char*>(this + 1); }
+	FilePosition GetLength() const noexcept { return length; }
+
+private:
+	char *Data() noexcept { return reinterpret_cast<char*>(this + 1); }
+	const char *GetPath() const noexcept { return GetData() + length; }
+	size_t StorageNeeded() const noexcept { return sizeof(MacroCacheEntry) + length + strlen(GetPath()) + 1; }
+
+	MacroCacheEntry *next;
+	FilePosition length;
+	unsigned int refCount;											// how many open files are reading this entry
+	bool stale;														// true if the file has been changed since we cached it
+};
+
+// Least-recently-used cache of small macro files such as tool change, homing and pause macros, so that running them again doesn't need the SD card.
+// Entries are keyed by path. Rather than checking the last modified date on each open, which needs the card, the entries for a path are invalidated
+// whenever the firmware opens that path for writing, deletes it or renames it, and the whole cache is cleared when a card is mounted or unmounted.
+class MacroCache
+{
+public:
+	static void Init() noexcept;
+
+	static MacroCacheEntry *Find(const char *filePath) noexcept;			// look up a file, and if found add a reference to it
+	static MacroCacheEntry *Load(const char *filePath, FileStore& f) noexcept;	// try to cache a file that has just been opened, and if successful add a reference to it
+	static void Release(MacroCacheEntry *e) noexcept;					// release a reference obtained from Find or Load
+	static void Invalidate(const char *path) noexcept;				// invalidate a file or the contents of a directory
+	static void Clear() noexcept;
+
+	static void Diagnostics(MessageType mtype) noexcept;
+
+private:
+	MacroCache() = delete;
+
+	static void Unlink(MacroCacheEntry *e, MacroCacheEntry *prev) noexcept;
+	static bool MakeSpace(size_t bytesNeeded) noexcept;
+
+	static MacroCacheEntry *entries;								// most recently used first
+	static size_t totalStorage;
+	static unsigned int numHits, numMisses;
+	static volatile unsigned int numInvalidations;					// incremented when anything is invalidated, so that Load can tell
+};
+
+#endif
+
+#endif /* SRC_STORAGE_MACROCACHE_H_ */
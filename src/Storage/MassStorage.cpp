@@ -1,4 +1,9 @@
 #include "MassStorage.h"
+#include "FileReadahead.h"
+#include "FileWriteBehind.h"
+#include "MacroCache.h"
+#include "DirectoryIndex.h"
+#include "FileInfoCache.h"
 #include <Platform.h>
 #include <RepRap.h>
 #include <ObjectModel/ObjectModel.h>
@@ -124,6 +129,9 @@ static Mutex dirMutex;
 
 static FileInfoParser infoParser;
 static DIR findDir;
+static DIR findDirBefore;					// when listing, the position of the entry we returned last
+static unsigned int listedIndex;			// when listing, the index of the entry we returned last
+static bool listing = false;				// true if the search was started by FindFirst with a starting index
 static FileWriteBuffer *freeWriteBuffers;
 #endif
 
@@ -198,6 +206,15 @@ static unsigned int InternalUnmount(size_t card, bool doClose) noexcept
 	MutexLocker lock1(fsMutex);
 	MutexLocker lock2(inf.volMutex);
 	const unsigned int invalidated = MassStorage::InvalidateFiles(&inf.fileSystem, doClose);
+# if SUPPORT_MACRO_CACHE
+	MacroCache::Clear();
+# endif
+# if SUPPORT_DIRECTORY_INDEX
+	DirectoryIndex::Clear();
+# endif
+# if SUPPORT_FILE_INFO_CACHE
+	FileInfoCache::Clear();
+# endif
 	const char path[3] = { (char)('0' + card), ':', 0 };
 	f_mount(nullptr, path, 0);
 	inf.Clear(card);
@@ -279,6 +296,15 @@ void MassStorage::Init() noexcept
 
 	// Create the mutexes
 	dirMutex.Create("DirSearch");
+#  if SUPPORT_MACRO_CACHE
+	MacroCache::Init();
+#  endif
+#  if SUPPORT_DIRECTORY_INDEX
+	DirectoryIndex::Init();
+#  endif
+#  if SUPPORT_FILE_INFO_CACHE
+	FileInfoCache::Init();
+#  endif
 
 	freeWriteBuffers = nullptr;
 	for (size_t i = 0; i < NumFileWriteBuffers; ++i)
@@ -308,6 +334,18 @@ void MassStorage::Init() noexcept
 
 FileStore* MassStorage::OpenFile(const char* filePath, OpenMode mode, uint32_t preAllocSize) noexcept
 {
+# if SUPPORT_MACRO_CACHE
+	if (mode != OpenMode::read)
+	{
+		MacroCache::Invalidate(filePath);
+	}
+# endif
+# if SUPPORT_DIRECTORY_INDEX
+	if (mode != OpenMode::read)
+	{
+		DirectoryIndex::Invalidate(filePath);
+	}
+# endif
 	{
 		MutexLocker lock(fsMutex);
 		for (size_t i = 0; i < MAX_FILES; i++)
@@ -324,6 +362,48 @@ FileStore* MassStorage::OpenFile(const char* filePath, OpenMode mode, uint32_t p
 #endif
 
 #if HAS_MASS_STORAGE
+
+// Open a macro file for reading. Recently used macro files are served from RAM.
+FileStore* MassStorage::OpenMacroFile(const char* filePath) noexcept
+{
+# if SUPPORT_MACRO_CACHE
+	FileStore *f = nullptr;
+	{
+		MutexLocker lock(fsMutex);
+		for (size_t i = 0; i < MAX_FILES; i++)
+		{
+			if (files[i].IsFree())
+			{
+				if (!files[i].OpenCached(filePath))
+				{
+					return nullptr;
+				}
+				f = &files[i];
+				break;
+			}
+		}
+	}
+
+	if (f == nullptr)
+	{
+		reprap.GetPlatform().Message(ErrorMessage, "Max open file count exceeded.\n");
+	}
+	else if (!f->IsCached())
+	{
+		// Try to cache it. We read the file without owning the file system mutex, so that other tasks can open and close files meanwhile.
+		MacroCacheEntry * const e = MacroCache::Load(filePath, *f);
+		if (e != nullptr)
+		{
+			MutexLocker lock(fsMutex);
+			f->UseCacheEntry(e);
+		}
+	}
+	return f;
+# else
+	return OpenFile(filePath, OpenMode::read, 0);
+# endif
+}
+
 // Close all files
 void MassStorage::CloseAllFiles() noexcept
 {
@@ -337,13 +417,11 @@ void MassStorage::CloseAllFiles() noexcept
 	}
 }
 
-// Open a directory to read a file list. Returns true if it contains any files, false otherwise.
-// If this returns true then the file system mutex is owned. The caller must subsequently release the mutex either
-// by calling FindNext until it returns false, or by calling AbandonFindNext.
-bool MassStorage::FindFirst(const char *directory, FileInfo &file_info) noexcept
+// Open a directory for searching, taking the directory search mutex. The directory name is returned without a trailing '/'.
+// If this returns false then the mutex is not owned.
+static bool OpenFindDir(const char *directory, const StringRef& loc) noexcept
 {
 	// Remove any trailing '/' from the directory name, it sometimes (but not always) confuses f_opendir
-	String<MaxFilenameLength> loc;
 	loc.copy(directory);
 	const size_t len = loc.strlen();
 	if (len != 0 && (loc[len - 1] == '/' || loc[len - 1] == '\\'))
@@ -356,27 +434,97 @@ bool MassStorage::FindFirst(const char *directory, FileInfo &file_info) noexcept
 		return false;
 	}
 
-	FRESULT res = f_opendir(&findDir, loc.c_str());
-	if (res == FR_OK)
+	if (f_opendir(&findDir, loc.c_str()) != FR_OK)
 	{
-		FILINFO entry;
+		dirMutex.Release();
+		return false;
+	}
+	return true;
+}
 
+static void CopyFileInfo(FileInfo &file_info, const FILINFO& entry) noexcept
+{
+	file_info.isDirectory = (entry.fattrib & AM_DIR);
+	file_info.fileName.copy(entry.fname);
+	file_info.size = entry.fsize;
+	file_info.lastModified = ConvertTimeStamp(entry.fdate, entry.ftime);
+}
+
+// Open a directory to read a file list. Returns true if it contains any files, false otherwise.
+// If this returns true then the file system mutex is owned. The caller must subsequently release the mutex either
+// by calling FindNext until it returns false, or by calling AbandonFindNext.
+bool MassStorage::FindFirst(const char *directory, FileInfo &file_info) noexcept
+{
+	String<MaxFilenameLength> loc;
+	if (OpenFindDir(directory, loc.GetRef()))
+	{
+		FILINFO entry;
 		for (;;)
 		{
-			res = f_readdir(&findDir, &entry);
-			if (res != FR_OK || entry.fname[0] == 0) break;
+			if (f_readdir(&findDir, &entry) != FR_OK || entry.fname[0] == 0) break;
 			if (!StringEqualsIgnoreCase(entry.fname, ".") && !StringEqualsIgnoreCase(entry.fname, ".."))
 			{
-				file_info.isDirectory = (entry.fattrib & AM_DIR);
-				file_info.fileName.copy(entry.fname);
-				file_info.size = entry.fsize;
-				file_info.lastModified = ConvertTimeStamp(entry.fdate, entry.ftime);
+				CopyFileInfo(file_info, entry);
 				return true;
 			}
 		}
 		f_closedir(&findDir);
+		dirMutex.Release();
+	}
+	return false;
+}
+
+// Read the next entry that belongs in a file listing, skipping names that start with '.' which are Mac resource files and Linux hidden files
+static bool ReadListedEntry(FileInfo &file_info) noexcept
+{
+	FILINFO entry;
+	for (;;)
+	{
+		const DIR before = findDir;
+		if (f_readdir(&findDir, &entry) != FR_OK || entry.fname[0] == 0)
+		{
+			return false;
+		}
+		if (entry.fname[0] != '.')
+		{
+			findDirBefore = before;
+			CopyFileInfo(file_info, entry);
+			return true;
+		}
+	}
+}
+
+// Start a file listing at entry number 'startAt', not counting names that start with '.'. Returns true if there is such an entry.
+// Entries before 'startAt' are skipped using the directory index if we have one. The mutex rules are the same as for the other FindFirst.
+// If the listing is abandoned, the next listing of the same directory can start at the last entry that was returned without reading the ones before it.
+bool MassStorage::FindFirst(const char *directory, FileInfo &file_info, unsigned int startAt) noexcept
+{
+	String<MaxFilenameLength> loc;
+	if (!OpenFindDir(directory, loc.GetRef()))
+	{
+		return false;
 	}
 
+# if SUPPORT_DIRECTORY_INDEX
+	unsigned int index = DirectoryIndex::Seek(loc.c_str(), startAt, findDir);
+# else
+	unsigned int index = 0;
+# endif
+	while (ReadListedEntry(file_info))
+	{
+# if SUPPORT_DIRECTORY_INDEX
+		DirectoryIndex::Record(index, findDirBefore);
+# endif
+		if (index == startAt)
+		{
+			listedIndex = index;
+			listing = true;
+			return true;
+		}
+		++index;
+	}
+
+	f_closedir(&findDir);
 	dirMutex.Release();
 	return false;
 }
@@ -390,8 +538,23 @@ bool MassStorage::FindNext(FileInfo &file_info) noexcept
 		return false;		// error, we don't hold the mutex
 	}
 
-	FILINFO entry;
+	if (listing)
+	{
+		if (ReadListedEntry(file_info))
+		{
+			++listedIndex;
+# if SUPPORT_DIRECTORY_INDEX
+			DirectoryIndex::Record(listedIndex, findDirBefore);
+# endif
+			return true;
+		}
+		listing = false;
+		f_closedir(&findDir);
+		dirMutex.Release();
+		return false;
+	}
 
+	FILINFO entry;
 	if (f_readdir(&findDir, &entry) != FR_OK || entry.fname[0] == 0)
 	{
 		f_closedir(&findDir);
@@ -399,18 +562,23 @@ bool MassStorage::FindNext(FileInfo &file_info) noexcept
 		return false;
 	}
 
-	file_info.isDirectory = (entry.fattrib & AM_DIR);
-	file_info.size = entry.fsize;
-	file_info.fileName.copy(entry.fname);
-	file_info.lastModified = ConvertTimeStamp(entry.fdate, entry.ftime);
+	CopyFileInfo(file_info, entry);
 	return true;
 }
 
 // Quit searching for files. Needed to avoid hanging on to the mutex. Safe to call even if the caller doesn't hold the mutex.
+// If we are listing then the caller hasn't used the entry we returned last, so the next page of the listing will start with it.
 void MassStorage::AbandonFindNext() noexcept
 {
 	if (dirMutex.GetHolder() == RTOSIface::GetCurrentTask())
 	{
+		if (listing)
+		{
+# if SUPPORT_DIRECTORY_INDEX
+			DirectoryIndex::SetCursor(listedIndex, findDirBefore);
+# endif
+			listing = false;
+		}
 		dirMutex.Release();
 	}
 }
@@ -427,6 +595,12 @@ const char* MassStorage::GetMonthName(const uint8_t month) noexcept
 // Delete a file or directory
 bool MassStorage::Delete(const char* filePath, bool messageIfFailed) noexcept
 {
+# if SUPPORT_MACRO_CACHE
+	MacroCache::Invalidate(filePath);
+# endif
+# if SUPPORT_DIRECTORY_INDEX
+	DirectoryIndex::Invalidate(filePath);
+# endif
 	FRESULT unlinkReturn;
 	bool isOpen = false;
 
@@ -474,6 +648,12 @@ bool MassStorage::Delete(const char* filePath, bool messageIfFailed) noexcept
 		}
 		return false;
 	}
+# if SUPPORT_FILE_INFO_CACHE
+	if (IsGCodeFileName(filePath))
+	{
+		FileInfoCache::Forget(filePath);
+	}
+# endif
 	return true;
 }
 
@@ -518,6 +698,9 @@ bool MassStorage::EnsurePath(const char* filePath, bool messageIfFailed) noexcep
 // Create a new directory
 bool MassStorage::MakeDirectory(const char *directory, bool messageIfFailed) noexcept
 {
+# if SUPPORT_DIRECTORY_INDEX
+	DirectoryIndex::Invalidate(directory);
+# endif
 	if (!EnsurePath(directory, messageIfFailed))
 	{
 		return false;
@@ -536,6 +719,14 @@ bool MassStorage::MakeDirectory(const char *directory, bool messageIfFailed) noe
 // Rename a file or directory
 bool MassStorage::Rename(const char *oldFilename, const char *newFilename, bool messageIfFailed) noexcept
 {
+# if SUPPORT_MACRO_CACHE
+	MacroCache::Invalidate(oldFilename);
+	MacroCache::Invalidate(newFilename);
+# endif
+# if SUPPORT_DIRECTORY_INDEX
+	DirectoryIndex::Invalidate(oldFilename);
+	DirectoryIndex::Invalidate(newFilename);
+# endif
 	if (newFilename[0] >= '0' && newFilename[0] <= '9' && newFilename[1] == ':')
 	{
 		// Workaround for DWC 1.13 which sends a volume specification at the start of the new path.
@@ -555,6 +746,12 @@ bool MassStorage::Rename(const char *oldFilename, const char *newFilename, bool
 		}
 		return false;
 	}
+# if SUPPORT_FILE_INFO_CACHE
+	if (IsGCodeFileName(oldFilename))
+	{
+		FileInfoCache::Rename(oldFilename, newFilename);
+	}
+# endif
 	return true;
 }
 #endif
@@ -884,6 +1081,11 @@ void MassStorage::Spin() noexcept
 			}
 		}
 	}
+
+# if SUPPORT_FILE_INFO_CACHE
+	infoParser.Spin();
+	FileInfoCache::Spin();
+# endif
 }
 
 // Append the simulated printing time to the end of the file
@@ -988,6 +1190,36 @@ GCodeResult MassStorage::GetFileInfo(const char *filePath, GCodeFileInfo& info,
 	return infoParser.GetFileInfo(filePath, info, quitEarly);
 }
 
+// Ask for a file to be parsed in the background, so that the information is ready when a client asks for it
+void MassStorage::QueueFileInfo(const char *filePath) noexcept
+{
+# if SUPPORT_FILE_INFO_CACHE
+	FileInfoCache::QueueParse(filePath);
+# endif
+}
+
+// Return the key under which the macro cache, directory index and file info cache index a path.
+// Paths without a volume number refer to volume 0, so strip "0:" to make them compare equal.
+const char *MassStorage::CacheKey(const char *path) noexcept
+{
+	return (path[0] == '0' && path[1] == ':') ? path + 2 : path;
+}
+
+// Return true if a file name has one of the extensions that G-code files have
+bool MassStorage::IsGCodeFileName(const char *filePath) noexcept
+{
+	return StringEndsWithIgnoreCase(filePath, ".gcode") || StringEndsWithIgnoreCase(filePath, ".g")
+		|| StringEndsWithIgnoreCase(filePath, ".gco") || StringEndsWithIgnoreCase(filePath, ".gc");
+}
+
+// Return true if a file is one that the user may print, i.e. a G-code file in the G-code directory of any volume, as opposed to a macro or system file
+bool MassStorage::IsPrintableFile(const char *filePath) noexcept
+{
+	const char * const path = (isdigit(filePath[0]) && filePath[1] == ':') ? filePath + 2 : filePath;
+	const char * const gcodeDir = strchr(GCODE_DIR, '/');						// the directory without the volume number
+	return StringStartsWithIgnoreCase(path, gcodeDir) && IsGCodeFileName(path);
+}
+
 void MassStorage::Diagnostics(MessageType mtype) noexcept
 {
 	Platform& platform = reprap.GetPlatform();
@@ -1006,6 +1238,22 @@ void MassStorage::Diagnostics(MessageType mtype) noexcept
 	// Show the longest SD card write time
 	platform.MessageF(mtype, "SD card longest read time %.1fms, write time %.1fms, max retries %u\n",
 								(double)DiskioGetAndClearLongestReadTime(), (double)DiskioGetAndClearLongestWriteTime(), DiskioGetAndClearMaxRetryCount());
+
+# if SUPPORT_FILE_READAHEAD
+	FileReadahead::Diagnostics(mtype);
+# endif
+# if SUPPORT_FILE_WRITE_BEHIND
+	FileWriteBehind::Diagnostics(mtype);
+# endif
+# if SUPPORT_MACRO_CACHE
+	MacroCache::Diagnostics(mtype);
+# endif
+# if SUPPORT_DIRECTORY_INDEX
+	DirectoryIndex::Diagnostics(mtype);
+# endif
+# if SUPPORT_FILE_INFO_CACHE
+	FileInfoCache::Diagnostics(mtype);
+# endif
 }
 
 # if SUPPORT_OBJECT_MODEL
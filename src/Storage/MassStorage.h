@@ -34,7 +34,9 @@ namespace MassStorage
 	bool FileExists(const char *filePath) noexcept;
 #endif
 #if HAS_MASS_STORAGE
+	FileStore* OpenMacroFile(const char* filePath) noexcept;								// open a file for reading, using the macro cache if possible
 	bool FindFirst(const char *directory, FileInfo &file_info) noexcept;
+	bool FindFirst(const char *directory, FileInfo &file_info, unsigned int startAt) noexcept;	// start a file listing at entry 'startAt', skipping hidden files
 	bool FindNext(FileInfo &file_info) noexcept;
 	void AbandonFindNext() noexcept;
 	bool Delete(const char* filePath, bool messageIfFailed) noexcept;
@@ -57,6 +59,10 @@ namespace MassStorage
 	void Spin() noexcept;
 	Mutex& GetVolumeMutex(size_t vol) noexcept;
 	GCodeResult GetFileInfo(const char *filePath, GCodeFileInfo& info, bool quitEarly) noexcept;
+	void QueueFileInfo(const char *filePath) noexcept;										// Parse a file in the background so that its info is cached
+	const char *CacheKey(const char *path) noexcept;										// Return the key under which the storage caches index a path
+	bool IsGCodeFileName(const char *filePath) noexcept;									// Return true if a file name has one of the extensions used for G-code files
+	bool IsPrintableFile(const char *filePath) noexcept;									// Return true if a file is a G-code file in the G-code directory of any volume
 	void RecordSimulationTime(const char *printingFilePath, uint32_t simSeconds) noexcept;	// Append the simulated printing time to the end of the file
 	FileWriteBuffer *AllocateWriteBuffer() noexcept;
 	void ReleaseWriteBuffer(FileWriteBuffer *buffer) noexcept;
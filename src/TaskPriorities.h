@@ -21,6 +21,8 @@ namespace TaskPriority
     static constexpr int AinPriority = 4;
     static constexpr int HeightFollowingPriority = 4;
     static constexpr int LaserPriority = 5;
+    static constexpr int FileReadaheadPriority = 2;
+    static constexpr int FileWriteBehindPriority = 2;
 #else
     static constexpr int HeatPriority = 2;
 	static constexpr int SensorsPriority = 2;
@@ -33,6 +35,9 @@ namespace TaskPriority
 	static constexpr int CanReceiverPriority = 3;
 	static constexpr int CanClockPriority = 3;
 	static constexpr int EthernetPriority = 3;
+	static constexpr int FileReadaheadPriority = 2;					// higher than the main task so that it refills the buffer as soon as there is space
+	static constexpr int FileWriteBehindPriority = 2;				// higher than the network task (SpinPriority) so that it starts writing as soon as a buffer is full,
+																	// but lower than the Ethernet task so that incoming packets are still handled while it writes
 #endif
 }
 
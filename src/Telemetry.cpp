@@ -0,0 +1,491 @@
+/*
+ * Telemetry.cpp
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#include "Telemetry.h"
+
+#if SUPPORT_TELEMETRY
+
+#include "RepRap.h"
+#include <OutputMemory.h>
+#include <GCodes/GCodeBuffer/GCodeBuffer.h>
+#include <GCodes/GCodeException.h>
+#include <RTOSIface/RTOSIface.h>
+#include <General/IP4String.h>
+#include "Networking/Network.h"
+
+static Mutex telemetryMutex;
+
+TelemetryChannel *Telemetry::channels[MaxTelemetryChannels] = { 0 };
+uint32_t Telemetry::interval = DefaultTelemetryInterval;
+uint32_t Telemetry::whenLastSampled = 0;
+uint32_t Telemetry::numSamples = 0;
+IPAddress Telemetry::publishAddress;
+uint16_t Telemetry::publishPort = 0;
+uint16_t Telemetry::configNumber = 0;
+uint32_t Telemetry::publishInterval = 0;
+uint32_t Telemetry::whenLastPublished = 0;
+uint32_t Telemetry::packetSequence = 0;
+uint32_t Telemetry::numSendFailures = 0;
+
+void TelemetryChannel::Accumulator::Clear() noexcept
+{
+	min = max = sum = 0.0;
+	count = numValid = 0;
+}
+
+void TelemetryChannel::Accumulator::Add(const Bucket& b) noexcept
+{
+	++count;
+	if (!std::isnan(b.avg))
+	{
+		if (numValid == 0)
+		{
+			min = b.min;
+			max = b.max;
+		}
+		else
+		{
+			if (b.min < min) { min = b.min; }
+			if (b.max > max) { max = b.max; }
+		}
+		sum += b.avg;
+		++numValid;
+	}
+}
+
+TelemetryChannel::Bucket TelemetryChannel::Accumulator::GetBucket() const noexcept
+{
+	return (numValid == 0) ? Bucket{ NAN, NAN, NAN } : Bucket{ min, max, sum/numValid };
+}
+
+TelemetryChannel::TelemetryChannel(const char *p_key) noexcept
+{
+	key.copy(p_key);
+	Clear();
+}
+
+void TelemetryChannel::Clear() noexcept
+{
+	for (size_t tier = 0; tier < NumTelemetryTiers; ++tier)
+	{
+		numStored[tier] = next[tier] = 0;
+	}
+	for (Accumulator& acc : accumulators)
+	{
+		acc.Clear();
+	}
+}
+
+// Store a sample, and when we have enough entries at one resolution store their min, max and average at the next
+void TelemetryChannel::AddSample(float val) noexcept
+{
+	samples[next[0]] = val;
+	Bucket b{ val, val, val };
+	for (size_t tier = 0; ; )
+	{
+		next[tier] = (next[tier] + 1) % TelemetryHistoryLength;
+		if (numStored[tier] < TelemetryHistoryLength)
+		{
+			++numStored[tier];
+		}
+
+		++tier;
+		if (tier == NumTelemetryTiers)
+		{
+			break;
+		}
+
+		Accumulator& acc = accumulators[tier - 1];
+		acc.Add(b);
+		if (acc.count < TelemetryDownsampleFactor)
+		{
+			break;
+		}
+		b = acc.GetBucket();
+		acc.Clear();
+		buckets[tier - 1][next[tier]] = b;
+	}
+}
+
+size_t TelemetryChannel::GetIndex(size_t tier, size_t n) const noexcept
+{
+	return (next[tier] + TelemetryHistoryLength - numStored[tier] + n) % TelemetryHistoryLength;
+}
+
+void Telemetry::Init() noexcept
+{
+	telemetryMutex.Create("Telemetry");
+}
+
+// Take a sample of each channel if it is time to. Called from RepRap::Spin.
+void Telemetry::Spin() noexcept
+{
+	const uint32_t now = millis();
+	if (now - whenLastSampled < interval)
+	{
+		return;
+	}
+
+	MutexLocker lock(telemetryMutex);
+
+	// Keep the sample times regular unless we have fallen well behind
+	whenLastSampled = (now - whenLastSampled < 2 * interval) ? whenLastSampled + interval : now;
+	for (TelemetryChannel *c : channels)
+	{
+		if (c != nullptr)
+		{
+			c->AddSample(GetValue(c->key.c_str()));
+		}
+	}
+	++numSamples;
+}
+
+// Get the value of an object model key as a float, or NaN if it doesn't exist or isn't a number
+/*static*/ float Telemetry::GetValue(const char *key) noexcept
+{
+	try
+	{
+		ObjectExplorationContext context(false, 0, 0);
+		const ExpressionValue val = reprap.GetObjectValue(context, nullptr, key);
+		switch (val.GetType())
+		{
+		case TypeCode::Float:
+			return val.fVal;
+
+		case TypeCode::Int32:
+			return (float)val.iVal;
+
+		case TypeCode::Uint32:
+			return (float)val.uVal;
+
+		case TypeCode::Uint64:
+			return (float)val.Get56BitValue();
+
+		case TypeCode::Bool:
+			return (val.bVal) ? 1.0 : 0.0;
+
+		default:
+			break;
+		}
+	}
+	catch (const GCodeException&) { }
+	return NAN;
+}
+
+// Clear the history of all channels. The mutex must be owned.
+/*static*/ void Telemetry::ClearHistory() noexcept
+{
+	for (TelemetryChannel *c : channels)
+	{
+		if (c != nullptr)
+		{
+			c->Clear();
+		}
+	}
+	numSamples = 0;
+	whenLastSampled = millis();
+}
+
+// Handle M939
+//  M939 Pn K"key"				record the object model value 'key' on channel n, or stop recording channel n if the key is empty
+//  M939 Snnn					set the sample interval in milliseconds
+//  M939 Rn [Pn]				report the history at resolution n of all channels or of channel n, in JSON format
+//  M939 D"ip" Unnn Fnnn		publish the latest values to UDP port Unnn at that address every Fnnn milliseconds, or stop publishing if F is 0
+//  M939						report the configuration
+GCodeResult Telemetry::Configure(GCodeBuffer& gb, const StringRef& reply, OutputBuffer *& outBuf) THROWS(GCodeException)
+{
+	if (gb.Seen('R'))
+	{
+		const unsigned int tier = gb.GetLimitedUIValue('R', NumTelemetryTiers);
+		const int channel = (gb.Seen('P')) ? (int)gb.GetLimitedUIValue('P', MaxTelemetryChannels) : -1;
+		outBuf = GetJsonResponse(tier, channel);
+		if (outBuf == nullptr)
+		{
+			reply.copy("{\"err\":-1}");
+		}
+		return GCodeResult::ok;
+	}
+
+	GCodeResult rslt = GCodeResult::ok;
+	bool seen = false;
+	if (gb.Seen('P'))
+	{
+		const size_t channel = gb.GetLimitedUIValue('P', MaxTelemetryChannels);
+		String<StringLength50> key;
+		if (!gb.Seen('K'))
+		{
+			reply.copy("missing K parameter");
+			return GCodeResult::error;
+		}
+		gb.GetQuotedString(key.GetRef(), true);
+
+		MutexLocker lock(telemetryMutex);
+		delete channels[channel];
+		channels[channel] = (key.IsEmpty()) ? nullptr : new TelemetryChannel(key.c_str());
+		++configNumber;
+		if (!key.IsEmpty() && std::isnan(GetValue(key.c_str())))
+		{
+			reply.printf("value of '%s' is not currently a number", key.c_str());
+			rslt = GCodeResult::warning;
+		}
+		seen = true;
+	}
+
+	if (gb.Seen('S'))
+	{
+		interval = gb.GetLimitedUIValue('S', MaxTelemetryInterval + 1, MinTelemetryInterval);
+		seen = true;
+	}
+
+	bool seenPublish = false;
+	if (gb.Seen('D'))
+	{
+		IPAddress address;
+		gb.GetIPAddress(address);
+		publishAddress = address;
+		seenPublish = true;
+	}
+	if (gb.Seen('U'))
+	{
+		publishPort = gb.GetLimitedUIValue('U', 65536, 1);
+		seenPublish = true;
+	}
+	if (gb.Seen('F'))
+	{
+		const uint32_t val = gb.GetUIValue();
+		if (val != 0 && (val < MinTelemetryInterval || val > MaxTelemetryInterval))
+		{
+			reply.printf("publish interval must be 0 or between %" PRIu32 " and %" PRIu32 "ms", MinTelemetryInterval, MaxTelemetryInterval);
+			return GCodeResult::error;
+		}
+		publishInterval = val;
+		seenPublish = true;
+	}
+	if (seenPublish && publishInterval != 0)
+	{
+		if (publishAddress.IsNull() || publishPort == 0)
+		{
+			publishInterval = 0;
+			reply.copy("publishing needs a destination address and port");
+			return GCodeResult::error;
+		}
+		if (!reprap.GetNetwork().CanSendUdp())
+		{
+			publishInterval = 0;
+			reply.copy("no network interface can send UDP packets");
+			return GCodeResult::error;
+		}
+	}
+
+	MutexLocker lock(telemetryMutex);
+	if (seen)
+	{
+		ClearHistory();
+	}
+	else if (!seenPublish)
+	{
+		reply.printf("Sample interval %" PRIu32 "ms", interval);
+		for (size_t i = 0; i < MaxTelemetryChannels; ++i)
+		{
+			if (channels[i] != nullptr)
+			{
+				reply.catf(", P%u: %s", i, channels[i]->key.c_str());
+			}
+		}
+		if (publishInterval != 0)
+		{
+			reply.catf(", publishing to %s:%u every %" PRIu32 "ms, %" PRIu32 " packets sent, %" PRIu32 " failed",
+						IP4String(publishAddress).c_str(), publishPort, publishInterval, packetSequence, numSendFailures);
+		}
+	}
+	return rslt;
+}
+
+// If it is time to publish the latest values, build the packet and return its length
+size_t Telemetry::GetPacketIfDue(uint8_t buf[MaxPacketLength], IPAddress& dest, uint16_t& port) noexcept
+{
+	const uint32_t now = millis();
+	if (publishInterval == 0 || now - whenLastPublished < publishInterval)
+	{
+		return 0;
+	}
+	whenLastPublished = now;
+
+	MutexLocker lock(telemetryMutex);
+
+	size_t length = PacketHeaderLength;
+	uint8_t numValues = 0;
+	for (size_t i = 0; i < MaxTelemetryChannels; ++i)
+	{
+		const TelemetryChannel * const c = channels[i];
+		if (c != nullptr)
+		{
+			const float val = (c->numStored[0] == 0) ? NAN : c->samples[c->GetIndex(0, c->numStored[0] - 1)];
+			buf[length] = (uint8_t)i;
+			memcpy(buf + length + 1, &val, sizeof(val));
+			length += PacketEntryLength;
+			++numValues;
+		}
+	}
+
+	memcpy(buf, "RRFT", 4);
+	buf[4] = PacketVersion;
+	buf[5] = numValues;
+	memcpy(buf + 6, &configNumber, sizeof(configNumber));
+	memcpy(buf + 8, &packetSequence, sizeof(packetSequence));
+	memcpy(buf + 12, &whenLastSampled, sizeof(whenLastSampled));
+
+	dest = publishAddress;
+	port = publishPort;
+	return length;
+}
+
+// Record whether the packet we built last was sent. Only packets that were sent use up a sequence number, so the collector can tell from gaps
+// in the sequence numbers how many packets were lost on the way.
+void Telemetry::PacketSent(bool ok) noexcept
+{
+	if (ok)
+	{
+		++packetSequence;
+	}
+	else
+	{
+		++numSendFailures;
+	}
+}
+
+// Append the latest values in this form: {"time":<ms when sampled>,"values":{"<key>":<value>,...}}
+void Telemetry::AppendLatestValues(OutputBuffer *buf) noexcept
+{
+	MutexLocker lock(telemetryMutex);
+
+	buf->catf("{\"time\":%" PRIu32 ",\"values\":{", whenLastSampled);
+	bool first = true;
+	for (const TelemetryChannel *c : channels)
+	{
+		if (c != nullptr)
+		{
+			if (!first)
+			{
+				buf->cat(',');
+			}
+			first = false;
+			buf->catf("\"%.s\":", c->key.c_str());
+			AppendValue(buf, (c->numStored[0] == 0) ? NAN : c->samples[c->GetIndex(0, c->numStored[0] - 1)]);
+		}
+	}
+	buf->cat("}}");
+}
+
+/*static*/ void Telemetry::AppendValue(OutputBuffer *buf, float val) noexcept
+{
+	if (std::isnan(val))
+	{
+		buf->cat("null");
+	}
+	else
+	{
+		buf->AppendFloat(val, 2);
+	}
+}
+
+// Report the history at one resolution as JSON, oldest first. 'age' is the number of milliseconds since the newest entry was completed.
+// Return null if we ran out of output buffers.
+OutputBuffer *Telemetry::GetJsonResponse(unsigned int tier, int channel) noexcept
+{
+	OutputBuffer *buf;
+	if (!OutputBuffer::Allocate(buf))
+	{
+		return nullptr;
+	}
+
+	MutexLocker lock(telemetryMutex);
+
+	uint32_t period = interval;
+	uint32_t samplesPerEntry = 1;
+	for (unsigned int i = 0; i < tier; ++i)
+	{
+		period *= TelemetryDownsampleFactor;
+		samplesPerEntry *= TelemetryDownsampleFactor;
+	}
+	const uint32_t age = millis() - whenLastSampled + (numSamples % samplesPerEntry) * interval;
+	buf->printf("{\"interval\":%" PRIu32 ",\"tier\":%u,\"period\":%" PRIu32 ",\"age\":%" PRIu32 ",\"channels\":[", interval, tier, period, age);
+
+	bool first = true;
+	for (size_t i = 0; i < MaxTelemetryChannels; ++i)
+	{
+		const TelemetryChannel * const c = channels[i];
+		if (c == nullptr || (channel >= 0 && (size_t)channel != i))
+		{
+			continue;
+		}
+
+		if (!first)
+		{
+			buf->cat(',');
+		}
+		first = false;
+		buf->catf("{\"channel\":%u,\"key\":\"%.s\"", i, c->key.c_str());
+		const size_t num = c->numStored[tier];
+		if (tier == 0)
+		{
+			buf->cat(",\"values\":[");
+			for (size_t n = 0; n < num; ++n)
+			{
+				if (n != 0)
+				{
+					buf->cat(',');
+				}
+				AppendValue(buf, c->samples[c->GetIndex(0, n)]);
+			}
+			buf->cat(']');
+		}
+		else
+		{
+			const TelemetryChannel::Bucket * const buckets = c->buckets[tier - 1];
+			buf->cat(",\"min\":[");
+			for (size_t n = 0; n < num; ++n)
+			{
+				if (n != 0)
+				{
+					buf->cat(',');
+				}
+				AppendValue(buf, buckets[c->GetIndex(tier, n)].min);
+			}
+			buf->cat("],\"max\":[");
+			for (size_t n = 0; n < num; ++n)
+			{
+				if (n != 0)
+				{
+					buf->cat(',');
+				}
+				AppendValue(buf, buckets[c->GetIndex(tier, n)].max);
+			}
+			buf->cat("],\"avg\":[");
+			for (size_t n = 0; n < num; ++n)
+			{
+				if (n != 0)
+				{
+					buf->cat(',');
+				}
+				AppendValue(buf, buckets[c->GetIndex(tier, n)].avg);
+			}
+			buf->cat(']');
+		}
+		buf->cat('}');
+	}
+	buf->cat("]}");
+
+	if (buf->HadOverflow())
+	{
+		OutputBuffer::ReleaseAll(buf);
+	}
+	return buf;
+}
+
+#endif
+
+// End
@@ -0,0 +1,115 @@
+/*
+ * Telemetry.h
+ *
+ *  Created on: 19 Oct 2026
+ */
+
+#ifndef SRC_TELEMETRY_H_
+#define SRC_TELEMETRY_H_
+
+#include "RepRapFirmware.h"
+
+#if SUPPORT_TELEMETRY
+
+#include <GCodes/GCodeResult.h>
+#include <General/FreelistManager.h>
+#include <General/IPAddress.h>
+
+// The recorded history of one object model value. Samples are kept at full resolution, and each coarser resolution keeps the minimum,
+// maximum and average of TelemetryDownsampleFactor entries of the one before it. All storage is allocated when the channel is configured.
+class TelemetryChannel
+{
+public:
+	friend class Telemetry;
+
+	void* operator new(size_t sz) noexcept { return FreelistManager::Allocate<TelemetryChannel>(); }
+	void operator delete(void* p) noexcept { FreelistManager::Release<TelemetryChannel>(p); }
+
+	TelemetryChannel(const char *p_key) noexcept;
+
+private:
+	struct Bucket
+	{
+		float min, max, avg;
+	};
+
+	struct Accumulator
+	{
+		float min, max, sum;
+		uint16_t count;										// how many entries we have been given
+		uint16_t numValid;									// how many of them were not NaN
+
+		void Clear() noexcept;
+		void Add(const Bucket& b) noexcept;
+		Bucket GetBucket() const noexcept;
+	};
+
+	void AddSample(float val) noexcept;
+	void Clear() noexcept;
+	size_t GetIndex(size_t tier, size_t n) const noexcept;	// get the ring index of the n'th oldest entry at a tier
+
+	String<StringLength50> key;
+	float samples[TelemetryHistoryLength];
+	Bucket buckets[NumTelemetryTiers - 1][TelemetryHistoryLength];
+	Accumulator accumulators[NumTelemetryTiers - 1];
+	uint16_t numStored[NumTelemetryTiers];					// how many entries are valid at each tier
+	uint16_t next[NumTelemetryTiers];						// where the next entry at each tier will be stored
+};
+
+// Fixed-memory recorder of selected object model values such as heater temperatures, fan speeds and supply voltages, so that the recent history
+// can be fetched in one go instead of clients having to poll fast enough to catch transients. Configured using M939 and read using M939 R
+// or the rr_telemetry HTTP request. All channels are sampled together, so changing the channels or the interval clears the history.
+// The latest values can also be published to a collector as UDP packets, in this format with all values little-endian:
+//  0	char[4]		"RRFT"
+//  4	uint8		packet format version, currently 1
+//  5	uint8		number of values that follow
+//  6	uint16		configuration number, incremented whenever the channels are changed so that the collector knows to fetch them again
+//  8	uint32		packet sequence number
+// 12	uint32		milliseconds since the machine started when the values were sampled
+// 16	then for each configured channel: uint8 channel number, float32 value which is NaN if the value is not available
+class Telemetry
+{
+public:
+	static constexpr uint8_t PacketVersion = 1;
+	static constexpr size_t PacketHeaderLength = 16;
+	static constexpr size_t PacketEntryLength = 5;
+	static constexpr size_t MaxPacketLength = PacketHeaderLength + MaxTelemetryChannels * PacketEntryLength;
+
+	static void Init() noexcept;
+	static void Spin() noexcept;
+
+	static GCodeResult Configure(GCodeBuffer& gb, const StringRef& reply, OutputBuffer *& outBuf) THROWS(GCodeException);
+	static OutputBuffer *GetJsonResponse(unsigned int tier, int channel) noexcept;	// a negative channel means all channels
+
+	// If a UDP packet is due, build it in buf and return its length and destination, else return 0. Called by the network task,
+	// which must then call PacketSent to say whether the packet was sent.
+	static size_t GetPacketIfDue(uint8_t buf[MaxPacketLength], IPAddress& dest, uint16_t& port) noexcept;
+	static void PacketSent(bool ok) noexcept;
+
+	// Append the latest value of each channel as a JSON object, for publishing by MQTT
+	static void AppendLatestValues(OutputBuffer *buf) noexcept;
+
+private:
+	Telemetry() = delete;
+
+	static float GetValue(const char *key) noexcept;
+	static void ClearHistory() noexcept;
+	static void AppendValue(OutputBuffer *buf, float val) noexcept;
+
+	static TelemetryChannel *channels[MaxTelemetryChannels];
+	static uint32_t interval;
+	static uint32_t whenLastSampled;
+	static uint32_t numSamples;								// number of samples taken since the history was last cleared
+
+	static IPAddress publishAddress;
+	static uint16_t publishPort;
+	static uint16_t configNumber;
+	static uint32_t publishInterval;						// 0 if we are not publishing
+	static uint32_t whenLastPublished;
+	static uint32_t packetSequence;							// the number of packets sent, which is also the sequence number of the next one
+	static uint32_t numSendFailures;
+};
+
+#endif
+
+#endif /* SRC_TELEMETRY_H_ */
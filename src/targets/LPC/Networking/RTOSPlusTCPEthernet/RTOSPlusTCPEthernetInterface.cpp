@@ -41,7 +41,7 @@ RTOSPlusTCPEthernetInterface *rtosTCPEtherInterfacePtr; //pointer to the clas in
 
 
 RTOSPlusTCPEthernetInterface::RTOSPlusTCPEthernetInterface(Platform& p) noexcept
-: platform(p), lastTickMillis(0), state(NetworkState::disabled), activated(false), initialised(false), linkUp(false), usingDHCP(false)
+: platform(p), lastTickMillis(0), udpSocket(FREERTOS_INVALID_SOCKET), state(NetworkState::disabled), activated(false), initialised(false), linkUp(false), usingDHCP(false)
 {
     //setup our pointer to access our class methods from the +TCP "C" callbacks
     rtosTCPEtherInterfacePtr = this;
@@ -324,6 +324,11 @@ void RTOSPlusTCPEthernetInterface::Stop() noexcept
 	{
 		MutexLocker lock(interfaceMutex);
         TerminateSockets();
+        if (udpSocket != FREERTOS_INVALID_SOCKET)
+        {
+            FreeRTOS_closesocket(udpSocket);
+            udpSocket = FREERTOS_INVALID_SOCKET;
+        }
         state = NetworkState::disabled;
         //todo: how to stop FreeRTOS+TCP ? (perhaps suspend the IP-Task and EMAC task
 	}
@@ -518,6 +523,31 @@ void RTOSPlusTCPEthernetInterface::TerminateDataPort() noexcept
     }
 }
 
+// Send a UDP packet from an ephemeral port without blocking. FreeRTOS+TCP copies the data.
+bool RTOSPlusTCPEthernetInterface::SendUdpPacket(IPAddress dest, TcpPort port, const uint8_t *data, size_t length) noexcept
+{
+    MutexLocker lock(interfaceMutex);
+
+    if (state != NetworkState::active)
+    {
+        return false;
+    }
+
+    if (udpSocket == FREERTOS_INVALID_SOCKET)
+    {
+        udpSocket = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP);
+        if (udpSocket == FREERTOS_INVALID_SOCKET)
+        {
+            return false;
+        }
+    }
+
+    freertos_sockaddr destAddr;
+    destAddr.sin_addr = dest.GetV4LittleEndian();
+    destAddr.sin_port = FreeRTOS_htons(port);
+    return FreeRTOS_sendto(udpSocket, data, length, FREERTOS_MSG_DONTWAIT, &destAddr, sizeof(destAddr)) > 0;
+}
+
 void RTOSPlusTCPEthernetInterface::InitSockets() noexcept
 {
 	for (size_t i = 0; i < NumProtocols; ++i)
@@ -72,6 +72,9 @@ public:
 
 	void OpenDataPort(TcpPort port) noexcept override;
 	void TerminateDataPort() noexcept override;
+
+	bool SupportsUdp() const noexcept override { return true; }
+	bool SendUdpPacket(IPAddress dest, TcpPort port, const uint8_t *data, size_t length) noexcept override;
     
 protected:
     DECLARE_OBJECT_MODEL
@@ -119,6 +122,7 @@ private:
 
     RTOSPlusTCPEthernetSocket *sockets[NumRTOSPlusTCPEthernetTcpSockets];
     size_t nextSocketToPoll;                        // next TCP socket number to poll for read/write operations
+    Socket_t udpSocket;                             // used to send UDP packets, created when first needed
 
     TcpPort portNumbers[NumProtocols];                    // port number used for each protocol
     bool protocolEnabled[NumProtocols];                // whether each protocol is enabled
@@ -534,7 +534,7 @@ void RTOSPlusTCPEthernetSocket::ReceiveData() noexcept
 		}
 		else if (NetworkBuffer::Count(receivedData) < MaxBuffersPerSocket)
 		{
-            NetworkBuffer * const buf = NetworkBuffer::Allocate();
+            NetworkBuffer * const buf = NetworkBuffer::Allocate(protocol, NetworkBuffer::Count(receivedData));
             if (buf != nullptr)
             {
                 BaseType_t bReceived = FreeRTOS_recv( xConnectedSocket, buf->Data(),buf->SpaceLeft(), 0 );// socket, pointer to buffer, how big is the buffer, flags